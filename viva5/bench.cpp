@@ -0,0 +1,379 @@
+// Headless benchmark of the examples in test.cpp
+// every example runs for fixed number of frames on a virtual clock with no input and no GPU,
+// renderer still counts what it would have done so draw calls and uploads are reported too
+//
+// run:      bench run [-n frames] [-o out.json] [-i input.vinp] [example ...]
+//           no example names runs all of them, default is 600 frames and bench.json
+//           -i replays recorded input and frame times in every example, see examples::recordInput,
+//           an example then ends when the log does if that comes before 'frames'
+// compare:  bench compare baseline.json current.json [-t percent]
+//           exit code is 1 if time per frame or p99 grew more than 'percent' (default 10)
+//           or draw calls, uploads or allocations per frame grew at all
+//
+// times include profiler overhead, compare runs made by the same build only
+// build: cl /std:c++latest /O2 /EHsc bench.cpp   (Windows only, renderer needs D3D11 headers)
+
+#define VI_PROFILE
+#define VI_BENCH
+#include "test.cpp"
+#include <new>
+#include <string>
+
+namespace benchtool
+{
+    std::atomic<unsigned long long> allocations;
+    std::atomic<unsigned long long> allocatedBytes;
+
+    unsigned long long allocationsSoFar()
+    {
+        return allocations.load() + vi::memory::allocations.load();
+    }
+
+    unsigned long long bytesSoFar()
+    {
+        return allocatedBytes.load() + vi::memory::allocatedBytes.load();
+    }
+}
+
+// operator new and vi::memory::alloctrack are counted, frame loops should make none
+// engine code that calls malloc directly (stb_image, file buffers, net pools) is not seen
+void* operator new(size_t size)
+{
+    benchtool::allocations.fetch_add(1, std::memory_order_relaxed);
+    benchtool::allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void* block = malloc(size ? size : 1);
+    if (!block) throw std::bad_alloc();
+    return block;
+}
+
+void operator delete(void* block) noexcept
+{
+    free(block);
+}
+
+namespace benchtool
+{
+    struct example
+    {
+        const char* name;
+        void (*fn)();
+    };
+
+    const example scenes[] =
+    {
+        { "performance", examples::performance },
+        { "zindex", examples::zindex },
+        { "typing", examples::typing },
+        { "inputState", examples::inputState },
+        { "text", examples::text },
+        { "customVS", examples::customVS },
+        { "lines", examples::lines },
+        { "camera", examples::camera },
+        { "multipleTextures", examples::multipleTextures },
+        { "asyncTextures", examples::asyncTextures },
+        { "keyboardMultipleAnimationsMath", examples::keyboardMultipleAnimationsMath },
+        { "timerMotionAnimation", examples::timerMotionAnimation },
+        { "fixedTimestep", examples::fixedTimestep },
+        { "moreSprites", examples::moreSprites },
+        { "basicSprite", examples::basicSprite },
+        { "mesh", examples::mesh },
+        { "mesh2", examples::mesh2 },
+        { "blendState", examples::blendState },
+    };
+
+    struct phase
+    {
+        const char* name;
+        uint depth;
+        unsigned long long calls;
+        long long totalNs;
+    };
+
+    struct result
+    {
+        const char* name;
+        uint frames;
+        vi::time::frameSummary frame;
+        vi::gl::renderCounters counters;
+        unsigned long long allocations;
+        unsigned long long allocatedBytes;
+        std::vector<phase> phases;
+    };
+
+    // state of the example that is running
+    result* current;
+    unsigned long long allocationsAtFrameStart;
+    unsigned long long bytesAtFrameStart;
+
+    void onFrame()
+    {
+        // events recorded before first frame are setup, drop them
+        vi::profile::frame();
+
+        if (examples::bench.frame > 0)
+        {
+            current->allocations += allocationsSoFar() - allocationsAtFrameStart;
+            current->allocatedBytes += bytesSoFar() - bytesAtFrameStart;
+            const std::vector<vi::profile::aggregate>& aggregates = vi::profile::getFrame();
+
+            for (uint i = 0; i < aggregates.size(); i++)
+            {
+                const vi::profile::aggregate* a = &aggregates[i];
+                phase* p = nullptr;
+
+                for (uint j = 0; j < current->phases.size(); j++)
+                {
+                    if (current->phases[j].depth == a->depth && strcmp(current->phases[j].name, a->name) == 0)
+                    {
+                        p = &current->phases[j];
+                        break;
+                    }
+                }
+
+                if (!p)
+                {
+                    current->phases.push_back({ a->name, a->depth, 0, 0 });
+                    p = &current->phases.back();
+                }
+
+                p->calls += a->calls;
+                p->totalNs += a->totalNs;
+            }
+        }
+
+        // taken last so bookkeeping above is not counted
+        allocationsAtFrameStart = allocationsSoFar();
+        bytesAtFrameStart = bytesSoFar();
+    }
+
+    void writeResult(FILE* f, result* r, bool last)
+    {
+        vi::gl::renderCounters* c = &r->counters;
+        double n = r->frames ? r->frames : 1;
+
+        // one example per line so 'compare' can read it back without a JSON parser
+        fprintf(f, "    {\"name\":\"%s\",\"msPerFrame\":%.4f,\"p50Ms\":%.4f,\"p95Ms\":%.4f,\"p99Ms\":%.4f,\"maxMs\":%.4f,",
+            r->name, r->frame.mean * 1e3, r->frame.p50 * 1e3, r->frame.p95 * 1e3, r->frame.p99 * 1e3, r->frame.max * 1e3);
+        fprintf(f, "\"allocationsPerFrame\":%.2f,\"allocatedBytesPerFrame\":%.1f,", r->allocations / n, r->allocatedBytes / n);
+        fprintf(f, "\"drawCallsPerFrame\":%.2f,\"verticesPerFrame\":%.1f,\"uploadsPerFrame\":%.2f,\"mapsPerFrame\":%.2f,"
+            "\"bytesUploadedPerFrame\":%.1f,\"textureBindsPerFrame\":%.2f,\"shaderSwitchesPerFrame\":%.2f,"
+            "\"constantBufferBindsPerFrame\":%.2f,\"modeFlipsPerFrame\":%.2f,\"rasterizerChangesPerFrame\":%.2f,"
+            "\"blendChangesPerFrame\":%.2f,",
+            c->drawCalls / n, c->vertices / n, c->updateSubresourceCalls / n, c->mapCalls / n, c->bytesUploaded / n,
+            c->textureBinds / n, c->shaderSwitches / n, c->constantBufferBinds / n, c->modeFlips / n,
+            c->rasterizerChanges / n, c->blendChanges / n);
+        fprintf(f, "\"phases\":[");
+
+        for (uint i = 0; i < r->phases.size(); i++)
+        {
+            phase* p = &r->phases[i];
+            fprintf(f, "%s{\"phase\":\"%s\",\"depth\":%u,\"callsPerFrame\":%.2f,\"msPerFrame\":%.4f}", i ? "," : "",
+                p->name, p->depth, p->calls / n, p->totalNs / n / 1e6);
+        }
+
+        fprintf(f, "]}%s\n", last ? "" : ",");
+    }
+
+    int run(int argc, char** argv)
+    {
+        const char* out = "bench.json";
+        const char* replay = nullptr;
+        uint frames = 600;
+        int i = 2;
+
+        for (; i < argc && argv[i][0] == '-'; i++)
+        {
+            if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) frames = atoi(argv[++i]);
+            else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out = argv[++i];
+            else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) replay = argv[++i];
+        }
+
+        if (frames == 0)
+        {
+            fprintf(stderr, "frame count must be positive\n");
+            return 1;
+        }
+
+        std::vector<const example*> selected;
+        uint exampleCount = sizeof(scenes) / sizeof(scenes[0]);
+
+        for (int j = i; j < argc; j++)
+        {
+            const example* e = nullptr;
+            for (uint k = 0; k < exampleCount; k++)
+                if (strcmp(scenes[k].name, argv[j]) == 0) e = scenes + k;
+
+            if (!e)
+            {
+                fprintf(stderr, "unknown example %s\n", argv[j]);
+                return 1;
+            }
+
+            selected.push_back(e);
+        }
+
+        if (selected.empty())
+            for (uint k = 0; k < exampleCount; k++) selected.push_back(scenes + k);
+
+        examples::bench.active = true;
+        examples::bench.frames = frames;
+        examples::bench.step = 1 / 60.0;
+        examples::bench.onFrame = onFrame;
+
+        std::vector<result> results(selected.size());
+
+        for (uint j = 0; j < selected.size(); j++)
+        {
+            result* r = &results[j];
+            r->name = selected[j]->name;
+            vi::util::zero(&r->counters);
+            r->allocations = 0;
+            r->allocatedBytes = 0;
+            // reserved so growing it never shows up as allocation of the example
+            r->phases.reserve(256);
+            current = r;
+
+            examples::bench.beginScene();
+            if (replay && !examples::replayInput(replay)) return 1;
+            selected[j]->fn();
+            examples::bench.stats.getSummary(&r->frame);
+            r->counters = examples::bench.total;
+            r->frames = examples::bench.frame;
+            double n = r->frames ? r->frames : 1;
+
+            printf("%-32s %8.3f ms/frame  p99 %8.3f ms  %8.1f draws  %8.2f allocs per frame\n", r->name,
+                r->frame.mean * 1e3, r->frame.p99 * 1e3, r->counters.drawCalls / n, r->allocations / n);
+        }
+
+        FILE* f = fopen(out, "wb");
+
+        if (!f)
+        {
+            fprintf(stderr, "could not open %s\n", out);
+            return 1;
+        }
+
+        fprintf(f, "{\n  \"frames\": %u,\n  \"examples\": [\n", frames);
+        for (uint j = 0; j < results.size(); j++) writeResult(f, &results[j], j + 1 == results.size());
+        fprintf(f, "  ]\n}\n");
+        fclose(f);
+        return 0;
+    }
+
+    // values of one example line written by 'writeResult'
+    struct entry
+    {
+        char name[64];
+        std::string line;
+    };
+
+    bool readEntries(const char* filename, std::vector<entry>* entries)
+    {
+        FILE* f = fopen(filename, "rb");
+
+        if (!f)
+        {
+            fprintf(stderr, "could not open %s\n", filename);
+            return false;
+        }
+
+        char buffer[16384];
+
+        while (fgets(buffer, sizeof(buffer), f))
+        {
+            const char* start = strstr(buffer, "{\"name\":\"");
+            if (!start) continue;
+
+            entry e = {};
+            start += 9;
+            const char* end = strchr(start, '"');
+            size_t len = end ? end - start : 0;
+            if (len >= sizeof(e.name)) len = sizeof(e.name) - 1;
+            memcpy(e.name, start, len);
+            e.line = buffer;
+
+            // phases are not compared, cut them off so their keys don't match
+            size_t phases = e.line.find("\"phases\"");
+            if (phases != std::string::npos) e.line.resize(phases);
+
+            entries->push_back(e);
+        }
+
+        fclose(f);
+        return true;
+    }
+
+    bool getValue(const entry* e, const char* key, double* value)
+    {
+        char pattern[80];
+        snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+        size_t at = e->line.find(pattern);
+        if (at == std::string::npos) return false;
+
+        *value = atof(e->line.c_str() + at + strlen(pattern));
+        return true;
+    }
+
+    int compare(int argc, char** argv)
+    {
+        double threshold = 10;
+
+        for (int i = 4; i < argc; i++)
+            if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+
+        std::vector<entry> baseline, current;
+        if (!readEntries(argv[2], &baseline) || !readEntries(argv[3], &current)) return 1;
+
+        // time is noisy so it gets a threshold, counters are deterministic so any growth is flagged
+        const char* timed[] = { "msPerFrame", "p99Ms" };
+        const char* counted[] = { "drawCallsPerFrame", "uploadsPerFrame", "bytesUploadedPerFrame",
+            "modeFlipsPerFrame", "allocationsPerFrame" };
+        int regressions = 0;
+
+        for (uint i = 0; i < current.size(); i++)
+        {
+            const entry* c = &current[i];
+            const entry* b = nullptr;
+
+            for (uint j = 0; j < baseline.size(); j++)
+                if (strcmp(baseline[j].name, c->name) == 0) b = &baseline[j];
+
+            if (!b)
+            {
+                printf("%-32s not in baseline\n", c->name);
+                continue;
+            }
+
+            for (uint k = 0; k < sizeof(timed) / sizeof(timed[0]) + sizeof(counted) / sizeof(counted[0]); k++)
+            {
+                bool isTimed = k < sizeof(timed) / sizeof(timed[0]);
+                const char* key = isTimed ? timed[k] : counted[k - sizeof(timed) / sizeof(timed[0])];
+                double before, after;
+
+                if (!getValue(b, key, &before) || !getValue(c, key, &after)) continue;
+
+                double change = before > 0 ? (after - before) / before * 100 : (after > 0 ? 100 : 0);
+                bool regressed = isTimed ? change > threshold : after > before + 1e-6;
+
+                if (regressed) regressions++;
+                if (regressed || change < -threshold)
+                    printf("%-32s %-24s %12.4f -> %12.4f %+8.1f%% %s\n", c->name, key, before, after, change,
+                        regressed ? "REGRESSION" : "improved");
+            }
+        }
+
+        printf("%d regression(s)\n", regressions);
+        return regressions ? 1 : 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc >= 2 && strcmp(argv[1], "run") == 0) return benchtool::run(argc, argv);
+    if (argc >= 4 && strcmp(argv[1], "compare") == 0) return benchtool::compare(argc, argv);
+
+    fprintf(stderr, "usage:\n"
+        "  bench run [-n frames] [-o out.json] [example ...]\n"
+        "  bench compare baseline.json current.json [-t percent]\n");
+    return 1;
+}
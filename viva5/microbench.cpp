@@ -0,0 +1,731 @@
+// Microbenchmarks of engine primitives, separate program from test.cpp
+// every benchmark is calibrated so one sample takes at least 'minimum sample time',
+// then runs 'warmup' untimed samples and 'repetitions' timed ones
+// results are time per item (sprite, routine, allocation...) so different sizes compare directly
+//
+// usage:  microbench [-r repetitions] [-w warmup] [-t minSampleMs] [-c cpu] [-p] [-j out.json] [-o out.csv] [filter]
+//         filter runs only benchmarks whose name contains it, e.g. microbench dynamic
+//         -c pins the thread to one cpu so scheduler migrations don't show up as noise
+//         -p reads hardware counters (Linux perf events) over timed samples and adds
+//            IPC and misses per item, ignored with a warning where they are not available
+// Linux:  g++ -O2 -std=c++17 microbench.cpp -o microbench -lpthread
+//         renderer side (sprites, text, animations) is Windows only like the renderer itself
+
+#include "viva_impl.h"
+#include <memory>
+#include <string>
+#ifndef _WIN32
+#include <sched.h>
+#endif
+
+namespace microbench
+{
+    struct options
+    {
+        uint repetitions;
+        uint warmup;
+        double minSampleSec;
+        // -1 means no pinning
+        int cpu;
+        // nullptr when hardware counters are off or not available
+        vi::perf::group* counters;
+        const char* jsonFile;
+        const char* csvFile;
+        const char* filter;
+    };
+
+    struct benchmark
+    {
+        std::string name;
+        // items processed by one call of 'run'
+        unsigned long long items;
+        std::function<void()> run;
+    };
+
+    struct result
+    {
+        const benchmark* b;
+        unsigned long long callsPerSample;
+        // nanoseconds per item, sorted
+        std::vector<double> samples;
+        double min;
+        double median;
+        double mean;
+        double stddev;
+        double max;
+        // summed over timed samples, divide by 'countedItems'
+        vi::perf::sample counters;
+        double countedItems;
+    };
+
+    std::vector<benchmark> benchmarks;
+
+    void add(const std::string& name, unsigned long long items, std::function<void()> run)
+    {
+        benchmarks.push_back({ name, items, run });
+    }
+
+    // stops compiler from deleting work whose result is not used
+    volatile unsigned long long sink;
+
+    template<typename T>
+    void keep(const T& value)
+    {
+        const byte* p = (const byte*)&value;
+        sink += p[0];
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+
+    bool pin(int cpu)
+    {
+#ifdef _WIN32
+        return SetThreadAffinityMask(GetCurrentThread(), 1ull << cpu) != 0;
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+#endif
+    }
+
+    long long timeCalls(const benchmark* b, unsigned long long calls)
+    {
+        long long start = vi::time::nowNs();
+        for (unsigned long long i = 0; i < calls; i++) b->run();
+        return vi::time::nowNs() - start;
+    }
+
+    void measure(const benchmark* b, const options* o, result* r)
+    {
+        r->b = b;
+        long long minSampleNs = (long long)(o->minSampleSec * vi::time::NS_PER_SEC);
+        unsigned long long calls = 1;
+
+        // double calls until one sample is long enough for the clock
+        while (timeCalls(b, calls) < minSampleNs && calls < (1ull << 30)) calls *= 2;
+
+        for (uint i = 0; i < o->warmup; i++) timeCalls(b, calls);
+
+        r->callsPerSample = calls;
+        r->samples.resize(o->repetitions);
+        r->countedItems = (double)calls * b->items * o->repetitions;
+        vi::perf::sample begin, end;
+
+        if (o->counters) o->counters->read(&begin);
+
+        for (uint i = 0; i < o->repetitions; i++)
+            r->samples[i] = (double)timeCalls(b, calls) / ((double)calls * b->items);
+
+        if (o->counters) o->counters->read(&end);
+        else end = begin = {};
+
+        vi::perf::difference(&begin, &end, &r->counters);
+
+        std::sort(r->samples.begin(), r->samples.end());
+        double sum = 0, sumsq = 0;
+
+        for (uint i = 0; i < o->repetitions; i++)
+        {
+            sum += r->samples[i];
+            sumsq += r->samples[i] * r->samples[i];
+        }
+
+        uint n = o->repetitions;
+        r->min = r->samples[0];
+        r->max = r->samples[n - 1];
+        r->median = n % 2 ? r->samples[n / 2] : (r->samples[n / 2 - 1] + r->samples[n / 2]) / 2;
+        r->mean = sum / n;
+        double variance = n > 1 ? (sumsq - sum * sum / n) / (n - 1) : 0;
+        r->stddev = variance > 0 ? sqrt(variance) : 0;
+    }
+
+    bool writeJSON(const char* filename, const options* o, const std::vector<result>& results)
+    {
+        FILE* f = fopen(filename, "wb");
+        if (!f) return false;
+
+        fprintf(f, "{\n  \"repetitions\": %u,\n  \"warmup\": %u,\n  \"cpu\": %d,\n  \"benchmarks\": [\n",
+            o->repetitions, o->warmup, o->cpu);
+
+        for (uint i = 0; i < results.size(); i++)
+        {
+            const result* r = &results[i];
+            fprintf(f, "    {\"name\":\"%s\",\"items\":%llu,\"callsPerSample\":%llu,\"nsPerItem\":{\"min\":%.4f,"
+                "\"median\":%.4f,\"mean\":%.4f,\"stddev\":%.4f,\"max\":%.4f}",
+                r->b->name.c_str(), r->b->items, r->callsPerSample, r->min, r->median, r->mean, r->stddev, r->max);
+
+            // only counters that were read are written
+            if (r->counters.valid[vi::perf::CYCLES])
+            {
+                fprintf(f, ",\"perItem\":{");
+                bool first = true;
+
+                for (uint j = 0; j < vi::perf::COUNTER_COUNT; j++)
+                {
+                    if (!r->counters.valid[j]) continue;
+
+                    fprintf(f, "%s\"%s\":%.4f", first ? "" : ",", vi::perf::counterNames[j],
+                        r->counters.values[j] / r->countedItems);
+                    first = false;
+                }
+
+                fprintf(f, "}");
+            }
+
+            fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+
+        fprintf(f, "  ]\n}\n");
+        return fclose(f) == 0;
+    }
+
+    bool writeCSV(const char* filename, const std::vector<result>& results)
+    {
+        FILE* f = fopen(filename, "wb");
+        if (!f) return false;
+
+        fprintf(f, "name,items,callsPerSample,minNs,medianNs,meanNs,stddevNs,maxNs");
+        for (uint j = 0; j < vi::perf::COUNTER_COUNT; j++) fprintf(f, ",%sPerItem", vi::perf::counterNames[j]);
+        fprintf(f, "\n");
+
+        for (uint i = 0; i < results.size(); i++)
+        {
+            const result* r = &results[i];
+            fprintf(f, "%s,%llu,%llu,%.4f,%.4f,%.4f,%.4f,%.4f", r->b->name.c_str(), r->b->items,
+                r->callsPerSample, r->min, r->median, r->mean, r->stddev, r->max);
+
+            // empty cell for counters that were not read
+            for (uint j = 0; j < vi::perf::COUNTER_COUNT; j++)
+            {
+                if (r->counters.valid[j]) fprintf(f, ",%.4f", r->counters.values[j] / r->countedItems);
+                else fprintf(f, ",");
+            }
+
+            fprintf(f, "\n");
+        }
+
+        return fclose(f) == 0;
+    }
+
+    // benchmarks of primitives, names are 'area/what/size'
+
+    void addMath()
+    {
+        const uint count = 4096;
+        auto points = std::make_shared<std::vector<float>>(count * 2);
+        vi::util::rng rng;
+        rng.init(0, 1000);
+
+        for (uint i = 0; i < count * 2; i++) (*points)[i] = rng.rnd() / 500.0f - 1;
+
+        add("math/rot2D/4096", count, [points]()
+        {
+            float* p = points->data();
+            for (uint i = 0; i < count; i++)
+                vi::math::rot2D(p[i * 2], p[i * 2 + 1], 0, 0, 0.001f, p + i * 2, p + i * 2 + 1);
+            keep(p[0]);
+        });
+
+        add("math/norm2D/4096", count, [points]()
+        {
+            float* p = points->data();
+            for (uint i = 0; i < count; i++)
+                vi::math::norm2D(p[i * 2] + 1, p[i * 2 + 1] + 1, p + i * 2, p + i * 2 + 1);
+            keep(p[0]);
+        });
+    }
+
+    void addMemory()
+    {
+        const uint count = 1000;
+
+        add("memory/alloctrack/untracked/alloc+free", 1, []()
+        {
+            vi::memory::alloctrack a = {};
+            byte* block = a.alloc<byte>(64);
+            keep(block);
+            a.free(block);
+        });
+
+        // tracked free searches the list from the front so order matters
+        auto fifo = std::make_shared<vi::memory::alloctrack>();
+        fifo->track = true;
+        add("memory/alloctrack/tracked/fifo/1000", count, [fifo]()
+        {
+            void* blocks[count];
+            for (uint i = 0; i < count; i++) blocks[i] = fifo->alloc<byte>(64);
+            for (uint i = 0; i < count; i++) fifo->free(blocks[i]);
+        });
+
+        auto lifo = std::make_shared<vi::memory::alloctrack>();
+        lifo->track = true;
+        add("memory/alloctrack/tracked/lifo/1000", count, [lifo]()
+        {
+            void* blocks[count];
+            for (uint i = 0; i < count; i++) blocks[i] = lifo->alloc<byte>(64);
+            for (uint i = count; i > 0; i--) lifo->free(blocks[i - 1]);
+        });
+    }
+
+    void addRoutines(uint count)
+    {
+        struct state
+        {
+            vi::time::virtualClock clock;
+            vi::time::timer timer;
+            vi::fn::queue queue;
+            std::vector<vi::fn::routine> routines;
+            unsigned long long calls;
+        };
+
+        auto s = std::make_shared<state>();
+        s->clock.init();
+        s->timer.init(&s->clock);
+        s->queue.init(&s->timer);
+        s->routines.resize(count);
+        s->calls = 0;
+        state* raw = s.get();
+
+        // intervals spread from one frame to one second so some routines run every update
+        for (uint i = 0; i < count; i++)
+            s->queue.initRoutine(&s->routines[i], [raw]() { raw->calls++; return 1; }, 0, (i % 60 + 1) / 60.0f, 1e9f);
+
+        add("fn/queue/update/" + std::to_string(count), count, [s]()
+        {
+            s->clock.advance(1 / 60.0);
+            s->timer.update();
+            s->queue.update(s->routines.data(), (uint)s->routines.size());
+            keep(s->calls);
+        });
+    }
+
+    // one frame of typing with a key held, as it comes from the window message pump
+    void addKeyboard()
+    {
+        auto k = std::make_shared<vi::input::keyboard>();
+        k->init();
+
+        add("input/keyboard/update/16events", 16, [k]()
+        {
+            vi::system::inputEventCount = 0;
+            vi::system::pushInputEvent(vi::system::inputEventType::KeyDown, 160);
+
+            for (int i = 0; i < 7; i++)
+            {
+                vi::system::pushInputEvent(vi::system::inputEventType::KeyDown, 'A' + i);
+                vi::system::pushInputEvent(vi::system::inputEventType::Char, 'A' + i);
+            }
+
+            vi::system::pushInputEvent(vi::system::inputEventType::KeyUp, 160);
+            k->update();
+            keep(k->isKeyPressed('A') + k->isKeyReleased(16));
+        });
+    }
+
+    // finding the sender of every datagram on a server with 'count' peers
+    void addConnections(uint count)
+    {
+        struct state
+        {
+            vi::net::connectionTable table;
+            std::vector<vi::net::endpoint> endpoints;
+
+            ~state()
+            {
+                this->table.destroy();
+            }
+        };
+
+        auto s = std::make_shared<state>();
+        s->table.init(count, 10000);
+        s->endpoints.resize(count);
+        vi::util::rng rng;
+        rng.init(0, 0x7fffffff);
+
+        for (uint i = 0; i < count; i++)
+        {
+            vi::net::endpoint* ep = &s->endpoints[i];
+            vi::util::zero(ep);
+            ep->address.sin_family = AF_INET;
+            ep->address.sin_addr.s_addr = (uint)rng.rnd();
+            ep->address.sin_port = (ushort)rng.rnd();
+            s->table.connect(ep, 1);
+        }
+
+        add("net/connections/find/" + std::to_string(count), count, [s, count]()
+        {
+            uint found = 0;
+            for (uint i = 0; i < count; i++) found += s->table.find(&s->endpoints[i]) != nullptr;
+            keep(found);
+        });
+    }
+
+    // one server tick of 'count' sprites where a tenth moved since the acked baseline
+    // 'full' encodes without baseline, like the first snapshot a client gets
+    void addSnapshots(uint count)
+    {
+        struct state
+        {
+            vi::net::snapshotSchema schema;
+            vi::net::snapshotHistory server;
+            vi::net::snapshotHistory client;
+            vi::net::snapshot* baseline;
+            vi::net::snapshot* current;
+            std::vector<byte> deltaPacket;
+            std::vector<byte> fullPacket;
+            uint deltaSize;
+            uint fullSize;
+
+            ~state()
+            {
+                this->server.destroy();
+                this->client.destroy();
+            }
+        };
+
+        auto s = std::make_shared<state>();
+        s->schema.initSprite();
+        s->server.init(&s->schema, count);
+        s->client.init(&s->schema, count);
+        vi::util::rng rng;
+        rng.init(0, 1000);
+        std::vector<float> fields((size_t)count * vi::net::NET_SNAPSHOT_FIELDS);
+
+        for (uint i = 0; i < count; i++)
+        {
+            float* f = &fields[(size_t)i * vi::net::NET_SNAPSHOT_FIELDS];
+            f[0] = rng.rnd() / 1000.0f * 2 - 1;
+            f[1] = rng.rnd() / 1000.0f * 2 - 1;
+            f[3] = f[4] = 1;
+            f[5] = rng.rnd() / 1000.0f * 6.28f;
+            f[10] = f[11] = 1;
+            for (uint c = 12; c < 16; c++) f[c] = 1;
+        }
+
+        s->baseline = s->server.begin(1, count);
+        for (uint i = 0; i < count; i++) s->server.capture(s->baseline, i, &fields[(size_t)i * vi::net::NET_SNAPSHOT_FIELDS]);
+
+        for (uint i = 0; i < count; i += 10)
+        {
+            fields[(size_t)i * vi::net::NET_SNAPSHOT_FIELDS] += 0.01f;
+            fields[(size_t)i * vi::net::NET_SNAPSHOT_FIELDS + 5] += 0.05f;
+        }
+
+        s->current = s->server.begin(2, count);
+        for (uint i = 0; i < count; i++) s->server.capture(s->current, i, &fields[(size_t)i * vi::net::NET_SNAPSHOT_FIELDS]);
+
+        uint capacity = count * vi::net::NET_SNAPSHOT_FIELDS * 4 + 64;
+        s->deltaPacket.resize(capacity);
+        s->fullPacket.resize(capacity);
+        s->deltaSize = vi::net::encodeSnapshot(&s->schema, s->current, s->baseline, s->deltaPacket.data(), capacity);
+        s->fullSize = vi::net::encodeSnapshot(&s->schema, s->baseline, nullptr, s->fullPacket.data(), capacity);
+        // client has the baseline already
+        vi::net::decodeSnapshot(&s->client, s->fullPacket.data(), s->fullSize);
+        printf("snapshot of %u sprites: raw %u bytes, full %u bytes, delta %u bytes\n",
+            count, count * vi::net::NET_SNAPSHOT_FIELDS * 4, s->fullSize, s->deltaSize);
+
+        add("net/snapshot/encode/delta/" + std::to_string(count), count, [s, capacity]()
+        {
+            keep(vi::net::encodeSnapshot(&s->schema, s->current, s->baseline, s->deltaPacket.data(), capacity));
+        });
+
+        add("net/snapshot/encode/full/" + std::to_string(count), count, [s, capacity]()
+        {
+            keep(vi::net::encodeSnapshot(&s->schema, s->baseline, nullptr, s->fullPacket.data(), capacity));
+        });
+
+        add("net/snapshot/decode/delta/" + std::to_string(count), count, [s]()
+        {
+            keep(vi::net::decodeSnapshot(&s->client, s->deltaPacket.data(), s->deltaSize));
+        });
+
+        add("net/snapshot/decode/full/" + std::to_string(count), count, [s]()
+        {
+            keep(vi::net::decodeSnapshot(&s->client, s->fullPacket.data(), s->fullSize));
+        });
+    }
+
+    // one tick of 'clients' players each bringing 20 entities into a world that grows with them,
+    // everything moves a little, time is per client
+    void addInterest(uint clients)
+    {
+        struct state
+        {
+            vi::net::interestGrid grid;
+            std::vector<float> positions;
+            uint tick;
+        };
+
+        auto s = std::make_shared<state>();
+        uint entities = clients * 20;
+        float half = sqrtf((float)clients) * 10;
+        s->grid.init(-half, -half, half, half, 2, entities, clients);
+        s->positions.resize(entities * 2);
+        s->tick = 0;
+        vi::util::rng rng;
+        rng.init(0, 10000);
+
+        for (uint i = 0; i < entities * 2; i++) s->positions[i] = (rng.rnd() / 5000.0f - 1) * half;
+
+        for (uint c = 0; c < clients; c++)
+            s->grid.setView(c, s->positions[c * 40], s->positions[c * 40 + 1], 1.78f * 3, 3);
+
+        add("net/interest/update/" + std::to_string(clients), clients, [s, entities, clients]()
+        {
+            float d = (s->tick++ & 32) ? 0.05f : -0.05f;
+
+            for (uint e = 0; e < entities; e++)
+                s->grid.setEntity(e, s->positions[e * 2] += d, s->positions[e * 2 + 1]);
+
+            s->grid.update();
+            keep(s->grid.events.size());
+        });
+    }
+
+#ifdef _WIN32
+    struct sprites
+    {
+        vi::time::virtualClock clock;
+        vi::time::timer timer;
+        vi::gl::texture texture;
+        std::vector<vi::gl::sprite> sprites;
+        std::vector<vi::gl::animation> animations;
+        std::vector<vi::gl::dynamic> dynamics;
+        vi::gl::uv frames[4];
+
+        void init(uint count)
+        {
+            this->clock.init();
+            this->timer.init(&this->clock);
+            vi::util::zero(&this->texture);
+            this->sprites.resize(count);
+            for (uint i = 0; i < count; i++) this->sprites[i].init(&this->texture);
+
+            for (uint i = 0; i < 4; i++) this->frames[i] = { i * 0.25f, 0, i * 0.25f + 0.25f, 1 };
+        }
+    };
+
+    void addAnimations(uint count)
+    {
+        auto s = std::make_shared<sprites>();
+        s->init(count);
+        s->animations.resize(count);
+
+        for (uint i = 0; i < count; i++)
+        {
+            s->animations[i].init(&s->sprites[i], &s->timer, s->frames, 4, 0.1f, 0);
+            s->animations[i].play();
+        }
+
+        add("gl/animation/update/" + std::to_string(count), count, [s]()
+        {
+            s->clock.advance(1 / 60.0);
+            s->timer.update();
+            for (uint i = 0; i < s->animations.size(); i++) s->animations[i].update();
+            keep(s->sprites[0].s2.uv1);
+        });
+    }
+
+    void addDynamics(uint count)
+    {
+        auto s = std::make_shared<sprites>();
+        s->init(count);
+        s->dynamics.resize(count);
+
+        for (uint i = 0; i < count; i++)
+        {
+            vi::util::zero(&s->dynamics[i]);
+            s->dynamics[i].init(&s->sprites[i], &s->timer);
+            s->dynamics[i].velx = 0.1f;
+            s->dynamics[i].velrot = 1;
+        }
+
+        add("gl/dynamic/update/" + std::to_string(count), count, [s]()
+        {
+            s->clock.advance(1 / 60.0);
+            s->timer.update();
+            for (uint i = 0; i < s->dynamics.size(); i++) s->dynamics[i].update();
+            keep(s->sprites[0].s1.x);
+        });
+    }
+
+    void addText(uint capacity)
+    {
+        struct state
+        {
+            vi::gl::texture texture;
+            vi::gl::font font;
+            std::vector<vi::gl::sprite> sprites;
+            std::vector<char> str;
+            vi::gl::text text;
+        };
+
+        auto s = std::make_shared<state>();
+        vi::util::zero(&s->texture);
+        vi::util::zero(&s->font);
+        s->font.tex = &s->texture;
+        s->sprites.resize(capacity);
+        s->str.resize(capacity);
+
+        // printable characters with a new line every 40
+        for (uint i = 0; i + 1 < capacity; i++) s->str[i] = i % 40 == 39 ? '\n' : ' ' + i % 95;
+        s->str[capacity - 1] = 0;
+        s->text.init(&s->font, s->sprites.data(), capacity, s->str.data());
+
+        add("gl/text/update/" + std::to_string(capacity), capacity, [s]()
+        {
+            s->text.update();
+            keep(s->sprites[1].s1.x);
+        });
+    }
+
+    void addRenderer()
+    {
+        struct state
+        {
+            vi::system::window window;
+            vi::gl::renderer renderer;
+            vi::gl::texture texture;
+            std::vector<vi::gl::sprite> sprites;
+            vi::gl::uv uv[64];
+        };
+
+        const uint count = 10000;
+        auto s = std::make_shared<state>();
+        vi::util::zero(&s->window);
+        s->window.width = 960;
+        s->window.height = 540;
+        vi::gl::rendererInfo info = {};
+        info.wnd = &s->window;
+        info.headless = true;
+        s->renderer.init(&info);
+        vi::util::zero(&s->texture);
+        s->sprites.resize(count);
+        for (uint i = 0; i < count; i++) s->sprites[i].init(&s->texture);
+
+        add("gl/uvSplit/64", 64, [s]()
+        {
+            vi::gl::uvSplitInfo usi = { 512, 512, 0, 0, 16, 16, 8, 64 };
+            s->renderer.uvSplit(&usi, s->uv);
+            keep(s->uv[63]);
+        });
+
+        // everything drawSprite does on the CPU side, device calls are skipped by headless renderer
+        add("gl/renderer/drawSprite/10000", count, [s]()
+        {
+            s->renderer.beginScene();
+            for (uint i = 0; i < count; i++) s->renderer.drawSprite(&s->sprites[i]);
+            s->renderer.endScene();
+        });
+    }
+#endif
+
+    void addAll()
+    {
+        addMath();
+        addMemory();
+        addRoutines(1000);
+        addRoutines(10000);
+        addKeyboard();
+        addConnections(100);
+        addConnections(10000);
+        addSnapshots(500);
+        addSnapshots(10000);
+        addInterest(50);
+        addInterest(500);
+#ifdef _WIN32
+        for (uint count = 10000; count <= 1000000; count *= 10)
+        {
+            addAnimations(count);
+            addDynamics(count);
+        }
+
+        addText(100);
+        addText(1000);
+        addText(10000);
+        addRenderer();
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    microbench::options o = { 15, 3, 0.01, -1, nullptr, nullptr, nullptr, nullptr };
+    vi::perf::group counters;
+    bool useCounters = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) o.repetitions = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) o.warmup = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) o.minSampleSec = atof(argv[++i]) / 1000;
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) o.cpu = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0) useCounters = true;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) o.jsonFile = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) o.csvFile = argv[++i];
+        else if (argv[i][0] == '-')
+        {
+            fprintf(stderr, "usage: microbench [-r repetitions] [-w warmup] [-t minSampleMs] [-c cpu] [-p] "
+                "[-j out.json] [-o out.csv] [filter]\n");
+            return 1;
+        }
+        else o.filter = argv[i];
+    }
+
+    if (o.repetitions == 0) o.repetitions = 1;
+
+    if (o.cpu >= 0 && !microbench::pin(o.cpu))
+        fprintf(stderr, "could not pin to cpu %d, running unpinned\n", o.cpu);
+
+    // opened after pinning, counters follow the thread anyway
+    if (useCounters)
+    {
+        if (counters.open()) o.counters = &counters;
+        else fprintf(stderr, "%s, running without hardware counters\n", counters.error);
+    }
+
+    microbench::addAll();
+    std::vector<microbench::result> results;
+
+    printf("%-44s %12s %12s %12s %12s", "benchmark", "median ns", "mean ns", "stddev", "min ns");
+    if (o.counters) printf(" %6s %12s %12s", "IPC", "cacheMiss", "branchMiss");
+    printf("\n");
+
+    for (uint i = 0; i < microbench::benchmarks.size(); i++)
+    {
+        const microbench::benchmark* b = &microbench::benchmarks[i];
+        if (o.filter && !strstr(b->name.c_str(), o.filter)) continue;
+
+        results.emplace_back();
+        microbench::result* r = &results.back();
+        microbench::measure(b, &o, r);
+        printf("%-44s %12.3f %12.3f %12.3f %12.3f", b->name.c_str(), r->median, r->mean, r->stddev, r->min);
+
+        if (o.counters)
+        {
+            vi::perf::sample* c = &r->counters;
+            double ipc = c->valid[vi::perf::INSTRUCTIONS] && c->values[vi::perf::CYCLES] ?
+                (double)c->values[vi::perf::INSTRUCTIONS] / c->values[vi::perf::CYCLES] : 0;
+            printf(" %6.2f %12.4f %12.4f", ipc, c->values[vi::perf::CACHE_MISSES] / r->countedItems,
+                c->values[vi::perf::BRANCH_MISSES] / r->countedItems);
+        }
+
+        printf("\n");
+    }
+
+    if (o.counters) counters.close();
+
+    if (o.jsonFile && !microbench::writeJSON(o.jsonFile, &o, results))
+    {
+        fprintf(stderr, "could not write %s\n", o.jsonFile);
+        return 1;
+    }
+
+    if (o.csvFile && !microbench::writeCSV(o.csvFile, results))
+    {
+        fprintf(stderr, "could not write %s\n", o.csvFile);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,507 @@
+// UDP throughput of vi::net over loopback, separate program from test.cpp
+// sender threads flood the server, the server counts what it gets per second
+//
+// usage:  netbench [-m single|batch|uring|thread|shard|reliable] [-n packets] [-s size] [-c senders] [-p port]
+//                  [-k shards] [-l loss]
+//         -m single receives with one call per datagram, batch (default) with receiveBatch
+//            and senders use queueSend/flush, so both sides of the batching are measured
+//            uring is batch with the server on io_uring transport
+//            thread runs the server on netThread and drains it like a 60 Hz game loop would,
+//            latency is from arrival to drain
+//            shard runs shardedServer with -k sockets on the port (default 4), each on its own core,
+//            senders are spread by the kernel hash so use at least as many senders as shards (Linux)
+//            reliable is a check more than a benchmark, -n messages go on a reliable ordered channel
+//            through a link that loses -l percent (default 10), reorders and doubles datagrams
+//            in both directions, every 50th message is fragmented and kept a while by the receiver
+//            so reassembly also waits for message buffers, exit code is 1 if one is missing,
+//            doubled, out of order or corrupt, -c is ignored
+//         -n datagrams per sender (default 1000000), -s payload bytes (default 64)
+//         received count is below sent count when the kernel drops, pps is what got through
+// Linux:  g++ -O2 -std=c++17 netbench.cpp -o netbench -lpthread
+
+#include "viva_impl.h"
+#include <chrono>
+
+namespace netbench
+{
+    struct options
+    {
+        bool batch;
+        bool thread;
+        bool shard;
+        vi::net::transport transport;
+        uint packets;
+        uint size;
+        uint senders;
+        ushort port;
+        uint shards;
+        bool reliable;
+        uint loss;
+    };
+
+    std::atomic<uint> sendersDone;
+
+    void send(const options* o)
+    {
+        vi::net::client c;
+        c.init("127.0.0.1", o->port);
+        byte payload[vi::net::NET_PACKET_SIZE] = {};
+
+        for (uint i = 0; i < o->packets; i++)
+        {
+            memcpy(payload, &i, sizeof(i));
+
+            if (o->batch)
+            {
+                // socket buffer full, wait for room instead of dropping
+                while (c.outgoing.count == vi::net::NET_BATCH_SIZE && c.flush() == 0) std::this_thread::yield();
+                c.queueSend(payload, o->size);
+            }
+            else
+            {
+                // retry so single and batch senders put the same load on the receiver
+                while (!c.send(payload, o->size)) std::this_thread::yield();
+            }
+        }
+
+        while (c.outgoing.count > 0)
+            c.flush();
+
+        c.destroyClient();
+        sendersDone.fetch_add(1);
+    }
+
+    // game thread side of netThread, sleeps a frame whenever it finds nothing
+    int runThread(const options* o)
+    {
+        vi::net::netThread t;
+        if (!t.initServer(o->port, 8192, o->transport))
+        {
+            fprintf(stderr, "could not open port %u\n", o->port);
+            t.destroy();
+            return 1;
+        }
+
+        std::vector<std::thread> threads;
+        for (uint i = 0; i < o->senders; i++) threads.emplace_back(send, o);
+
+        vi::net::packetBuffer* packets[256];
+        unsigned long long received = 0, bytes = 0;
+        long long latencyNs = 0, maxLatencyNs = 0;
+        long long start = vi::time::nowNs();
+        long long last = start;
+
+        while (true)
+        {
+            uint n = t.drain(packets, 256);
+            long long now = vi::time::nowNs();
+
+            for (uint i = 0; i < n; i++)
+            {
+                long long latency = now - packets[i]->timeNs;
+                latencyNs += latency;
+                if (latency > maxLatencyNs) maxLatencyNs = latency;
+                bytes += packets[i]->len;
+                packets[i]->release();
+            }
+
+            if (n > 0)
+            {
+                received += n;
+                last = now;
+                continue;
+            }
+
+            if (sendersDone.load() == o->senders && now - last > 100000000)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        }
+
+        for (uint i = 0; i < threads.size(); i++) threads[i].join();
+
+        double seconds = (last - start) / (double)vi::time::NS_PER_SEC;
+        unsigned long long sent = (unsigned long long)o->packets * o->senders;
+
+        printf("thread: received %llu of %llu (%.1f%%) in %.3f s, %.0f packets/s, %.1f MB/s, "
+            "latency mean %.3f ms max %.3f ms, dropped on full ring %llu\n",
+            received, sent, 100.0 * received / sent, seconds, received / seconds, bytes / seconds / 1e6,
+            received ? latencyNs / 1e6 / received : 0.0, maxLatencyNs / 1e6, t.dropped.load());
+
+        t.destroy();
+        return 0;
+    }
+
+    // lossy side of the loopback for the reliable check, works in ticks of a simulated clock
+    struct lossyLink
+    {
+        std::mt19937 random;
+        uint loss;
+        // datagrams held back until a later tick, they overtake the ones sent meanwhile
+        std::vector<std::pair<unsigned long long, vi::net::packetBuffer*>> held;
+        unsigned long long sent;
+
+        // takes everything queued on 'c', survivors go to 'out' now or a few ticks later
+        void transmit(vi::net::connection* c, unsigned long long tick, const std::function<void(vi::net::packetBuffer*)>& out)
+        {
+            while (vi::net::packetBuffer* b = c->dequeue())
+            {
+                this->sent++;
+                uint roll = this->random() % 100;
+
+                if (roll < this->loss)
+                {
+                    b->release();
+                    continue;
+                }
+
+                // 1 in 100 comes twice, 1 in 10 comes late
+                if (roll == 99)
+                {
+                    b->retain();
+                    this->held.push_back({ tick + 1 + this->random() % 5, b });
+                }
+
+                if (roll % 10 == 3)
+                {
+                    this->held.push_back({ tick + 1 + this->random() % 5, b });
+                    continue;
+                }
+
+                out(b);
+                b->release();
+            }
+
+            for (size_t i = 0; i < this->held.size();)
+            {
+                if (this->held[i].first > tick)
+                {
+                    i++;
+                    continue;
+                }
+
+                out(this->held[i].second);
+                this->held[i].second->release();
+                this->held[i] = this->held.back();
+                this->held.pop_back();
+            }
+        }
+
+        void destroy()
+        {
+            for (size_t i = 0; i < this->held.size(); i++) this->held[i].second->release();
+            this->held.clear();
+        }
+    };
+
+    // message 'i' is its number and bytes that depend on it, big ones are fragmented
+    uint fillMessage(byte* data, uint i, uint size)
+    {
+        uint len = i % 50 == 49 ? 3 * vi::net::NET_FRAGMENT_SIZE + 100 : size;
+        memcpy(data, &i, sizeof(i));
+        for (uint k = sizeof(i); k < len; k++) data[k] = (byte)(k * 31 + i);
+        return len;
+    }
+
+    // both ends in one thread on a simulated clock of 1 ms ticks, only the sockets are real
+    int runReliable(const options* o)
+    {
+        using namespace vi::net;
+
+        initNetwork();
+        server srv;
+        client cli;
+        srv.init(o->port);
+        cli.init("127.0.0.1", o->port);
+
+        if (srv.s == INVALID_SOCKET || cli.s == INVALID_SOCKET)
+        {
+            fprintf(stderr, "could not open port %u\n", o->port);
+            return 1;
+        }
+
+        packetPool pool, messagePool;
+        pool.init(4096);
+        // the receiver holds both at times, then reassembly has to wait
+        messagePool.init(2, NET_MAX_MESSAGE_SIZE);
+        channelType types[] = { channelType::ReliableOrdered };
+        connection sender = {}, receiver = {};
+        reliability out, in;
+        out.init(&pool, &messagePool, types, 1);
+        in.init(&pool, &messagePool, types, 1);
+
+        lossyLink toServer = { std::mt19937(1), o->loss, {}, 0 };
+        lossyLink toClient = { std::mt19937(2), o->loss, {}, 0 };
+        message messages[256];
+        std::vector<byte> data(NET_MAX_MESSAGE_SIZE), expected(NET_MAX_MESSAGE_SIZE);
+        endpoint from = {};
+        packetBuffer* held[2] = {};
+        unsigned long long heldUntil = 0;
+        uint queued = 0, delivered = 0, bad = 0;
+        long long start = vi::time::nowNs();
+        long long now = start;
+        unsigned long long tick = 0, lastProgress = 0;
+
+        auto check = [&](uint n)
+        {
+            for (uint i = 0; i < n; i++)
+            {
+                message* m = &messages[i];
+                uint len = fillMessage(expected.data(), delivered, o->size);
+                if (m->len != len || memcmp(m->data, expected.data(), len) != 0) bad++;
+                delivered++;
+                lastProgress = tick;
+
+                // receiver keeps big messages a few ticks, like a level it's still loading
+                uint slot = held[0] ? 1 : 0;
+
+                if (m->len > NET_MESSAGE_SIZE && !held[slot])
+                {
+                    held[slot] = m->buffer;
+                    heldUntil = tick + 5;
+                }
+                else m->buffer->release();
+            }
+        };
+
+        auto toSocket = [&cli](packetBuffer* b) { while (!cli.send(b->getData(), b->len)) std::this_thread::yield(); };
+        auto toClientSocket = [&srv, &from](packetBuffer* b) { while (!srv.send(b->getData(), b->len, &from)) std::this_thread::yield(); };
+
+        // gives up when nothing is delivered for a simulated minute, resends back off to a second
+        // and at high loss acks of a whole window can take a few rounds
+        for (; delivered < o->packets && tick - lastProgress < 60000; tick++)
+        {
+            now += 1000000;
+
+            // as much as the window takes, a message goes once it's accepted
+            while (queued < o->packets && queued - delivered < 1000)
+            {
+                uint len = fillMessage(data.data(), queued, o->size);
+                if (!out.send(&sender, 0, data.data(), len, now)) break;
+                queued++;
+            }
+
+            out.update(&sender, now);
+            toServer.transmit(&sender, tick, toSocket);
+
+            // a new buffer every time, messages that wait for a missing one keep referencing theirs
+            packetBuffer* b;
+            while ((b = pool.allocate()) && (b->len = srv.receive(b->getData(), NET_PACKET_SIZE, &from)) > 0)
+            {
+                check(in.receive(&receiver, b, now, messages, 256));
+                b->release();
+            }
+
+            if (b) b->release();
+
+            if (held[0] && tick >= heldUntil)
+            {
+                for (uint i = 0; i < 2; i++)
+                    if (held[i]) held[i]->release();
+
+                held[0] = held[1] = nullptr;
+                // what waited for a message buffer is acked already, nothing else comes to retry it
+                uint n = 0;
+                in.deliverPending(messages, &n, 256);
+                check(n);
+            }
+
+            in.update(&receiver, now);
+            toClient.transmit(&receiver, tick, toClientSocket);
+
+            while ((b = pool.allocate()) && (b->len = cli.receive(b->getData(), NET_PACKET_SIZE)) > 0)
+            {
+                out.receive(&sender, b, now, messages, 256);
+                b->release();
+            }
+
+            if (b) b->release();
+        }
+
+        double seconds = (vi::time::nowNs() - start) / (double)vi::time::NS_PER_SEC;
+        printf("reliable: delivered %u of %u in order, %u bad, %.0f messages/s, %u%% loss, "
+            "%llu datagrams out %llu back, %llu resends, %llu ticks\n",
+            delivered, o->packets, bad, delivered / seconds, o->loss, toServer.sent, toClient.sent,
+            sender.stats.resends, tick);
+
+        for (uint i = 0; i < 2; i++)
+            if (held[i]) held[i]->release();
+
+        toServer.destroy();
+        toClient.destroy();
+        out.destroy();
+        in.destroy();
+        messagePool.destroy();
+        pool.destroy();
+        cli.destroyClient();
+        srv.destroyServer();
+        uninitNetwork();
+        return delivered == o->packets && bad == 0 ? 0 : 1;
+    }
+
+#ifdef __linux__
+    // every shard receives and counts on its own core, nothing is shared until the end
+    int runShard(const options* o)
+    {
+        vi::net::initNetwork();
+        vi::net::shardedServer ss;
+
+        if (!ss.init(o->port, o->shards, vi::net::shardSteering::Hash, 1024, 1024, 5000))
+        {
+            fprintf(stderr, "could not open %u sockets on port %u\n", o->shards, o->port);
+            ss.destroy();
+            return 1;
+        }
+
+        std::vector<unsigned long long> bytes(o->shards * 8);
+        std::atomic<long long> last(0);
+        // shards write their own cache line
+        ss.onPacket = [&bytes, &last](vi::net::shard* s, vi::net::connection*, vi::net::packetBuffer* b)
+        {
+            bytes[s->index * 8] += b->len;
+            last.store(b->timeNs, std::memory_order_relaxed);
+        };
+        ss.start();
+
+        std::vector<std::thread> threads;
+        long long start = vi::time::nowNs();
+        for (uint i = 0; i < o->senders; i++) threads.emplace_back(send, o);
+        for (uint i = 0; i < threads.size(); i++) threads[i].join();
+
+        unsigned long long received = 0;
+
+        while (true)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            unsigned long long now = ss.getReceived();
+            if (now == received) break;
+            received = now;
+        }
+
+        ss.destroy();
+        vi::net::uninitNetwork();
+
+        unsigned long long total = 0;
+        for (uint i = 0; i < o->shards; i++) total += bytes[i * 8];
+        double seconds = (last.load() - start) / (double)vi::time::NS_PER_SEC;
+        unsigned long long sent = (unsigned long long)o->packets * o->senders;
+
+        printf("shard: received %llu of %llu (%.1f%%) in %.3f s, %.0f packets/s, %.1f MB/s on %u shards\n",
+            received, sent, 100.0 * received / sent, seconds, received / seconds, total / seconds / 1e6, o->shards);
+        return 0;
+    }
+#endif
+
+    int run(const options* o)
+    {
+        vi::net::initNetwork();
+        vi::net::server s;
+        s.init(o->port, o->transport);
+
+        if (s.s == vi::net::INVALID_SOCKET)
+        {
+            fprintf(stderr, "could not open port %u\n", o->port);
+            return 1;
+        }
+
+        vi::net::batch b;
+        b.init();
+        vi::net::endpoint ep;
+        byte data[vi::net::NET_PACKET_SIZE];
+        unsigned long long received = 0, bytes = 0, calls = 0;
+
+        std::vector<std::thread> threads;
+        for (uint i = 0; i < o->senders; i++) threads.emplace_back(send, o);
+
+        long long start = vi::time::nowNs();
+        long long last = start;
+
+        // stop when senders are done and nothing came for 100 ms
+        while (true)
+        {
+            uint n = 0;
+
+            if (o->batch)
+            {
+                n = s.receiveBatch(&b);
+                for (uint i = 0; i < n; i++) bytes += b.lengths[i];
+            }
+            else
+            {
+                uint len = s.receive(data, sizeof(data), &ep);
+                n = len > 0;
+                bytes += len;
+            }
+
+            calls++;
+
+            if (n > 0)
+            {
+                received += n;
+                last = vi::time::nowNs();
+                continue;
+            }
+
+            if (sendersDone.load() == o->senders && vi::time::nowNs() - last > 100000000)
+                break;
+
+            s.wait(10);
+        }
+
+        for (uint i = 0; i < threads.size(); i++) threads[i].join();
+
+        double seconds = (last - start) / (double)vi::time::NS_PER_SEC;
+        unsigned long long sent = (unsigned long long)o->packets * o->senders;
+
+        const char* mode = s.active == vi::net::transport::Uring ? "uring" : o->batch ? "batch" : "single";
+        printf("%s: received %llu of %llu (%.1f%%) in %.3f s, %.0f packets/s, %.1f MB/s, %.2f packets per call\n",
+            mode, received, sent, 100.0 * received / sent, seconds,
+            received / seconds, bytes / seconds / 1e6, received / (double)calls);
+
+        b.destroy();
+        s.destroyServer();
+        vi::net::uninitNetwork();
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    netbench::options o = { true, false, false, vi::net::transport::Sockets, 1000000, 64, 2, 10500, 4, false, 10 };
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+        {
+            i++;
+            o.batch = strcmp(argv[i], "single") != 0;
+            if (strcmp(argv[i], "uring") == 0) o.transport = vi::net::transport::Uring;
+            if (strcmp(argv[i], "thread") == 0) o.thread = true;
+            if (strcmp(argv[i], "shard") == 0) o.shard = true;
+            if (strcmp(argv[i], "reliable") == 0) o.reliable = true;
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) o.packets = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) o.size = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) o.senders = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) o.port = (ushort)atoi(argv[++i]);
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) o.shards = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) o.loss = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "usage: netbench [-m single|batch|uring|thread|shard|reliable] [-n packets] [-s size] [-c senders] [-p port] [-k shards] [-l loss]\n");
+            return 1;
+        }
+    }
+
+    if (o.size < sizeof(uint) || o.size > vi::net::NET_PACKET_SIZE || o.senders == 0 || o.shards == 0)
+    {
+        fprintf(stderr, "size must be 4 to %u bytes and there must be a sender and a shard\n", vi::net::NET_PACKET_SIZE);
+        return 1;
+    }
+
+    if (o.reliable) return netbench::runReliable(&o);
+#ifdef __linux__
+    if (o.shard) return netbench::runShard(&o);
+#endif
+    return o.thread ? netbench::runThread(&o) : netbench::run(&o);
+}
@@ -0,0 +1,103 @@
+// Conformance check and timing of vi::png::decoder against stb_image
+// every file must decode to the same RGBA8 pixels as stb, exit code is 1 otherwise
+//
+// usage:  pngcheck [-n repeats] file1.png file2.png ...
+//         e.g. pngcheck textures/*.png textures/conformance/*.png
+//         conformance has every color type (gray, gray+alpha, RGB, RGBA, palette with tRNS),
+//         each filter on its own, widths 1 to 64 and IDAT split into 1 to 3 chunks
+// Linux:  g++ -O2 -std=c++17 pngcheck.cpp -o pngcheck -lpthread
+
+#include "viva_impl.h"
+#include <chrono>
+
+namespace pngcheck
+{
+    double now()
+    {
+        using namespace std::chrono;
+        return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int repeats = 1;
+    int first = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-n") == 0)
+    {
+        repeats = atoi(argv[2]);
+        first = 3;
+    }
+
+    if (first >= argc)
+    {
+        fprintf(stderr, "usage: pngcheck [-n repeats] files...\n");
+        return 1;
+    }
+
+    vi::png::decoder d;
+    std::vector<byte> pixels;
+    int failed = 0;
+    double stbTotal = 0, viTotal = 0;
+
+    for (int i = first; i < argc; i++)
+    {
+        vi::system::mappedFile f;
+
+        if (!f.open(argv[i]))
+        {
+            printf("FAIL %s: could not open\n", argv[i]);
+            failed++;
+            continue;
+        }
+
+        uint w, h;
+        byte type;
+
+        if (!vi::png::getInfo(f.data, f.size, &w, &h, &type))
+        {
+            printf("SKIP %s: not handled by vi::png, stb is used\n", argv[i]);
+            f.close();
+            continue;
+        }
+
+        int x, y, n;
+        byte* expected = nullptr;
+        double start = pngcheck::now();
+
+        for (int r = 0; r < repeats; r++)
+        {
+            stbi_image_free(expected);
+            expected = stbi_load_from_memory(f.data, (int)f.size, &x, &y, &n, 4);
+        }
+
+        double stbMs = (pngcheck::now() - start) / repeats;
+        pixels.resize((size_t)w * h * 4);
+        bool ok = true;
+        start = pngcheck::now();
+
+        for (int r = 0; r < repeats; r++)
+            ok = ok && d.decode(f.data, f.size, pixels.data(), pixels.size());
+
+        double viMs = (pngcheck::now() - start) / repeats;
+
+        if (!expected || !ok || x != (int)w || y != (int)h || memcmp(expected, pixels.data(), pixels.size()) != 0)
+        {
+            printf("FAIL %s: %s\n", argv[i], ok ? "pixels differ from stb" : "decode failed");
+            failed++;
+        }
+        else
+        {
+            printf("OK   %s %ux%u type %d  stb %.3f ms  vi %.3f ms\n", argv[i], w, h, type, stbMs, viMs);
+            stbTotal += stbMs;
+            viTotal += viMs;
+        }
+
+        stbi_image_free(expected);
+        f.close();
+    }
+
+    printf("total stb %.3f ms  vi %.3f ms  failed %d\n", stbTotal, viTotal, failed);
+    return failed ? 1 : 0;
+}
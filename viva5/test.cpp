@@ -94,12 +94,216 @@ namespace examples
         }
     };
 
+    // When 'active' every example runs headless for 'frames' frames on a virtual clock
+    // and without input, or with input replayed from a log, so runs are repeatable, see bench.cpp. Examples create window,
+    // renderer, timer and poll input through functions below instead of directly.
+    struct benchmark
+    {
+        bool active;
+        uint frames;
+        // frames finished in the current example
+        uint frame;
+        // virtual seconds per frame
+        double step;
+        vi::time::virtualClock clock;
+        // real time spent per frame
+        vi::time::frameStats stats;
+        long long frameStart;
+        vi::gl::renderer* renderer;
+        // sum of renderer counters over all frames
+        vi::gl::renderCounters total;
+        // called at every frame boundary, before the first frame too
+        std::function<void()> onFrame;
+
+        void beginScene()
+        {
+            this->frame = 0;
+            this->renderer = nullptr;
+            this->clock.init();
+            this->stats.init(this->frames, this->step);
+            vi::util::zero(&this->total);
+        }
+
+        void endFrame()
+        {
+            this->stats.add(vi::time::nowNs() - this->frameStart);
+            vi::gl::renderCounters* c = this->renderer ? this->renderer->getFrameCounters() : nullptr;
+            if (!c) return;
+
+            this->total.drawCalls += c->drawCalls;
+            this->total.instances += c->instances;
+            this->total.vertices += c->vertices;
+            this->total.updateSubresourceCalls += c->updateSubresourceCalls;
+            this->total.mapCalls += c->mapCalls;
+            this->total.bytesUploaded += c->bytesUploaded;
+            this->total.textureBinds += c->textureBinds;
+            this->total.shaderSwitches += c->shaderSwitches;
+            this->total.constantBufferBinds += c->constantBufferBinds;
+            this->total.modeFlips += c->modeFlips;
+            this->total.rasterizerChanges += c->rasterizerChanges;
+            this->total.blendChanges += c->blendChanges;
+        }
+    };
+
+    benchmark bench;
+
+    // Input of the next example that is run is recorded to or replayed from a file,
+    // replay drives the timer with recorded frame times so the run is repeated exactly.
+    // Works with bench too, then the example ends when the log does.
+    struct inputSession
+    {
+        bool recording;
+        bool replaying;
+        const char* filename;
+        vi::input::inputLog log;
+        // frame being recorded or replayed
+        vi::input::frameInput current;
+        uint frame;
+        vi::time::timer* timer;
+        vi::time::virtualClock clock;
+
+        // called at every frame boundary, false when replay is out of frames
+        bool nextFrame()
+        {
+            if (this->recording && this->frame > 0)
+            {
+                this->current.tickNs = this->timer ? this->timer->getTickTimeNs() : 0;
+                this->log.record(&this->current);
+            }
+
+            if (this->replaying)
+            {
+                if (!this->log.replay(&this->current)) return false;
+                (bench.active ? &bench.clock : &this->clock)->advanceNs(this->current.tickNs);
+            }
+
+            this->frame++;
+            return true;
+        }
+
+        void end()
+        {
+            if (this->recording && !this->log.save(this->filename))
+                fprintf(stderr, "could not write input log %s\n", this->filename);
+
+            this->recording = false;
+            this->replaying = false;
+            this->timer = nullptr;
+            this->log.destroy();
+        }
+    };
+
+    inputSession session;
+
+    void recordInput(const char* filename)
+    {
+        session.log.init();
+        vi::util::zero(&session.current);
+        session.recording = true;
+        session.filename = filename;
+        session.frame = 0;
+    }
+
+    bool replayInput(const char* filename)
+    {
+        if (!session.log.load(filename))
+        {
+            fprintf(stderr, "could not read input log %s\n", filename);
+            return false;
+        }
+
+        vi::util::zero(&session.current);
+        session.clock.init();
+        session.replaying = true;
+        session.filename = filename;
+        session.frame = 0;
+        return true;
+    }
+
+    void openWindow(vi::system::window* w, vi::system::windowInfo* info)
+    {
+        if (!bench.active)
+        {
+            w->init(info);
+            return;
+        }
+
+        // renderer only needs the size
+        vi::util::zero(w);
+        w->width = info->width;
+        w->height = info->height;
+    }
+
+    // returns false when window is closed or benchmark ran all frames
+    bool updateWindow(vi::system::window* w)
+    {
+        if (!bench.active) return session.nextFrame() && w->update();
+
+        if (bench.frame > 0) bench.endFrame();
+        if (bench.onFrame) bench.onFrame();
+        if (bench.frame == bench.frames) return false;
+        if (!session.nextFrame()) return false;
+
+        bench.frame++;
+        if (!session.replaying) bench.clock.advance(bench.step);
+        bench.frameStart = vi::time::nowNs();
+        return true;
+    }
+
+    void closeWindow(vi::system::window* w)
+    {
+        session.end();
+        if (!bench.active) w->destroy();
+    }
+
+    void initRenderer(vi::gl::renderer* g, vi::gl::rendererInfo* info)
+    {
+        info->headless = bench.active;
+        g->init(info);
+        bench.renderer = g;
+    }
+
+    void initTimer(vi::time::timer* t, vi::time::frameStats* stats = nullptr)
+    {
+        vi::time::virtualClock* clock = bench.active ? &bench.clock : session.replaying ? &session.clock : nullptr;
+        t->init(clock, stats);
+        session.timer = t;
+    }
+
+    void updateKeyboard(vi::input::keyboard* k)
+    {
+        if (session.replaying) k->apply(&session.current);
+        else if (!bench.active) k->update();
+
+        if (session.recording) k->capture(&session.current);
+    }
+
+    void updateMouse(vi::input::mouse* m, vi::system::window* w, vi::gl::camera* c)
+    {
+        if (session.replaying)
+        {
+            m->apply(&session.current);
+            m->updateWorld(w, c);
+        }
+        else if (!bench.active) m->update(w, c);
+
+        if (session.recording) m->capture(&session.current);
+    }
+
     struct vivaInfo
     {
         uint width;
         uint height;
         const char* title;
         uint queueCapacity;
+        // seconds per simulation step, 0 runs user loop, animations and dynamics once per frame
+        float fixedStep;
+        // most simulation steps per frame, 0 means 5
+        uint maxStepsPerFrame;
+        // frame time in seconds that counts as a hitch, 0 means 1 / 60
+        float frameBudget;
+        // frame statistics are written here as JSON at exit, nullptr writes nothing
+        const char* statsFile;
     };
 
     struct viva
@@ -110,7 +314,13 @@ namespace examples
         vi::gl::renderer graphics;
         vi::memory::alloctrack alloctrack;
         vi::time::timer timer;
+        vi::time::frameStats stats;
+        const char* statsFile;
         vi::fn::queue queue;
+        vi::time::fixedStep stepper;
+        // how far rendering is between previous and current step, 1 when not running at fixed step
+        float alpha;
+        std::vector<vi::gl::transform2D> previous;
         resources resources;
 
         void init(vivaInfo* info)
@@ -120,24 +330,36 @@ namespace examples
             wInfo.height = info->height;
             wInfo.title = info->title;
 
-            vi::gl::rendererInfo rInfo;
+            vi::gl::rendererInfo rInfo = {};
             rInfo.clearColor[0] = 47 / 255.0f;
             rInfo.clearColor[1] = 79 / 255.0f;
             rInfo.clearColor[2] = 79 / 255.0f;
             rInfo.clearColor[3] = 1;
             rInfo.wnd = &this->window;
 
-            this->window.init(&wInfo);
+            openWindow(&this->window, &wInfo);
             this->keyboard.init();
             this->mouse.init();
-            this->graphics.init(&rInfo);
-            this->timer.init();
+            initRenderer(&this->graphics, &rInfo);
+
+            if (info->frameBudget == 0) info->frameBudget = 1 / 60.0f;
+
+            // percentiles over last 1000 frames
+            this->stats.init(1000, info->frameBudget);
+            this->statsFile = info->statsFile;
+            initTimer(&this->timer, &this->stats);
 
             // if queue capacity is not set then set it to 1
             if (info->queueCapacity == 0) info->queueCapacity = 1;
 
             this->queue.init(&this->timer);
 
+            if (info->maxStepsPerFrame == 0) info->maxStepsPerFrame = 5;
+
+            this->stepper.init(info->fixedStep, info->maxStepsPerFrame);
+            this->keyboard.latchEdges = info->fixedStep > 0;
+            this->alpha = 1;
+
 #ifdef VI_VALIDATE
             this->alloctrack.track = true;
 #endif
@@ -149,37 +371,124 @@ namespace examples
                 this->graphics.destroyTexture(this->resources.textures[i]);
 
             this->resources.free();
+
+            if (this->statsFile) this->stats.writeJSON(this->statsFile);
 #ifdef VI_VALIDATE
             this->alloctrack.report();
 #endif // VI_VALIDATE
 
             this->graphics.destroy();
-            this->window.destroy();
+            closeWindow(&this->window);
+        }
+
+        // time that user loop should advance simulation by
+        float getStepTime()
+        {
+            return this->stepper.step > 0 ? this->stepper.step : this->timer.getTickTimeSec();
         }
 
         void loop(std::function<void()> userLoop)
         {
-            while (this->window.update())
+            while (updateWindow(&this->window))
             {
-                this->keyboard.update();
-                this->mouse.update(&this->window, &this->graphics.camera);
+                VI_PROFILE_FRAME();
+                VI_PROFILE_SCOPE("frame");
+                updateKeyboard(&this->keyboard);
+                updateMouse(&this->mouse, &this->window, &this->graphics.camera);
                 this->timer.update();
 
+                if (this->stepper.step > 0)
+                {
+                    this->fixedUpdate(userLoop);
+                    this->drawInterpolated();
+                    continue;
+                }
+
+                {
+                    VI_PROFILE_SCOPE("userLoop");
+                    userLoop();
+                }
+                {
+                    VI_PROFILE_COUNTERS("animations", this->resources.animations.size());
+                    for (uint i = 0; i < this->resources.animations.size(); i++)
+                        this->resources.animations[i]->update();
+                }
+                {
+                    VI_PROFILE_COUNTERS("dynamics", this->resources.dynamics.size());
+                    for (uint i = 0; i < this->resources.dynamics.size(); i++)
+                        this->resources.dynamics[i]->update();
+                }
+
+                this->graphics.beginScene();
+                {
+                    VI_PROFILE_COUNTERS("sprites", this->resources.sprites.size());
+                    for (uint i = 0; i < this->resources.sprites.size(); i++)
+                    {
+                        vi::gl::sprite* s = this->resources.sprites[i];
+                        this->graphics.drawSprite(s);
+                    }
+                }
+                this->graphics.endScene();
+            }
+        }
+
+        // run as many steps as frame time covers, input is sampled once per frame
+        // key pressed/released and typed keys are latched until the first step sees them,
+        // so frames without a step don't lose them and catch up steps don't repeat them
+        void fixedUpdate(std::function<void()>& userLoop)
+        {
+            uint steps = this->stepper.advance(this->timer.getTickTimeSec());
+
+            VI_PROFILE_SCOPE("fixedUpdate");
+
+            for (uint step = 0; step < steps; step++)
+            {
+                // only the last two steps are blended so only the state before last step is kept
+                if (step == steps - 1)
+                {
+                    this->previous.resize(this->resources.sprites.size());
+                    for (uint i = 0; i < this->resources.sprites.size(); i++)
+                        this->previous[i].get(this->resources.sprites[i]);
+                }
+
                 userLoop();
+                if (step == 0) this->keyboard.consumeEdges();
 
                 for (uint i = 0; i < this->resources.animations.size(); i++)
-                    this->resources.animations[i]->update();
+                    this->resources.animations[i]->step(this->stepper.step);
                 for (uint i = 0; i < this->resources.dynamics.size(); i++)
-                    this->resources.dynamics[i]->update();
+                    this->resources.dynamics[i]->step(this->stepper.step);
+            }
 
-                this->graphics.beginScene();
-                for (uint i = 0; i < this->resources.sprites.size(); i++)
+            this->alpha = this->stepper.getAlpha();
+        }
+
+        // draw copies of sprites placed between previous and current step, simulation state is not touched
+        void drawInterpolated()
+        {
+            vi::gl::sprite blended;
+            vi::gl::transform2D current, t;
+
+            this->graphics.beginScene();
+            VI_PROFILE_SCOPE("sprites");
+            for (uint i = 0; i < this->resources.sprites.size(); i++)
+            {
+                vi::gl::sprite* s = this->resources.sprites[i];
+
+                // sprites added after last step have no previous state yet
+                if (i >= this->previous.size())
                 {
-                    vi::gl::sprite* s = this->resources.sprites[i];
                     this->graphics.drawSprite(s);
+                    continue;
                 }
-                this->graphics.endScene();
+
+                blended = *s;
+                current.get(s);
+                t.lerp(&this->previous[i], &current, this->alpha);
+                t.set(&blended);
+                this->graphics.drawSprite(&blended);
             }
+            this->graphics.endScene();
         }
     };
 
@@ -195,12 +504,13 @@ namespace examples
     void performance()
     {
         const uint count = 10000;
-        vivaInfo info;
+        vivaInfo info = {};
         viva v;
         info.width = 960;
         info.height = 540;
         info.queueCapacity = 1;
         info.title = "Performance";
+        info.statsFile = "performance_stats.json";
         v.init(&info);
 
         vi::gl::texture* t = v.resources.addTexture();
@@ -232,9 +542,24 @@ namespace examples
                 lastUpdate = gameTime;
                 fps = frames;
                 frames = 0;
-                printf("%d\n", fps);
+                // average hides hitches, percentiles show them
+                vi::time::frameSummary fs;
+                v.stats.getSummary(&fs);
+                printf("%d fps  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms  over budget %llu\n", fps,
+                    fs.p50 * 1e3, fs.p95 * 1e3, fs.p99 * 1e3, fs.max * 1e3, fs.overBudget);
+                vi::gl::renderCounters* rc = v.graphics.getFrameCounters();
+                if (rc) printf("draw calls %u  uploads %u  bytes %llu  texture binds %u  mode flips %u\n",
+                    rc->drawCalls, rc->updateSubresourceCalls, rc->bytesUploaded, rc->textureBinds, rc->modeFlips);
+#ifdef VI_PROFILE
+                // scopes of the last frame, and trace of the 2nd second for chrome://tracing
+                vi::profile::report(stdout);
+                vi::profile::reportCounters(stdout);
+                vi::profile::resetCounters();
+                if (gameTime < 2) vi::profile::beginCapture();
+                else if (gameTime < 3) vi::profile::endCapture("performance_trace.json");
+#endif
             }
-            float tick = v.timer.getTickTimeSec();
+            float tick = v.getStepTime();
             for (uint i = 0; i < v.resources.sprites.size(); i++)
             {
                 v.resources.sprites[i]->s1.rot += tick;
@@ -245,43 +570,141 @@ namespace examples
         v.destroy();
     }
 
-    /*void network()
+    // client and server in one thread over localhost, messages go on a reliable ordered channel
+    // so each one arrives once and in order even when datagrams are lost, doubled or reordered
+    void network()
     {
-        vi::net::endpoint serverSide;
-        vi::net::client client;
+        using namespace vi::net;
 
         // init network in windows
-        vi::net::initNetwork();
-        vi::net::server server;
-        // start server at port 10000
-        server.init(10000);
-        // start client and point it at localhost:10000
-        client.init("127.0.0.1", 10000);
-        // client sends to server
-        client.send((byte*)"Hello", 6);
-        byte data[20];
-        // server receives
-        // since this is not blocking it might fail if send is not fast enough
-        // but I guess it is in localhost
-        server.receive(data, 20, &serverSide);
-        char clientip[20];
-        memset(clientip, 0, 20);
-        // server determines ip of client
-        serverSide.getAddress(clientip, 20);
-        printf("server side, %s said: %s\n", clientip, data);
-        // server sends to client
-        server.send((const byte*)"Hi", 3, &serverSide);
-        // client receives
-        // since this is not blocking it might fail if send is not fast enough
-        // but I guess it is in localhost
-        client.receive(data, 20);
-        printf("client side, server said: %s\n", data);
+        initNetwork();
+        server srv;
+        client cli;
+        // start server at port 10000 and point client at it
+        srv.init(10000);
+        cli.init("127.0.0.1", 10000);
+
+        // datagrams, and a few big buffers where fragmented messages are put back together
+        packetPool pool, messagePool;
+        pool.init(256);
+        messagePool.init(4, NET_MAX_MESSAGE_SIZE);
+        channelType types[] = { channelType::ReliableOrdered };
+
+        // server keeps a connection and a reliability per client, indexed by connection id
+        connectionTable clients;
+        clients.init(16, 5000);
+        reliability serverSide[16];
+        // client talks only to the server so a zeroed connection will do
+        connection toServer = {};
+        reliability clientSide;
+        clientSide.init(&pool, &messagePool, types, 1);
+
+        message messages[64];
+        const uint count = 10;
+        uint replies = 0;
+        char text[32];
+
+        for (uint i = 0; i < count; i++)
+        {
+            int len = snprintf(text, sizeof(text), "Hello %u", i);
+            clientSide.send(&toServer, 0, (const byte*)text, len + 1, vi::time::nowNs());
+        }
+
+        // a network tick every millisecond until every reply came or a second passed
+        for (uint tick = 0; tick < 1000 && replies < count; tick++)
+        {
+            long long now = vi::time::nowNs();
+
+            // client packs what was sent since the last tick into datagrams
+            clientSide.update(&toServer, now);
+            while (packetBuffer* b = toServer.dequeue())
+            {
+                cli.send(b->getData(), b->len);
+                b->release();
+            }
+
+            // server, a new buffer for every datagram because messages waiting for a lost one keep it
+            endpoint ep;
+            packetBuffer* in;
+
+            while ((in = pool.allocate()) && (in->len = srv.receive(in->getData(), NET_PACKET_SIZE, &ep)) > 0)
+            {
+                connection* c = clients.connect(&ep, now);
+
+                if (!c)
+                {
+                    in->release();
+                    continue;
+                }
+
+                // new connection starts with a fresh reliability
+                if (c->stats.packetsReceived == 0) serverSide[c->id].init(&pool, &messagePool, types, 1);
+                clients.received(c, in->len, now);
+
+                uint n = serverSide[c->id].receive(c, in, now, messages, 64);
+
+                for (uint i = 0; i < n; i++)
+                {
+                    char address[20] = {};
+                    c->ep.getAddress(address, 20);
+                    printf("server side, %s said: %s\n", address, (const char*)messages[i].data);
+
+                    int len = snprintf(text, sizeof(text), "Hi %u", messages[i].id);
+                    serverSide[c->id].send(c, 0, (const byte*)text, len + 1, now);
+                    messages[i].buffer->release();
+                }
+
+                in->release();
+            }
+
+            if (in) in->release();
+
+            for (uint a = 0; a < clients.activeCount; a++)
+            {
+                connection* c = &clients.connections[clients.active[a]];
+                serverSide[c->id].update(c, now);
+
+                while (packetBuffer* b = c->dequeue())
+                {
+                    srv.send(b->getData(), b->len, &c->ep);
+                    b->release();
+                }
+            }
+
+            // client
+            while ((in = pool.allocate()) && (in->len = cli.receive(in->getData(), NET_PACKET_SIZE)) > 0)
+            {
+                uint n = clientSide.receive(&toServer, in, now, messages, 64);
+
+                for (uint i = 0; i < n; i++)
+                {
+                    printf("client side, server said: %s\n", (const char*)messages[i].data);
+                    messages[i].buffer->release();
+                    replies++;
+                }
+
+                in->release();
+            }
+
+            if (in) in->release();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        printf("%u of %u replies\n", replies, count);
+
         // release resources
-        client.destroyClient();
-        server.destroyServer();
+        for (uint a = 0; a < clients.activeCount; a++)
+            serverSide[clients.active[a]].destroy();
+
+        clientSide.destroy();
+        clients.destroy();
+        messagePool.destroy();
+        pool.destroy();
+        cli.destroyClient();
+        srv.destroyServer();
         // uninit network in windows
-        vi::net::uninitNetwork();
-    }*/
+        uninitNetwork();
+    }
 
     // top chest will blink from start
     // middle chest will start blinking after 5s
@@ -386,7 +809,7 @@ namespace examples
         winfo.height = 540;
         winfo.title = "Z Index";
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = {};
         ginfo.wnd = &wnd;
         ginfo.clearColor[0] = 47 / 255.0f;
@@ -394,7 +817,7 @@ namespace examples
         ginfo.clearColor[2] = 79 / 255.0f;
         ginfo.clearColor[3] = 1;
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::gl::texture t;
         g.createTextureFromFile(&t, "textures/0x72_DungeonTilesetII_v1.png");
         t.index = 0;
@@ -408,7 +831,7 @@ namespace examples
             g.setPixelScale(s + i, 80, 80);
         }
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             g.beginScene();
             for (uint i = 0; i < 10; i++)
@@ -418,7 +841,7 @@ namespace examples
 
         g.destroyTexture(&t);
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     /// <summary>
@@ -432,7 +855,7 @@ namespace examples
         uint len = strlen(str) - 1;
 
         viva v;
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Typing";
@@ -469,12 +892,21 @@ namespace examples
                 strcat(str, "_");
                 text->update();
             }
-            // there is no glyph for tab
-            else if (v.keyboard.typedKey != 0 && len < 900 && v.keyboard.typedKey != '\t')
+            else
             {
-                str[len++] = v.keyboard.typedKey;
-                strcat(str, "_");
-                text->update();
+                const char* typed;
+                uint count = v.keyboard.getKeysTyped(&typed);
+
+                // there is no glyph for tab
+                for (uint i = 0; i < count && len < 900; i++)
+                    if (typed[i] != '\t') str[len++] = typed[i];
+
+                if (count > 0)
+                {
+                    str[len] = 0;
+                    strcat(str, "_");
+                    text->update();
+                }
             }
         };
 
@@ -489,7 +921,7 @@ namespace examples
     {
         char str[1000];        
 
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Input state";
@@ -539,7 +971,7 @@ namespace examples
             "can be manipulated individually.\nPress space to toggle";
         const char* extra = "\n more stuff";        
 
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Text";
@@ -685,10 +1117,10 @@ VS_OUTPUT main(uint vid : SV_VertexID)
 
         vi::system::windowInfo winfo = { 500, 500, "Custom Vertex Shader" };
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = { &wnd,{47 / 255.0f,79 / 255.0f, 79 / 255.0,1} };
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::gl::texture t;
         g.createTextureFromFile(&t, "textures/0x72_DungeonTilesetII_v1.png");
         t.index = 0;
@@ -709,7 +1141,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
 
         ID3D11VertexShader* customVS = g.createVertexShader(customVSSoure);
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             g.beginScene();
             g.setDefaultSpriteVS();
@@ -723,7 +1155,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         g.destroyVertexShader(customVS);
         g.destroyTexture(&t);
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     // draw lines
@@ -733,13 +1165,13 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         vi::time::timer timer;
         vi::input::keyboard keyboard;
         keyboard.init();
-        timer.init();
+        initTimer(&timer);
         vi::system::windowInfo winfo = { 500,500,"Lines" };
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = { &wnd,{47 / 255.0f,79 / 255.0f,79 / 255.0f,1} };
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::gl::sprite s = {};
         s.line.x1 = 0;
         s.line.y1 = 0;
@@ -750,11 +1182,11 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         s.line.b = 1;
         s.line.a = 1;
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             timer.update();
             float frameTime = timer.getTickTimeSec();
-            keyboard.update();
+            updateKeyboard(&keyboard);
 
             if (keyboard.isKeyDown('A')) g.camera.x -= frameTime;
             else if (keyboard.isKeyDown('D')) g.camera.x += frameTime;
@@ -772,7 +1204,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         }
 
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     // move camera with WSAD zoom Q/E
@@ -785,7 +1217,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         vi::time::timer timer;
         vi::input::keyboard keyboard;
         keyboard.init();
-        timer.init();
+        initTimer(&timer);
         vi::system::windowInfo winfo = {};
         winfo.width = 960;
         winfo.height = 540;
@@ -794,7 +1226,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         screenView.aspectRatio = 960.0f / 540.0f;
         winfo.title = "Camera";
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = {};
         ginfo.wnd = &wnd;
         ginfo.clearColor[0] = 47 / 255.0f;
@@ -802,7 +1234,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         ginfo.clearColor[2] = 79 / 255.0f;
         ginfo.clearColor[3] = 1;
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::gl::texture t;
         g.createTextureFromFile(&t, "textures/0x72_DungeonTilesetII_v1.png");
         t.index = 0;
@@ -822,11 +1254,11 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         g.setScreenPos2(s + 5, 20, 20);
         s[5].s2.origin = { -0.5f,-0.5f };
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             timer.update();
             float frameTime = timer.getTickTimeSec();
-            keyboard.update();
+            updateKeyboard(&keyboard);
 
             if (keyboard.isKeyDown('A')) g.camera.x -= frameTime;
             else if (keyboard.isKeyDown('D')) g.camera.x += frameTime;
@@ -849,7 +1281,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
 
         g.destroyTexture(&t);
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
     
     // just to make sure they still work
@@ -857,7 +1289,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
     void multipleTextures()
     {
         viva v;
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Multiple textures";
@@ -886,6 +1318,55 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         v.destroy();
     }
 
+    // same as multipleTextures but files are decoded on worker threads
+    // sprites show 2x2 checker until their texture is uploaded
+    void asyncTextures()
+    {
+        viva v;
+        vivaInfo info = {};
+        info.width = 960;
+        info.height = 540;
+        info.title = "Async textures";
+        v.init(&info);
+        v.graphics.camera.scale = 0.5f;
+
+        vi::gl::texture* placeholder = v.resources.addTexture();
+        byte bytes[] = { 255,0,255,255, 0,0,0,255, 0,0,0,255, 255,0,255,255 };
+        v.graphics.createTextureFromBytes(placeholder, bytes, 2, 2);
+
+        vi::gl::textureLoader loader;
+        loader.init(&v.graphics, placeholder, nullptr, 0);
+
+        const char* files[] = { "textures/bk.png", "textures/elf.png", "textures/sm.png" };
+        vi::gl::vector3 pos[] = { {-1,1,0}, {-1,-1,0}, {1,-1,0} };
+
+        for (uint i = 0; i < 3; i++)
+        {
+            vi::gl::texture* t = v.resources.addTexture();
+            // last one is needed first
+            loader.load(t, files[i], i);
+            vi::gl::sprite* s = v.resources.addSprite();
+            s->init(t);
+            s->s2.pos = pos[i];
+        }
+
+        auto loop = [&]()
+        {
+            // spend at most 2ms per frame on uploads
+            loader.update(0.002f);
+
+            uint handle;
+            vi::gl::textureLoadState state;
+            while (loader.pollCompleted(&handle, &state))
+                printf("texture request %u %s\n", handle, state == vi::gl::textureLoadState::Failed ? "failed" : "is resident");
+        };
+
+        v.loop(loop);
+
+        loader.destroy();
+        v.destroy();
+    }
+
     // move with WSAD, flip sword with SPACE (this is to test keyPressed)
     // there a lot of noise to make it more interesting
     // state management is done in crapy way just to have quick and dirty example
@@ -898,7 +1379,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         float elfDirection = 1;
         float monsterDirection = 1;
         viva v;
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Keyboard";
@@ -1070,7 +1551,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
 
     void timerMotionAnimation()
     {
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "Timer, motion and animation";
@@ -1137,11 +1618,51 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         v.destroy();
     }
 
+    // simulation runs 30 times per second no matter the frame rate
+    // both sprites are drawn blended between steps so motion stays smooth at any refresh rate
+    // left one is spun by dynamic, right one by user loop
+    void fixedTimestep()
+    {
+        vivaInfo info = {};
+        info.width = 960;
+        info.height = 540;
+        info.title = "Fixed timestep";
+        info.fixedStep = 1 / 30.0f;
+        viva v;
+        v.init(&info);
+        v.graphics.camera.scale = 0.1f;
+
+        vi::gl::texture* t = v.resources.addTexture();
+        v.graphics.createTextureFromFile(t, "textures/0x72_DungeonTilesetII_v1.png");
+
+        vi::gl::sprite* s = v.resources.addSprite(2);
+        for (uint i = 0; i < 2; i++)
+        {
+            s[i].init(t);
+            v.graphics.setUvFromPixels(s + i, 293.f, 18.f, 6.f, 13.f, 512.f, 512.f);
+            v.graphics.setPixelScale(s + i, 6 * 10, 13 * 10);
+            s[i].s2.pos = { -4.0f + i * 8, 0 };
+        }
+
+        vi::gl::dynamic* d = v.resources.addDynamic();
+        d->init(s, &v.timer);
+        d->velrot = 2.f;
+
+        auto loop = [&]()
+        {
+            // with fixed step user loop runs once per step and advances by step time
+            s[1].s1.rot += v.getStepTime() * 2.f;
+        };
+
+        v.loop(loop);
+        v.destroy();
+    }
+
     // more drawing options
     // loc, rot, scale, flipping, colors
     void moreSprites()
     {
-        vivaInfo info;
+        vivaInfo info = {};
         info.width = 960;
         info.height = 540;
         info.title = "More sprites";
@@ -1208,10 +1729,10 @@ VS_OUTPUT main(uint vid : SV_VertexID)
     {
         vi::system::windowInfo winfo = { 500, 500, "Basic Sprite"};
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = { &wnd,{47 / 255.0f,79 / 255.0f, 79 / 255.0,1} };
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::gl::texture t;
         g.createTextureFromFile(&t, "textures/0x72_DungeonTilesetII_v1.png");
         t.index = 0;
@@ -1230,7 +1751,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         s2.s2.pos = { 0.7f,0.7f,0 };
         s2.s2.scale = { 0.2f,0.2f };
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             g.beginScene();
             g.drawSprite(&s);
@@ -1242,7 +1763,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         g.destroyTexture(&t);
         g.destroyTexture(&t2);
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     // various mesh rendering options
@@ -1254,7 +1775,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         winfo.height = 500;
         winfo.title = "Cube";
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = {};
         ginfo.wnd = &wnd;
         ginfo.clearColor[0] = 47 / 255.0f;
@@ -1262,9 +1783,9 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         ginfo.clearColor[2] = 79 / 255.0f;
         ginfo.clearColor[3] = 1;
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         vi::time::timer timer;
-        timer.init();
+        initTimer(&timer);
 
         vi::gl::camera3D cam3d =
         { 1,1,0.001f,1000.0f,{-10,10,-10},{0,0,0},{0,1,0} };
@@ -1371,10 +1892,10 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         vi::input::keyboard k;
         k.init();
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
             timer.update();
-            k.update();
+            updateKeyboard(&k);
             float f1 = 4;
             if (k.isKeyDown('R'))
                 cam3d.eye.z += timer.getTickTimeSec() * f1;
@@ -1433,7 +1954,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
             g.destroyMesh(m + i);
         }
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     void mesh2()
@@ -1443,7 +1964,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         winfo.height = 500;
         winfo.title = "Mesh Test";
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = {};
         ginfo.wnd = &wnd;
         ginfo.clearColor[0] = 47 / 255.0f;
@@ -1451,7 +1972,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         ginfo.clearColor[2] = 79 / 255.0f;
         ginfo.clearColor[3] = 1;
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
         g.setWireframe();
 
         vi::gl::camera3D cam3d =
@@ -1486,10 +2007,10 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         vi::input::mouse m;
         m.init();
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
-            k.update();
-            m.update(&wnd, nullptr);
+            updateKeyboard(&k);
+            updateMouse(&m, &wnd, nullptr);
 
             static int angle = 0;
             int dx, dy;
@@ -1522,7 +2043,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
 
         g.destroyMesh(&mesh);
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     void blendState()
@@ -1533,7 +2054,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         winfo.height = 500;
         winfo.title = "Blend State";
         vi::system::window wnd;
-        wnd.init(&winfo);
+        openWindow(&wnd, &winfo);
         vi::gl::rendererInfo ginfo = {};
         ginfo.wnd = &wnd;
         ginfo.clearColor[0] = 47 / 255.0f;
@@ -1541,7 +2062,7 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         ginfo.clearColor[2] = 79 / 255.0f;
         ginfo.clearColor[3] = 1;
         vi::gl::renderer g;
-        g.init(&ginfo);
+        initRenderer(&g, &ginfo);
 
         vi::gl::texture t1;
         g.createTextureFromFile(&t1, "./textures/b.png");
@@ -1598,10 +2119,10 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         vi::input::mouse m;
         m.init();
 
-        while (wnd.update())
+        while (updateWindow(&wnd))
         {
-            k.update();
-            m.update(&wnd, nullptr);
+            updateKeyboard(&k);
+            updateMouse(&m, &wnd, nullptr);
 
             g.beginScene();
 
@@ -1621,11 +2142,16 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         }
 
         g.destroy();
-        wnd.destroy();
+        closeWindow(&wnd);
     }
 
     int main()
     {
+        // to record a session and play it back exactly:
+        //recordInput("typing.vinp");
+        //typing();
+        //replayInput("typing.vinp");
+        //typing();
         inputState();
         //customVS();
         //basicSprite();
@@ -1635,22 +2161,26 @@ VS_OUTPUT main(uint vid : SV_VertexID)
         moreSprites();
         blendState();
         timerMotionAnimation();
+        fixedTimestep();
         performance();
         keyboardMultipleAnimationsMath();
         multipleTextures();
+        asyncTextures();
         camera();
         text();
         inputState();
         typing();
         zindex();
         //queue();
-        //network();
+        network();
 
         return 0;
     }
 }
 
+#ifndef VI_BENCH
 int main()
 {
     return examples::main();
-}
\ No newline at end of file
+}
+#endif
\ No newline at end of file
@@ -13,16 +13,71 @@
 #include <ctime>
 #include <functional>
 #include <random>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cassert>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// SSSE3 is not in the x64 baseline (MSVC /arch:SSE2, plain g++ -O2), functions that use it
+// are compiled for it on their own and only called after a cpuid check
+#if defined(_MSC_VER) && !defined(__clang__)
+#define VI_TARGET_SSSE3
+#else
+#define VI_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
 
+// only windows has window and renderer
+// other platforms get the parts that don't need them (memory, time, input state, network, files, packs, routines etc.)
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Ws2tcpip.h> // winsock
 #include <WinSock2.h> // winsock
 #include <Windows.h> // winapi
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/filter.h>
+#include <linux/perf_event.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+// io_uring transport needs multishot recvmsg and buffer rings of kernel 6.0 headers,
+// with older ones it's left out and transport::Uring falls back to epoll
+#if defined(__linux__) && defined(IORING_RECV_MULTISHOT)
+#define VI_URING
+#endif
 
 // image loading library
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#ifdef _WIN32
 // windows D3D11
 #include <d3d11.h>
 #include <d3dcompiler.h>
@@ -30,8 +85,11 @@
 #pragma comment (lib, "d3d11.lib")
 #pragma comment (lib, "D3DCompiler.lib")
 #pragma comment(lib, "ws2_32.lib")
+#endif
 
 #define KEYBOARD_KEY_COUNT 256
+#define KEYBOARD_TYPED_CAPACITY 32
+#define INPUT_EVENT_CAPACITY 1024
 #define WND_CLASSNAME "mywindow"
 
 typedef unsigned char byte;
@@ -42,6 +100,10 @@ typedef unsigned short ushort;
 // it's because you have to enable new namespace syntax (c++latest)
 namespace vi::memory
 {
+    // every alloctrack::alloc of the process, so tools can count engine allocations next to operator new
+    std::atomic<unsigned long long> allocations{ 0 };
+    std::atomic<unsigned long long> allocatedBytes{ 0 };
+
     struct alloctrack
     {
         std::vector<void*> allocations;
@@ -60,6 +122,8 @@ namespace vi::memory
 #endif
 
             T* block = (T*)malloc(size * sizeof(T));
+            vi::memory::allocations.fetch_add(1, std::memory_order_relaxed);
+            vi::memory::allocatedBytes.fetch_add(size * sizeof(T), std::memory_order_relaxed);
 
             if (this->track) this->allocations.push_back(block);
 
@@ -91,2631 +155,9154 @@ namespace vi::memory
 
 namespace vi::time
 {
-    struct timer
+    const long long NS_PER_SEC = 1000000000ll;
+
+    // monotonic time in nanoseconds, only differences between two calls are meaningful
+    long long nowNs()
     {
-        float gameTime;
-        float tickTime;
-        long long ticksPerSecond;
-        long long startTime;
-        long long prevTick;
+#ifdef _WIN32
+        static long long ticksPerSecond = 0;
+        LARGE_INTEGER li;
 
-        void init()
+        if (ticksPerSecond == 0)
         {
-            LARGE_INTEGER li;
-            BOOL result = ::QueryPerformanceFrequency(&li);
+            ::QueryPerformanceFrequency(&li);
+            ticksPerSecond = li.QuadPart;
+        }
 
-#ifdef VI_VALIDATE
-            if (!result)
-            {
-                fprintf(stderr, "QueryPerformanceFrequency failed");
-                return;
-            }
+        ::QueryPerformanceCounter(&li);
+        // split so ticks * NS_PER_SEC doesn't overflow after long uptime
+        long long seconds = li.QuadPart / ticksPerSecond;
+        long long rest = li.QuadPart % ticksPerSecond;
+        return seconds * NS_PER_SEC + rest * NS_PER_SEC / ticksPerSecond;
+#else
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (long long)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
 #endif
-            this->gameTime = 0;
-            this->tickTime = 0;
-            this->ticksPerSecond = li.QuadPart;
-            ::QueryPerformanceCounter(&li);
-            this->startTime = li.QuadPart;
-            this->prevTick = li.QuadPart;
-        }
+    }
 
-        // this updates the timer so it must be called once per frame
-        void update()
-        {
-            LARGE_INTEGER currentTime;
-            ::QueryPerformanceCounter(&currentTime);
+    // clock that only moves when told to, give it to timer so tests and benchmarks
+    // can run hours of game time in seconds and get the same deltas every run
+    struct virtualClock
+    {
+        long long ns;
 
-            long long frameDelta = currentTime.QuadPart - this->prevTick;
-            long long gameDelta = currentTime.QuadPart - this->startTime;
-            this->prevTick = currentTime.QuadPart;
-            this->tickTime = (float)((double)frameDelta / (double)this->ticksPerSecond);
-            this->gameTime = (float)((double)gameDelta / (double)this->ticksPerSecond);
+        void init()
+        {
+            this->ns = 0;
         }
 
-        // get tick time
-        // tick time is the time between two calls to 'updateTimer'
-        // can be used as frame time if updateTimer is called once per frame
-        float getTickTimeSec()
+        void advanceNs(long long ns)
         {
-            return this->tickTime;
+            this->ns += ns;
         }
 
-        // get time since game started in seconds
-        float getGameTimeSec()
+        void advance(double seconds)
         {
-            return this->gameTime;
+            this->ns += (long long)(seconds * NS_PER_SEC);
         }
     };
-}
 
-namespace vi::util
-{
-    template<typename T>
-    void swap(T& a, T& b)
-    {
-        T tmp = a;
-        a = b;
-        b = tmp;
-    }
+    // histogram bins are quarter octaves starting at 50 us, bin 0 is everything below,
+    // last bin everything above ~2.3 s
+    const uint FRAME_HISTOGRAM_BINS = 64;
+    const long long FRAME_HISTOGRAM_BASE_NS = 50000;
 
-    // zero out memory at dst sizeof(T)
-    template<typename T>
-    void zero(T* dst)
+    struct frameSummary
     {
-        memset(dst, 0, sizeof(T));
-    }
+        unsigned long long frames;
+        unsigned long long overBudget;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+    };
 
-    template<typename T>
-    void zeron(T* dst, uint len)
+    // Frame time statistics, give it to 'timer::init' and every 'timer::update' adds one frame.
+    // Percentiles and max are over the last 'capacity' frames, histogram and counters over all frames.
+    struct frameStats
     {
-        memset(dst, 0, sizeof(T) * len);
-    }
+        std::vector<long long> frameTimes;
+        std::vector<long long> sorted;
+        uint capacity;
+        uint head;
+        uint count;
+        long long budgetNs;
+        unsigned long long frames;
+        unsigned long long overBudget;
+        long long totalNs;
+        unsigned long long histogram[FRAME_HISTOGRAM_BINS];
+
+        // 'budgetSec' is frame time that counts as a hitch, e.g. 1 / 60.0
+        void init(uint capacity, double budgetSec)
+        {
+            // window of one frame at least, 'add' writes to it unconditionally
+            if (capacity == 0) capacity = 1;
+            this->frameTimes.assign(capacity, 0);
+            this->capacity = capacity;
+            this->budgetNs = (long long)(budgetSec * NS_PER_SEC);
+            this->reset();
+        }
 
-    struct rng
-    {
-        std::mt19937 mt;
-        std::uniform_int_distribution<int> distr;
+        void reset()
+        {
+            this->head = 0;
+            this->count = 0;
+            this->frames = 0;
+            this->overBudget = 0;
+            this->totalNs = 0;
+            memset(this->histogram, 0, sizeof(this->histogram));
+        }
 
-        void init(int min, int max)
+        static uint getBin(long long ns)
         {
-            mt.seed(::time(0));
-            this->distr = std::uniform_int_distribution<int>(min, max);
+            if (ns < FRAME_HISTOGRAM_BASE_NS) return 0;
 
-            // warm up
-            for (int i = 0; i < 100; i++)
-                this->rnd();
+            int bin = (int)(log2((double)ns / FRAME_HISTOGRAM_BASE_NS) * 4) + 1;
+            return bin < (int)FRAME_HISTOGRAM_BINS ? bin : FRAME_HISTOGRAM_BINS - 1;
         }
 
-        /// <summary>
-        /// get random number between min and max inclusive
-        /// </summary>
-        int rnd()
+        // lower edge of the bin in seconds
+        static double getBinStart(uint bin)
         {
-            return this->distr(this->mt);
+            if (bin == 0) return 0;
+            return FRAME_HISTOGRAM_BASE_NS * exp2((bin - 1) / 4.0) / NS_PER_SEC;
         }
-    };
 
-    template<typename T>
-    T* find(T* arr, uint len, std::function<bool(T*)> pred)
-    {
-        for (uint i = 0; i < len; i++)
+        void add(long long ns)
         {
-            if (pred(arr + i)) return arr + i;
+            this->frameTimes[this->head] = ns;
+            this->head = (this->head + 1) % this->capacity;
+            if (this->count < this->capacity) this->count++;
+
+            this->frames++;
+            this->totalNs += ns;
+            this->histogram[getBin(ns)]++;
+            if (ns > this->budgetNs) this->overBudget++;
         }
 
-        return nullptr;
-    }
-}
+        // 'p' in range 0 to 1 over the rolling window, in seconds
+        double percentile(double p)
+        {
+            if (this->count == 0) return 0;
 
-namespace vi::math
-{
-    const float PI = 3.1415926f;
-    const float TWO_PI = PI * 2;
-    const float HALF_PI = PI / 2;
-    const float THIRD_PI = PI / 3;
-    const float FORTH_PI = PI / 4;
-    const float THREE_HALVES_PI = PI * 1.5f;
-    const float DEGREE = PI / 180;
+            this->sorted.assign(this->frameTimes.begin(), this->frameTimes.begin() + this->count);
+            size_t index = (size_t)(p * (this->count - 1) + 0.5);
+            std::nth_element(this->sorted.begin(), this->sorted.begin() + index, this->sorted.end());
+            return (double)this->sorted[index] / NS_PER_SEC;
+        }
 
-    // magnitude of a vector
-    float mag2D(float x, float y)
-    {
-        return sqrtf(x * x + y * y);
-    }
+        void getSummary(frameSummary* summary)
+        {
+            summary->frames = this->frames;
+            summary->overBudget = this->overBudget;
+            summary->mean = this->frames ? (double)this->totalNs / this->frames / NS_PER_SEC : 0;
 
-    // magnitude squared of a vector
-    float mag2Dsq(float x, float y)
-    {
-        return x * x + y * y;
-    }
+            if (this->count == 0)
+            {
+                summary->p50 = summary->p95 = summary->p99 = summary->max = 0;
+                return;
+            }
 
-    // normalize src vector (x,y), result is dst vector (dstx, dsty)
-    void norm2D(float x, float y, float* dstx, float* dsty)
-    {
-        float mag = mag2D(x, y);
-        *dstx = x / mag;
-        *dsty = y / mag;
-    }
+            // one sort gives all percentiles
+            this->sorted.assign(this->frameTimes.begin(), this->frameTimes.begin() + this->count);
+            std::sort(this->sorted.begin(), this->sorted.end());
+            uint last = this->count - 1;
+            summary->p50 = (double)this->sorted[(size_t)(0.50 * last + 0.5)] / NS_PER_SEC;
+            summary->p95 = (double)this->sorted[(size_t)(0.95 * last + 0.5)] / NS_PER_SEC;
+            summary->p99 = (double)this->sorted[(size_t)(0.99 * last + 0.5)] / NS_PER_SEC;
+            summary->max = (double)this->sorted[last] / NS_PER_SEC;
+        }
 
-    float distance2D(float x1, float y1, float x2, float y2)
-    {
-        return sqrtf((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
-    }
+        // frame times of the rolling window oldest first, one per row in milliseconds
+        bool writeCSV(const char* filename)
+        {
+            FILE* f = fopen(filename, "wb");
 
-    float distance2Dsq(float x1, float y1, float x2, float y2)
-    {
-        return (x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1);
-    }
+            if (!f)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "could not open %s\n", filename);
+#endif
+                return false;
+            }
 
-    // sets velx, vely in such way that object will move from start to dst at speed 'speed'
-    void moveTo(float startx, float starty, float dstx, float dsty, float speed, float* velx, float* vely)
-    {
-        float dx = dstx - startx;
-        float dy = dsty - starty;
-        norm2D(dx, dy, velx, vely);
-        *velx *= speed;
-        *vely *= speed;
-    }
+            fprintf(f, "frame,ms\n");
+            uint first = (this->head + this->capacity - this->count) % this->capacity;
+            unsigned long long frame = this->frames - this->count;
 
-    // calculates the angle when (x,y) points at (targetx,targety)
-    float lookAt(float x, float y, float targetx, float targety, float* rot)
-    {
-        // not implemented
-        assert(false);
-        return 0;
-    }
+            for (uint i = 0; i < this->count; i++)
+                fprintf(f, "%llu,%.4f\n", frame + i, this->frameTimes[(first + i) % this->capacity] / 1e6);
 
-    // rot point (x,y) around origin (ox, oy) by angle
-    void rot2D(float x, float y, float ox, float oy, float angle, float* dstx, float* dsty)
-    {
-        float px = x - ox;
-        float py = y - oy;
-        float dx = px * cosf(angle) - py * sinf(angle);
-        float dy = px * sinf(angle) + py * cosf(angle);
-        *dstx = dx + ox;
-        *dsty = dy + oy;
-    }
+            return fclose(f) == 0;
+        }
 
-    // calc angle p1,p2,p3
-    float calcAngle2D(float P1X, float P1Y, float P2X, float P2Y,
-        float P3X, float P3Y) {
+        // summary and non empty histogram bins, times in milliseconds
+        bool writeJSON(const char* filename)
+        {
+            FILE* f = fopen(filename, "wb");
 
-        float numerator = P2Y * (P1X - P3X) + P1Y * (P3X - P2X) + P3Y * (P2X - P1X);
-        float denominator = (P2X - P1X) * (P1X - P3X) + (P2Y - P1Y) * (P1Y - P3Y);
-        float ratio = numerator / denominator;
+            if (!f)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "could not open %s\n", filename);
+#endif
+                return false;
+            }
 
-        float angleRad = atanf(ratio);
-        float angleDeg = (angleRad * 180) / PI;
+            frameSummary s;
+            this->getSummary(&s);
+            fprintf(f, "{\n  \"frames\": %llu,\n  \"window\": %u,\n  \"budgetMs\": %.4f,\n  \"overBudget\": %llu,\n",
+                s.frames, this->count, this->budgetNs / 1e6, s.overBudget);
+            fprintf(f, "  \"meanMs\": %.4f,\n  \"p50Ms\": %.4f,\n  \"p95Ms\": %.4f,\n  \"p99Ms\": %.4f,\n  \"maxMs\": %.4f,\n",
+                s.mean * 1e3, s.p50 * 1e3, s.p95 * 1e3, s.p99 * 1e3, s.max * 1e3);
+            fprintf(f, "  \"histogram\": [");
 
-        if (angleDeg < 0) {
-            angleDeg = 180 + angleDeg;
-        }
+            bool first = true;
+            for (uint i = 0; i < FRAME_HISTOGRAM_BINS; i++)
+            {
+                if (!this->histogram[i]) continue;
 
-        return angleDeg;
-    }
+                double end = i + 1 < FRAME_HISTOGRAM_BINS ? getBinStart(i + 1) * 1e3 : -1;
+                fprintf(f, "%s\n    { \"fromMs\": %.4f, \"toMs\": %.4f, \"count\": %llu }", first ? "" : ",",
+                    getBinStart(i) * 1e3, end, this->histogram[i]);
+                first = false;
+            }
 
-    float deg2rad(float deg)
-    {
-        return deg * PI / 180.0f;
-    }
-}
+            fprintf(f, "\n  ]\n}\n");
+            return fclose(f) == 0;
+        }
+    };
 
-namespace vi::system
-{
-    size_t getFileSize(FILE* file)
+    // time is kept as 64 bit nanoseconds so resolution doesn't drop with uptime,
+    // float accessors are kept for per frame math, use double ones for anything absolute
+    struct timer
     {
-        size_t retval = 0;
-        fseek(file, SEEK_SET, 0);
+        long long startTime;
+        long long prevTick;
+        long long gameTimeNs;
+        long long tickTimeNs;
+        // nullptr means real monotonic clock
+        virtualClock* clock;
+        // optional, gets every tick time except the first, that one includes setup and loading
+        frameStats* stats;
+        unsigned long long ticks;
 
-        while (!feof(file))
+        void init()
         {
-            fgetc(file);
-            retval++;
+            this->init(nullptr);
         }
 
-        fseek(file, SEEK_SET, 0);
-
-        return retval;
-    }
-    short wheelDelta = 0;
-    int rawMouseDeltax = 0;
-    bool focused = false;
-    int rawMouseDeltay = 0;
-    bool quitMessagePosted = false;
-    byte* readFile(const char* filename, vi::memory::alloctrack* a, size_t* outSize)
-    {
-        FILE* file = fopen(filename, "rb");
+        void init(virtualClock* clock, frameStats* stats = nullptr)
+        {
+            this->clock = clock;
+            this->stats = stats;
+            this->startTime = this->readClock();
+            this->prevTick = this->startTime;
+            this->gameTimeNs = 0;
+            this->tickTimeNs = 0;
+            this->ticks = 0;
+        }
 
-        if (!file)
+        long long readClock()
         {
-            fprintf(stderr, "Could not open %s\n", filename);
-            exit(1);
+            return this->clock ? this->clock->ns : nowNs();
         }
 
-        size_t size = getFileSize(file);
-        byte* block = a->alloc<byte>(size + 1);
-        size_t it = 0;
+        // this updates the timer so it must be called once per frame
+        void update()
+        {
+            long long currentTime = this->readClock();
+
+            this->tickTimeNs = currentTime - this->prevTick;
+            this->gameTimeNs = currentTime - this->startTime;
+            this->prevTick = currentTime;
 
-        while (true)
+            if (this->stats && this->ticks > 0) this->stats->add(this->tickTimeNs);
+            this->ticks++;
+        }
+
+        // get tick time
+        // tick time is the time between two calls to 'updateTimer'
+        // can be used as frame time if updateTimer is called once per frame
+        float getTickTimeSec()
         {
-            int c = fgetc(file);
+            return (float)this->getTickTime();
+        }
 
-            if (c == EOF)
-                break;
+        // get time since game started in seconds
+        // float has only millisecond resolution after few hours, prefer 'getGameTime'
+        float getGameTimeSec()
+        {
+            return (float)this->getGameTime();
+        }
 
-            block[it++] = c;
+        double getTickTime()
+        {
+            return (double)this->tickTimeNs / NS_PER_SEC;
         }
 
-        fclose(file);
-        block[it++] = 0;
+        double getGameTime()
+        {
+            return (double)this->gameTimeNs / NS_PER_SEC;
+        }
 
-        if (outSize)
-            *outSize = size - 1;
+        long long getTickTimeNs()
+        {
+            return this->tickTimeNs;
+        }
 
-        return block;
-    }
+        long long getGameTimeNs()
+        {
+            return this->gameTimeNs;
+        }
+    };
 
-    LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+    // Accumulator for simulation that runs at fixed step independent of frame rate.
+    // Every frame 'advance' adds frame time and returns how many steps to simulate.
+    // Leftover time (less than one step) gives 'alpha' for blending previous and current state.
+    struct fixedStep
     {
-        switch (uMsg)
+        // seconds per simulation step
+        float step;
+        // cap on steps per frame so slow machine doesn't fall further behind every frame,
+        // time over the cap is dropped and simulation runs slower than real time
+        uint maxSteps;
+        float accumulator;
+        float alpha;
+
+        void init(float step, uint maxSteps)
         {
-        case WM_SYSKEYDOWN:
+            this->step = step;
+            this->maxSteps = maxSteps;
+            this->accumulator = 0;
+            this->alpha = 0;
+        }
+
+        uint advance(float frameTime)
         {
-            if (wParam == VK_MENU)//ignore left alt stop
-            {
-            }
-            else
+            this->accumulator += frameTime;
+            uint steps = (uint)(this->accumulator / this->step);
+
+            if (steps > this->maxSteps)
             {
-                return DefWindowProc(hwnd, uMsg, wParam, lParam); // this makes ALT+F4 work
+                steps = this->maxSteps;
+                this->accumulator = steps * this->step;
             }
 
-            break;
+            this->accumulator -= steps * this->step;
+            this->alpha = this->accumulator / this->step;
+
+            return steps;
         }
-        case WM_CLOSE:
+
+        // 0 means render previous step, 1 means render current step
+        float getAlpha()
         {
-            ShowWindow(hwnd, false);
-            PostQuitMessage(0);
-            break;
+            return this->alpha;
         }
-        case WM_MOUSEWHEEL:
+    };
+}
+
+// hardware performance counters of the calling thread (Linux perf events)
+// when they can't be opened (other OS, VM without PMU, perf_event_paranoid) 'open' fails
+// with a reason in 'error' and everything else keeps working without them
+namespace vi::perf
+{
+    enum counter : uint { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, LLC_LOADS, COUNTER_COUNT };
+
+    const char* counterNames[COUNTER_COUNT] = { "cycles", "instructions", "cacheMisses", "branchMisses", "llcLoads" };
+
+    struct sample
+    {
+        unsigned long long values[COUNTER_COUNT];
+        // false for counters that could not be opened or were never scheduled
+        bool valid[COUNTER_COUNT];
+    };
+
+    // all counters are one group so they are scheduled together and ratios (IPC) are consistent
+    struct group
+    {
+        int fds[COUNTER_COUNT];
+        // position of each counter in group read, -1 if it's not open
+        int slot[COUNTER_COUNT];
+        uint opened;
+        bool available;
+        char error[128];
+
+        bool open()
         {
-            wheelDelta = GET_WHEEL_DELTA_WPARAM(wParam);
-            break;
+            this->opened = 0;
+            this->available = false;
+            this->error[0] = 0;
+            for (uint i = 0; i < COUNTER_COUNT; i++) this->fds[i] = this->slot[i] = -1;
+
+#ifdef __linux__
+            const unsigned int types[COUNTER_COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+            const unsigned long long configs[COUNTER_COUNT] = { PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+                PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16) };
+
+            for (uint i = 0; i < COUNTER_COUNT; i++)
+            {
+                perf_event_attr attr;
+                memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = types[i];
+                attr.config = configs[i];
+                // leader starts disabled and enables the whole group at once
+                attr.disabled = i == 0;
+                // user space only, allowed with default perf_event_paranoid
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+                int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, i == 0 ? -1 : this->fds[0], 0);
+
+                if (fd < 0)
+                {
+                    // without cycles there is no group, other counters are optional
+                    if (i == 0)
+                    {
+                        snprintf(this->error, sizeof(this->error), "perf_event_open failed: %s", strerror(errno));
+                        return false;
+                    }
+
+                    continue;
+                }
+
+                this->fds[i] = fd;
+                this->slot[i] = this->opened++;
+            }
+
+            ioctl(this->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(this->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            this->available = true;
+            return true;
+#else
+            snprintf(this->error, sizeof(this->error), "hardware counters are supported only on Linux");
+            return false;
+#endif
         }
-        case WM_INPUT:
+
+        void close()
         {
-            UINT dwSize = 48; // 48 for 64bit build
-            static BYTE lpb[48];
+#ifdef __linux__
+            for (uint i = 0; i < COUNTER_COUNT; i++)
+                if (this->fds[i] >= 0) ::close(this->fds[i]);
+#endif
+            for (uint i = 0; i < COUNTER_COUNT; i++) this->fds[i] = this->slot[i] = -1;
+            this->available = false;
+        }
 
-            // this gets relative coords
-            GetRawInputData((HRAWINPUT)lParam, RID_INPUT, lpb, &dwSize, sizeof(RAWINPUTHEADER));
+        // running totals since 'open', scaled if kernel had to multiplex the group
+        bool read(sample* s)
+        {
+            for (uint i = 0; i < COUNTER_COUNT; i++)
+            {
+                s->values[i] = 0;
+                s->valid[i] = false;
+            }
+
+            if (!this->available) return false;
+
+#ifdef __linux__
+            // nr, time enabled, time running, values
+            unsigned long long buffer[3 + COUNTER_COUNT];
+            ssize_t size = ::read(this->fds[0], buffer, sizeof(buffer));
+
+            if (size < (ssize_t)(sizeof(unsigned long long) * (3 + this->opened)) || buffer[2] == 0) return false;
 
-            RAWINPUT* raw = (RAWINPUT*)lpb;
+            double scale = (double)buffer[1] / buffer[2];
 
-            if (raw->header.dwType == RIM_TYPEMOUSE)
+            for (uint i = 0; i < COUNTER_COUNT; i++)
             {
-                rawMouseDeltax = raw->data.mouse.lLastX;
-                rawMouseDeltay = raw->data.mouse.lLastY;
+                if (this->slot[i] < 0) continue;
+
+                s->values[i] = (unsigned long long)(buffer[3 + this->slot[i]] * scale);
+                s->valid[i] = true;
             }
 
-            break;
-        }
-        case WM_SETFOCUS:
-            focused = true;
-            break;
-        case WM_KILLFOCUS:
-            focused = false;
-            break;
-        default:
-            return DefWindowProc(hwnd, uMsg, wParam, lParam);
+            return true;
+#else
+            return false;
+#endif
         }
+    };
 
-        return 0;
+    // 'end' minus 'begin', counter is valid only if it's valid in both
+    void difference(const sample* begin, const sample* end, sample* dst)
+    {
+        for (uint i = 0; i < COUNTER_COUNT; i++)
+        {
+            dst->valid[i] = begin->valid[i] && end->valid[i];
+            dst->values[i] = dst->valid[i] ? end->values[i] - begin->values[i] : 0;
+        }
     }
+}
 
-    struct windowInfo
+// frame profiler, compiled in only when VI_PROFILE is defined
+// VI_PROFILE_SCOPE("name") measures the rest of the enclosing block
+// VI_PROFILE_FRAME() once per frame collects what all threads recorded since the previous call
+#ifdef VI_PROFILE
+#define VI_PROFILE_CONCAT2(a, b) a##b
+#define VI_PROFILE_CONCAT(a, b) VI_PROFILE_CONCAT2(a, b)
+#define VI_PROFILE_SCOPE(name) vi::profile::scope VI_PROFILE_CONCAT(_profileScope, __LINE__)(name)
+#define VI_PROFILE_FRAME() vi::profile::frame()
+// like VI_PROFILE_SCOPE and also reads hardware counters, 'items' is how many objects the block processes
+#define VI_PROFILE_COUNTERS(name, items) \
+    vi::profile::counterScope VI_PROFILE_CONCAT(_profileCounters, __LINE__)(name, items)
+
+namespace vi::profile
+{
+    // events per thread between two 'frame' calls, more are dropped and counted
+    const uint RING_CAPACITY = 1 << 14;
+
+    struct event
     {
-        uint height;
-        uint width;
-        const char* title;
+        // must outlive the profiler, string literal is expected
+        const char* name;
+        long long begin;
+        long long end;
+        uint depth;
+        uint threadId;
     };
 
-    struct window
+    // Every thread has its own ring. Owner thread is the only writer and 'frame' the only reader,
+    // so recording an event is two atomic loads and one store, no locks.
+    struct ring
     {
-        HWND handle;
-        HINSTANCE hinstance;
-        // client height
-        uint height;
-        // client width
-        uint width;
-
-        void init(windowInfo* info)
+        event events[RING_CAPACITY];
+        std::atomic<unsigned long long> head;
+        std::atomic<unsigned long long> tail;
+        std::atomic<unsigned long long> dropped;
+        uint threadId;
+        // nesting of open scopes, touched only by owner
+        uint depth;
+
+        void push(const char* name, long long begin, long long end, uint depth)
         {
-            this->width = info->width;
-            this->height = info->height;
-            this->hinstance = GetModuleHandle(0);
-            HBRUSH bg = CreateSolidBrush(RGB(255, 0, 0));
-
-            WNDCLASS wc = { };
-            ZeroMemory(&wc, sizeof(WNDCLASS));
-            wc.lpfnWndProc = WindowProc;
-            wc.hInstance = this->hinstance;
-            wc.lpszClassName = WND_CLASSNAME;
-            wc.hbrBackground = bg;
-            RegisterClass(&wc);
+            unsigned long long h = this->head.load(std::memory_order_relaxed);
 
-            DWORD wndStyle = WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX;
-            RECT r = { 0, 0, (LONG)info->width, (LONG)info->height };
-            // this tells you what should be the window size if r is rect for client
-            // IMPORTANT. window client, swap chain and VkImages (render target) dimensions must match
-            AdjustWindowRect(&r, wndStyle, false);
-            this->handle = CreateWindowEx(0, WND_CLASSNAME, info->title, wndStyle, 100, 100,
-                r.right - r.left, r.bottom - r.top, 0, 0, this->hinstance, 0);
-#ifdef VI_VALIDATE
-            if (!this->handle)
+            if (h - this->tail.load(std::memory_order_acquire) >= RING_CAPACITY)
             {
-                fprintf(stderr, "Failed to create window");
-                exit(1);
+                this->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
             }
-#endif
-            ShowWindow(this->handle, SW_SHOW);
 
-            USHORT HID_USAGE_PAGE_GENERIC = 1;
-            USHORT HID_USAGE_GENERIC_MOUSE = 2;
+            event* e = this->events + (h & (RING_CAPACITY - 1));
+            e->name = name;
+            e->begin = begin;
+            e->end = end;
+            e->depth = depth;
+            e->threadId = this->threadId;
+            this->head.store(h + 1, std::memory_order_release);
+        }
+    };
 
-            RAWINPUTDEVICE Rid;
-            Rid.usUsagePage = HID_USAGE_PAGE_GENERIC;
-            Rid.usUsage = HID_USAGE_GENERIC_MOUSE;
-            Rid.dwFlags = RIDEV_INPUTSINK;
-            Rid.hwndTarget = this->handle;
-            RegisterRawInputDevices(&Rid, 1, sizeof(RAWINPUTDEVICE));
+    // time spent in one named scope during one frame
+    struct aggregate
+    {
+        const char* name;
+        uint depth;
+        uint calls;
+        long long totalNs;
+        long long maxNs;
+    };
 
-            SetFocus(this->handle);
+    // everything VI_PROFILE_COUNTERS measured in one named scope
+    struct counterTotal
+    {
+        const char* name;
+        unsigned long long calls;
+        unsigned long long items;
+        long long ns;
+        perf::sample counters;
+    };
+
+    struct profiler
+    {
+        // guards 'rings', taken once when a thread records its first event, and 'counters',
+        // taken at every VI_PROFILE_COUNTERS exit which already pays for reading the counters
+        std::mutex mutex;
+        std::vector<ring*> rings;
+        // scratch for events drained during 'frame'
+        std::vector<event> drained;
+        // aggregates of the last finished frame in order scopes were opened
+        std::vector<aggregate> frameAggregates;
+        std::vector<event> trace;
+        bool capturing;
+        long long captureStart;
+        long long frameStart;
+        long long frameNs;
+        unsigned long long frameIndex;
+        unsigned long long dropped;
+        // totals of VI_PROFILE_COUNTERS scopes since start or 'resetCounters', guarded by 'mutex'
+        std::vector<counterTotal> counters;
+        // reason why hardware counters are not available, empty if they are
+        char countersError[128];
+    };
+
+    profiler* get()
+    {
+        static profiler p = {};
+        return &p;
+    }
+
+    ring* getRing()
+    {
+        thread_local ring* r = nullptr;
+
+        if (!r)
+        {
+            // rings are never freed so events of finished threads are still collected
+            r = new ring();
+            profiler* p = get();
+            std::lock_guard<std::mutex> lock(p->mutex);
+            r->threadId = (uint)p->rings.size();
+            p->rings.push_back(r);
         }
 
-        void destroy()
+        return r;
+    }
+
+    struct scope
+    {
+        const char* name;
+        long long begin;
+        ring* r;
+
+        scope(const char* name)
         {
-            DestroyWindow(this->handle);
-            UnregisterClass(WND_CLASSNAME, this->hinstance);
+            this->name = name;
+            this->r = getRing();
+            this->r->depth++;
+            this->begin = time::nowNs();
         }
 
-        bool update()
+        ~scope()
         {
-            // reset delta
-            wheelDelta = 0;
-            rawMouseDeltax = 0;
-            rawMouseDeltay = 0;
+            long long end = time::nowNs();
+            this->r->depth--;
+            this->r->push(this->name, this->begin, end, this->r->depth);
+        }
+    };
 
-            MSG msg;
-            msg.message = 0;
+    // counter group of calling thread, nullptr if hardware counters are not available
+    perf::group* getGroup()
+    {
+        thread_local perf::group g = {};
+        thread_local bool opened = false;
 
-            while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+        if (!opened)
+        {
+            opened = true;
+
+            if (!g.open())
             {
-                // NEED additional check because WM_QUIT might be immediately followed by something
-                // else in the same while loop so break right away
-                if (msg.message == WM_QUIT)
+                profiler* p = get();
+                std::lock_guard<std::mutex> lock(p->mutex);
+                memcpy(p->countersError, g.error, sizeof(g.error));
+            }
+        }
+
+        return g.available ? &g : nullptr;
+    }
+
+    struct counterScope
+    {
+        scope timed;
+        const char* name;
+        unsigned long long items;
+        long long begin;
+        perf::group* g;
+        perf::sample start;
+
+        counterScope(const char* name, unsigned long long items) : timed(name)
+        {
+            this->name = name;
+            this->items = items;
+            this->g = getGroup();
+            if (this->g) this->g->read(&this->start);
+            this->begin = time::nowNs();
+        }
+
+        ~counterScope()
+        {
+            long long ns = time::nowNs() - this->begin;
+            perf::sample end = {}, delta = {};
+
+            if (this->g && this->g->read(&end)) perf::difference(&this->start, &end, &delta);
+            else perf::difference(&end, &end, &delta);
+
+            profiler* p = get();
+            std::lock_guard<std::mutex> lock(p->mutex);
+            counterTotal* t = nullptr;
+
+            for (uint i = 0; i < p->counters.size(); i++)
+            {
+                if (strcmp(p->counters[i].name, this->name) == 0)
+                {
+                    t = &p->counters[i];
                     break;
+                }
+            }
 
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
+            if (!t)
+            {
+                p->counters.push_back({});
+                t = &p->counters.back();
+                t->name = this->name;
+                for (uint i = 0; i < perf::COUNTER_COUNT; i++) t->counters.valid[i] = true;
             }
 
-            if (msg.message == WM_QUIT) return false;
-            return true;
+            t->calls++;
+            t->items += this->items;
+            t->ns += ns;
+
+            for (uint i = 0; i < perf::COUNTER_COUNT; i++)
+            {
+                t->counters.values[i] += delta.values[i];
+                t->counters.valid[i] = t->counters.valid[i] && delta.valid[i];
+            }
         }
     };
-}
 
-// d3d11
-namespace vi::gl
-{
-    const uint APPLY_TRANSFORM = 4;
-    const uint psBufferSize = 16;
-    const char rc_PixelShader[] = R"(
-Texture2D textures[1];
-SamplerState ObjSamplerState;
+    // drain all rings and build aggregates of the frame that just ended
+    void frame()
+    {
+        profiler* p = get();
+        long long now = time::nowNs();
 
-cbuffer jedziemy
-{
-	bool notexture;
-};
+        p->drained.clear();
+        {
+            std::lock_guard<std::mutex> lock(p->mutex);
 
-struct VS_OUTPUT
-{
-	float4 Pos : SV_POSITION;
-	float4 Col : COLOR;
-	float2 TexCoord : TEXCOORD;
-    uint4 data: COLOR2;
-};
+            for (uint i = 0; i < p->rings.size(); i++)
+            {
+                ring* r = p->rings[i];
+                unsigned long long t = r->tail.load(std::memory_order_relaxed);
+                unsigned long long h = r->head.load(std::memory_order_acquire);
 
-float4 main(VS_OUTPUT input) : SV_TARGET
-{
-    if(input.Col.a == 0.0f)
+                for (; t < h; t++) p->drained.push_back(r->events[t & (RING_CAPACITY - 1)]);
+
+                r->tail.store(t, std::memory_order_release);
+                p->dropped += r->dropped.exchange(0, std::memory_order_relaxed);
+            }
+        }
+
+        // scopes are pushed when they close so children come before parents, sort by start
+        std::sort(p->drained.begin(), p->drained.end(),
+            [](const event& a, const event& b) { return a.begin < b.begin; });
+
+        p->frameAggregates.clear();
+
+        for (uint i = 0; i < p->drained.size(); i++)
+        {
+            event* e = &p->drained[i];
+            long long duration = e->end - e->begin;
+            aggregate* a = nullptr;
+
+            for (uint j = 0; j < p->frameAggregates.size(); j++)
+            {
+                aggregate* candidate = &p->frameAggregates[j];
+
+                if (candidate->depth == e->depth && strcmp(candidate->name, e->name) == 0)
+                {
+                    a = candidate;
+                    break;
+                }
+            }
+
+            if (!a)
+            {
+                p->frameAggregates.push_back({ e->name, e->depth, 0, 0, 0 });
+                a = &p->frameAggregates.back();
+            }
+
+            a->calls++;
+            a->totalNs += duration;
+            if (duration > a->maxNs) a->maxNs = duration;
+        }
+
+        if (p->capturing) p->trace.insert(p->trace.end(), p->drained.begin(), p->drained.end());
+
+        p->frameNs = p->frameStart ? now - p->frameStart : 0;
+        p->frameStart = now;
+        p->frameIndex++;
+    }
+
+    // aggregates of the last frame, valid until next 'frame'
+    const std::vector<aggregate>& getFrame()
     {
-        discard;
-        return float4(0,0,0,0);
+        return get()->frameAggregates;
     }
-    else if(notexture)
+
+    // print last frame as indented tree of scopes
+    void report(FILE* f)
     {
-        return float4(input.Col.rgba);
+        profiler* p = get();
+
+        fprintf(f, "frame %llu: %.3f ms, dropped events %llu\n", p->frameIndex, p->frameNs / 1e6, p->dropped);
+
+        for (uint i = 0; i < p->frameAggregates.size(); i++)
+        {
+            aggregate* a = &p->frameAggregates[i];
+            fprintf(f, "%*s%-*s %6u calls %9.3f ms total %9.3f ms max\n", a->depth * 2, "",
+                32 - (int)a->depth * 2, a->name, a->calls, a->totalNs / 1e6, a->maxNs / 1e6);
+        }
     }
-    else
+
+    void resetCounters()
     {
-		float4 result = textures[0].Sample(ObjSamplerState, input.TexCoord);
-        if(result.a == 0.0f)
-            discard;
-		return result * input.Col;
+        profiler* p = get();
+        std::lock_guard<std::mutex> lock(p->mutex);
+        p->counters.clear();
     }
-}
-)";
 
-    const char rc_VertexShader[] = R"(
-struct sprite
-{
-    float x,y,z;
-    float sx,sy;
-    float rot;
-    float ox,oy;
-    float4 uv;
-    float4 color;
-};
+    // totals of VI_PROFILE_COUNTERS scopes: time and misses per item, instructions per cycle
+    void reportCounters(FILE* f)
+    {
+        profiler* p = get();
+        std::lock_guard<std::mutex> lock(p->mutex);
 
-struct camera
-{
-	float aspectRatio;
-	float x;
-	float y;
-	float rotation;
-	float scale;
-};
+        if (p->countersError[0]) fprintf(f, "hardware counters unavailable (%s), only time is shown\n", p->countersError);
 
-cbuffer jedziemy: register(b0)
-{
-	sprite spr;
-};
+        fprintf(f, "%-24s %10s %12s %10s %6s %14s %14s %14s\n", "scope", "calls", "items", "ns/item", "IPC",
+            "cacheMiss/item", "branchMiss/item", "llcLoad/item");
 
-cbuffer poziolo: register(b1)
-{
-	camera camObj;
-};
+        for (uint i = 0; i < p->counters.size(); i++)
+        {
+            counterTotal* t = &p->counters[i];
+            perf::sample* c = &t->counters;
+            double items = t->items ? (double)t->items : 1;
+            double ipc = c->valid[perf::CYCLES] && c->valid[perf::INSTRUCTIONS] && c->values[perf::CYCLES] ?
+                (double)c->values[perf::INSTRUCTIONS] / c->values[perf::CYCLES] : -1;
 
-struct VS_OUTPUT
+            fprintf(f, "%-24s %10llu %12llu %10.2f", t->name, t->calls, t->items, t->ns / items);
+            if (ipc >= 0) fprintf(f, " %6.2f", ipc);
+            else fprintf(f, " %6s", "-");
+
+            for (uint j = perf::CACHE_MISSES; j <= perf::LLC_LOADS; j++)
+            {
+                if (c->valid[j]) fprintf(f, " %14.4f", c->values[j] / items);
+                else fprintf(f, " %14s", "-");
+            }
+
+            fprintf(f, "\n");
+        }
+    }
+
+    // keep events of every frame from now until 'endCapture'
+    void beginCapture()
+    {
+        profiler* p = get();
+        p->trace.clear();
+        p->capturing = true;
+        p->captureStart = time::nowNs();
+    }
+
+    // write captured events as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+    bool endCapture(const char* filename)
+    {
+        profiler* p = get();
+        p->capturing = false;
+        FILE* f = fopen(filename, "wb");
+
+        if (!f)
+        {
+#ifdef VI_VALIDATE
+            fprintf(stderr, "could not open %s\n", filename);
+#endif
+            return false;
+        }
+
+        fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        for (uint i = 0; i < p->trace.size(); i++)
+        {
+            event* e = &p->trace[i];
+            fprintf(f, "%s{\"name\":\"", i ? ",\n" : "");
+
+            // names are literals but keep the file valid whatever they contain
+            for (const char* c = e->name; *c; c++)
+            {
+                if (*c == '"' || *c == '\\') fputc('\\', f);
+                if ((byte)*c >= 0x20) fputc(*c, f);
+            }
+
+            fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", e->threadId,
+                (e->begin - p->captureStart) / 1e3, (e->end - e->begin) / 1e3);
+        }
+
+        fprintf(f, "\n]}\n");
+        bool ok = fclose(f) == 0;
+        p->trace.clear();
+        return ok;
+    }
+}
+#else
+#define VI_PROFILE_SCOPE(name)
+#define VI_PROFILE_FRAME()
+#define VI_PROFILE_COUNTERS(name, items)
+#endif
+
+namespace vi::util
 {
-	float4 Pos : SV_POSITION;
-	float4 Col : COLOR;
-	float2 TexCoord : TEXCOORD;
-    uint4 data: COLOR2;
-};
+    template<typename T>
+    void swap(T& a, T& b)
+    {
+        T tmp = a;
+        a = b;
+        b = tmp;
+    }
 
-static float4 vertices[6] = {
-    float4(-0.5f, -0.5f, 1.0f, 1.0f),
-    float4(0.5f, -0.5f, 0.0f, 1.0f),
-    float4(-0.5f, 0.5f, 1.0f, 0.0f),
-    float4(-0.5f, 0.5f, 1.0f, 0.0f),
-    float4(0.5f, -0.5f, 0.0f, 1.0f),
-	float4(0.5f, 0.5f, 0.0f, 0.0f)
-};
+    // zero out memory at dst sizeof(T)
+    template<typename T>
+    void zero(T* dst)
+    {
+        memset(dst, 0, sizeof(T));
+    }
 
-static uint2 uv[6] = {
-    uint2(0,3),
-    uint2(2,3),
-    uint2(0,1),
-    uint2(0,1),
-    uint2(2,3),
-	uint2(2,1)
-};
+    template<typename T>
+    void zeron(T* dst, uint len)
+    {
+        memset(dst, 0, sizeof(T) * len);
+    }
 
-VS_OUTPUT main(uint vid : SV_VertexID)
+    struct rng
+    {
+        std::mt19937 mt;
+        std::uniform_int_distribution<int> distr;
+
+        void init(int min, int max)
+        {
+            mt.seed(::time(0));
+            this->distr = std::uniform_int_distribution<int>(min, max);
+
+            // warm up
+            for (int i = 0; i < 100; i++)
+                this->rnd();
+        }
+
+        /// <summary>
+        /// get random number between min and max inclusive
+        /// </summary>
+        int rnd()
+        {
+            return this->distr(this->mt);
+        }
+    };
+
+    // 64bit FNV-1a, 'seed' can be used to chain calls over multiple blocks
+    unsigned long long hash64(const void* data, size_t len, unsigned long long seed = 14695981039346656037ull)
+    {
+        const byte* p = (const byte*)data;
+        unsigned long long h = seed;
+
+        for (size_t i = 0; i < len; i++)
+        {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+
+        return h;
+    }
+
+    template<typename T>
+    T* find(T* arr, uint len, std::function<bool(T*)> pred)
+    {
+        for (uint i = 0; i < len; i++)
+        {
+            if (pred(arr + i)) return arr + i;
+        }
+
+        return nullptr;
+    }
+}
+
+namespace vi::math
 {
-	// camera
-    // that is correct camera transformation
-    // includes aspect ratio adjustment and it FIRST moves camera to postion and then scales
-    // so when zooming, it always zooms around the center of the screen
-	float4x4 cam = float4x4(
-		1/camObj.aspectRatio * camObj.scale, 0, 0, 1/camObj.aspectRatio * camObj.scale * -camObj.x,
-		0, camObj.scale, 0, -camObj.scale * -camObj.y,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	);
+    const float PI = 3.1415926f;
+    const float TWO_PI = PI * 2;
+    const float HALF_PI = PI / 2;
+    const float THIRD_PI = PI / 3;
+    const float FORTH_PI = PI / 4;
+    const float THREE_HALVES_PI = PI * 1.5f;
+    const float DEGREE = PI / 180;
 
-    // hack do draw a line because I dont want to write a new VS for this
-    if(spr.z < 0)
+    // magnitude of a vector
+    float mag2D(float x, float y)
     {
-        // this is for point A
-        float4 pos = float4(spr.x,spr.y,0,1.0f);
-        // this is for point B
-        if(vid > 0)
-            pos = float4(spr.sx,spr.sy,0,1.0f);
-        VS_OUTPUT output;
-	    output.Pos = mul(cam, pos);
-        output.Pos.z = -spr.z;
-        if(vid > 0)
-            output.Pos.z = -spr.rot;
-	    output.Col = spr.color;
-        output.TexCoord = float2(0,0);
-        output.data = float4(0,0,0,0);
-	    return output;
+        return sqrtf(x * x + y * y);
     }
 
-	// origin
-	float4x4 ori = float4x4(
-		1, 0, 0, -spr.ox,
-		0, 1, 0, spr.oy,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	);
-	// scale
-	float4x4 sca = float4x4(
-		spr.sx, 0, 0, 0,
-		0, spr.sy, 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	);
-	// rot
-	float4x4 rot = float4x4(
-		cos(spr.rot), sin(spr.rot), 0, 0,
-		-sin(spr.rot), cos(spr.rot), 0, 0,
-		0, 0, 1, 0,
-		0, 0, 0, 1
-	);
-	// loc
-	float4x4 loc = float4x4(
-		1, 0, 0, spr.x,
-		0, 1, 0, -spr.y,
-		0, 0, 1, 0,
-		0, 0, 0, 1 // z from transform is not put over here because it's on the vertex itself
-	);
-	float4 pos = float4(vertices[vid].x,vertices[vid].y,0,1.0f);
+    // magnitude squared of a vector
+    float mag2Dsq(float x, float y)
+    {
+        return x * x + y * y;
+    }
+
+    // normalize src vector (x,y), result is dst vector (dstx, dsty)
+    void norm2D(float x, float y, float* dstx, float* dsty)
+    {
+        float mag = mag2D(x, y);
+        *dstx = x / mag;
+        *dsty = y / mag;
+    }
+
+    float distance2D(float x1, float y1, float x2, float y2)
+    {
+        return sqrtf((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+    }
+
+    float distance2Dsq(float x1, float y1, float x2, float y2)
+    {
+        return (x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1);
+    }
+
+    // sets velx, vely in such way that object will move from start to dst at speed 'speed'
+    void moveTo(float startx, float starty, float dstx, float dsty, float speed, float* velx, float* vely)
+    {
+        float dx = dstx - startx;
+        float dy = dsty - starty;
+        norm2D(dx, dy, velx, vely);
+        *velx *= speed;
+        *vely *= speed;
+    }
+
+    // calculates the angle when (x,y) points at (targetx,targety)
+    float lookAt(float x, float y, float targetx, float targety, float* rot)
+    {
+        // not implemented
+        assert(false);
+        return 0;
+    }
+
+    // rot point (x,y) around origin (ox, oy) by angle
+    void rot2D(float x, float y, float ox, float oy, float angle, float* dstx, float* dsty)
+    {
+        float px = x - ox;
+        float py = y - oy;
+        float dx = px * cosf(angle) - py * sinf(angle);
+        float dy = px * sinf(angle) + py * cosf(angle);
+        *dstx = dx + ox;
+        *dsty = dy + oy;
+    }
+
+    // calc angle p1,p2,p3
+    float calcAngle2D(float P1X, float P1Y, float P2X, float P2Y,
+        float P3X, float P3Y) {
+
+        float numerator = P2Y * (P1X - P3X) + P1Y * (P3X - P2X) + P3Y * (P2X - P1X);
+        float denominator = (P2X - P1X) * (P1X - P3X) + (P2Y - P1Y) * (P1Y - P3Y);
+        float ratio = numerator / denominator;
+
+        float angleRad = atanf(ratio);
+        float angleDeg = (angleRad * 180) / PI;
+
+        if (angleDeg < 0) {
+            angleDeg = 180 + angleDeg;
+        }
+
+        return angleDeg;
+    }
+
+    float deg2rad(float deg)
+    {
+        return deg * PI / 180.0f;
+    }
+}
+
+namespace vi::system
+{
+    // size of open file in bytes, position is set to the beginning
+    size_t getFileSize(FILE* file)
+    {
+#ifdef _WIN32
+        _fseeki64(file, 0, SEEK_END);
+        size_t size = (size_t)_ftelli64(file);
+#else
+        fseeko(file, 0, SEEK_END);
+        size_t size = (size_t)ftello(file);
+#endif
+        fseek(file, 0, SEEK_SET);
+
+        return size;
+    }
+    // wheel and raw deltas are sums of all messages since last window::update
+    short wheelDelta = 0;
+    int rawMouseDeltax = 0;
+    bool focused = false;
+    int rawMouseDeltay = 0;
+    bool quitMessagePosted = false;
+
+    enum class inputEventType : byte
+    {
+        // x is virtual key code, mouse buttons included
+        KeyDown,
+        KeyUp,
+        // x is the character
+        Char,
+        // x, y are client coordinates
+        MouseMove,
+        // x is wheel delta
+        Wheel,
+        // x, y are raw mouse deltas
+        RawMouse,
+        // focus lost, every key counts as released
+        ReleaseAll
+    };
+
+    struct inputEvent
+    {
+        long long timeNs;
+        int x;
+        int y;
+        inputEventType type;
+    };
+
+    // input of the current frame in the order it came, filled by window message pump
+    // and cleared at the start of window::update, keyboard::update consumes it
+    inputEvent inputEvents[INPUT_EVENT_CAPACITY];
+    uint inputEventCount = 0;
+    uint inputEventsDropped = 0;
+
+    void pushInputEvent(inputEventType type, int x, int y = 0)
+    {
+        if (inputEventCount == INPUT_EVENT_CAPACITY)
+        {
+            inputEventsDropped++;
+            return;
+        }
+
+        inputEvents[inputEventCount++] = { vi::time::nowNs(), x, y, type };
+    }
+
+    // read whole file to memory allocated from 'a'
+    // extra 0 is appended so text file can be used as string, 'outSize' doesn't count it
+    // use 'mappedFile' if you don't need a copy
+    byte* readFile(const char* filename, vi::memory::alloctrack* a, size_t* outSize)
+    {
+        FILE* file = fopen(filename, "rb");
+
+        if (!file)
+        {
+            fprintf(stderr, "Could not open %s\n", filename);
+            exit(1);
+        }
+
+        size_t size = getFileSize(file);
+        byte* block = a->alloc<byte>(size + 1);
+        size_t read = fread(block, 1, size, file);
+
+        fclose(file);
+        block[read] = 0;
+
+        if (outSize)
+            *outSize = read;
+
+        return block;
+    }
+
+    // size in bytes and last write time of a file without opening it
+    // time is only meaningful when compared to another value from this function
+    bool getFileStamp(const char* filename, unsigned long long* size, unsigned long long* time)
+    {
+#ifdef _WIN32
+        WIN32_FILE_ATTRIBUTE_DATA fad;
+
+        if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &fad))
+            return false;
+
+        *size = ((unsigned long long)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+        *time = ((unsigned long long)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+#else
+        struct stat st;
+
+        if (stat(filename, &st) != 0)
+            return false;
+
+        *size = (unsigned long long)st.st_size;
+        *time = (unsigned long long)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+#endif
+
+        return true;
+    }
+
+    // moves 'from' over 'to' in one step so 'to' is never seen half written
+    // on Linux views of old 'to' stay valid, on Windows this fails while 'to' is open
+    bool replaceFile(const char* from, const char* to)
+    {
+#ifdef _WIN32
+        return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return rename(from, to) == 0;
+#endif
+    }
+
+    // read only view of a whole file, pages are loaded by the OS on first access
+    // if file can't be mapped (some network and virtual file systems) it's read to memory instead
+    // 'data' stays valid until 'close'
+    struct mappedFile
+    {
+        byte* data;
+        size_t size;
+        // true if 'data' is a copy and not a mapping
+        bool owned;
+#ifdef _WIN32
+        HANDLE file;
+        HANDLE mapping;
+#else
+        // -1 when not open, 0 is a valid descriptor
+        int fd;
+#endif
+
+        // fallback when mapping fails, reads in big blocks to 'data'
+        bool _readAll()
+        {
+            this->data = (byte*)malloc(this->size);
+            this->owned = true;
+            size_t done = 0;
+
+            while (done < this->size)
+            {
+#ifdef _WIN32
+                DWORD chunk = this->size - done > 0x40000000 ? 0x40000000 : (DWORD)(this->size - done);
+                DWORD n = 0;
+                if (!ReadFile(this->file, this->data + done, chunk, &n, 0) || n == 0) return false;
+#else
+                ssize_t n = ::read(this->fd, this->data + done, this->size - done);
+                if (n <= 0) return false;
+#endif
+                done += n;
+            }
+
+            return true;
+        }
+
+        // returns false if file doesn't exist, is empty or could not be mapped
+        bool open(const char* filename)
+        {
+            util::zero(this);
+#ifdef _WIN32
+            this->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+            if (this->file == INVALID_HANDLE_VALUE)
+            {
+                this->file = 0;
+                return false;
+            }
+
+            LARGE_INTEGER li;
+
+            if (!GetFileSizeEx(this->file, &li) || li.QuadPart == 0)
+            {
+                this->close();
+                return false;
+            }
+
+            this->size = (size_t)li.QuadPart;
+            this->mapping = CreateFileMappingA(this->file, 0, PAGE_READONLY, 0, 0, 0);
+
+            if (this->mapping)
+                this->data = (byte*)MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+
+            if (!this->data && !this->_readAll())
+            {
+                this->close();
+                return false;
+            }
+#else
+            this->fd = ::open(filename, O_RDONLY);
+
+            if (this->fd < 0) return false;
+
+            struct stat st;
+
+            if (fstat(this->fd, &st) != 0 || st.st_size == 0)
+            {
+                this->close();
+                return false;
+            }
+
+            this->size = (size_t)st.st_size;
+            void* ptr = mmap(0, this->size, PROT_READ, MAP_PRIVATE, this->fd, 0);
+            this->data = ptr == MAP_FAILED ? nullptr : (byte*)ptr;
+
+            if (!this->data && !this->_readAll())
+            {
+                this->close();
+                return false;
+            }
+#endif
+
+            return true;
+        }
+
+        // ask OS to start reading [offset, offset + len) in background because it will be needed soon
+        void willNeed(size_t offset, size_t len)
+        {
+            if (this->owned || offset >= this->size) return;
+            if (len > this->size - offset) len = this->size - offset;
+#ifdef _WIN32
+            WIN32_MEMORY_RANGE_ENTRY range = { this->data + offset, len };
+            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+            // madvise wants page aligned address
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t aligned = offset & ~(page - 1);
+            madvise(this->data + aligned, len + offset - aligned, MADV_WILLNEED);
+#endif
+        }
+
+        // file will be read front to back, OS can read ahead more aggressively and drop pages behind
+        void sequential()
+        {
+            if (this->owned) return;
+#ifdef _WIN32
+            // there is no equivalent for views, prefetch everything instead
+            this->willNeed(0, this->size);
+#else
+            madvise(this->data, this->size, MADV_SEQUENTIAL);
+#endif
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (this->owned) ::free(this->data);
+            else if (this->data) UnmapViewOfFile(this->data);
+            if (this->mapping) CloseHandle(this->mapping);
+            if (this->file) CloseHandle(this->file);
+#else
+            if (this->owned) ::free(this->data);
+            else if (this->data) munmap(this->data, this->size);
+            if (this->fd >= 0) ::close(this->fd);
+#endif
+            util::zero(this);
+#ifndef _WIN32
+            this->fd = -1;
+#endif
+        }
+    };
+
+    // Reads file front to back in fixed size chunks, for files that are too big to have
+    // in memory at once or when processing can start before the whole file is read.
+    // OS is asked to prefetch 'readAhead' bytes past the chunk being returned.
+    struct fileStream
+    {
+        byte* buffer;
+        size_t chunkSize;
+        size_t readAhead;
+        // file offset of the next chunk
+        size_t offset;
+        size_t size;
+#ifdef _WIN32
+        HANDLE file;
+#else
+        int fd;
+#endif
+
+        bool open(const char* filename, size_t chunkSize, size_t readAhead)
+        {
+            util::zero(this);
+            this->chunkSize = chunkSize;
+            this->readAhead = readAhead;
+#ifdef _WIN32
+            // sequential scan flag makes cache manager read ahead on its own, 'readAhead' is not used
+            this->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+
+            if (this->file == INVALID_HANDLE_VALUE)
+            {
+                this->file = 0;
+                return false;
+            }
+
+            LARGE_INTEGER li;
+
+            if (!GetFileSizeEx(this->file, &li))
+            {
+                this->close();
+                return false;
+            }
+
+            this->size = (size_t)li.QuadPart;
+#else
+            this->fd = ::open(filename, O_RDONLY);
+
+            if (this->fd < 0) return false;
+
+            struct stat st;
+
+            if (fstat(this->fd, &st) != 0)
+            {
+                this->close();
+                return false;
+            }
+
+            this->size = (size_t)st.st_size;
+            posix_fadvise(this->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            posix_fadvise(this->fd, 0, chunkSize + readAhead, POSIX_FADV_WILLNEED);
+#endif
+            this->buffer = (byte*)malloc(chunkSize);
+
+            if (!this->buffer)
+            {
+                this->close();
+                return false;
+            }
+
+            return true;
+        }
+
+        // returns false at the end of file or on error
+        // 'data' is valid until next call
+        bool next(byte** data, size_t* len)
+        {
+            if (this->offset >= this->size) return false;
+
+            size_t want = this->size - this->offset < this->chunkSize ? this->size - this->offset : this->chunkSize;
+            size_t done = 0;
+
+            while (done < want)
+            {
+#ifdef _WIN32
+                DWORD n = 0;
+                if (!ReadFile(this->file, this->buffer + done, (DWORD)(want - done), &n, 0) || n == 0) return false;
+#else
+                ssize_t n = ::read(this->fd, this->buffer + done, want - done);
+                if (n <= 0) return false;
+#endif
+                done += n;
+            }
+
+            this->offset += done;
+#ifndef _WIN32
+            // whole next chunk and 'readAhead' past it, earlier advice may not have covered all of it
+            if (this->readAhead)
+                posix_fadvise(this->fd, this->offset, this->chunkSize + this->readAhead, POSIX_FADV_WILLNEED);
+#endif
+            *data = this->buffer;
+            *len = done;
+            return true;
+        }
+
+        void close()
+        {
+            ::free(this->buffer);
+#ifdef _WIN32
+            if (this->file) CloseHandle(this->file);
+#else
+            if (this->fd >= 0) ::close(this->fd);
+#endif
+            util::zero(this);
+#ifndef _WIN32
+            this->fd = -1;
+#endif
+        }
+    };
+
+#ifdef _WIN32
+
+    // messages only say shift, control or alt, left and right are told apart here
+    int getSidedKey(WPARAM wParam, LPARAM lParam)
+    {
+        bool extended = (lParam >> 24) & 1;
+
+        switch (wParam)
+        {
+        case VK_SHIFT: return (int)MapVirtualKey((lParam >> 16) & 0xff, MAPVK_VSC_TO_VK_EX);
+        case VK_CONTROL: return extended ? VK_RCONTROL : VK_LCONTROL;
+        case VK_MENU: return extended ? VK_RMENU : VK_LMENU;
+        }
+
+        return (int)wParam;
+    }
+
+    void pushMouseButton(HWND hwnd, int key, bool down, WPARAM wParam)
+    {
+        pushInputEvent(down ? inputEventType::KeyDown : inputEventType::KeyUp, key);
+
+        // keep getting button up when it's released outside of the window
+        if (down)
+            SetCapture(hwnd);
+        else if (!(wParam & (MK_LBUTTON | MK_RBUTTON | MK_MBUTTON | MK_XBUTTON1 | MK_XBUTTON2)))
+            ReleaseCapture();
+    }
+
+    LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+    {
+        switch (uMsg)
+        {
+        case WM_KEYDOWN:
+        {
+            // bit 30 is set for auto repeat, key is already down
+            if (!(lParam & (1 << 30)))
+                pushInputEvent(inputEventType::KeyDown, getSidedKey(wParam, lParam));
+            break;
+        }
+        case WM_KEYUP:
+        {
+            pushInputEvent(inputEventType::KeyUp, getSidedKey(wParam, lParam));
+            break;
+        }
+        case WM_SYSKEYDOWN:
+        {
+            if (!(lParam & (1 << 30)))
+                pushInputEvent(inputEventType::KeyDown, getSidedKey(wParam, lParam));
+
+            if (wParam == VK_MENU)//ignore left alt stop
+            {
+            }
+            else
+            {
+                return DefWindowProc(hwnd, uMsg, wParam, lParam); // this makes ALT+F4 work
+            }
+
+            break;
+        }
+        case WM_SYSKEYUP:
+        {
+            pushInputEvent(inputEventType::KeyUp, getSidedKey(wParam, lParam));
+            return DefWindowProc(hwnd, uMsg, wParam, lParam);
+        }
+        case WM_CHAR:
+        {
+            pushInputEvent(inputEventType::Char, (int)wParam);
+            break;
+        }
+        case WM_LBUTTONDOWN: pushMouseButton(hwnd, VK_LBUTTON, true, wParam); break;
+        case WM_LBUTTONUP: pushMouseButton(hwnd, VK_LBUTTON, false, wParam); break;
+        case WM_RBUTTONDOWN: pushMouseButton(hwnd, VK_RBUTTON, true, wParam); break;
+        case WM_RBUTTONUP: pushMouseButton(hwnd, VK_RBUTTON, false, wParam); break;
+        case WM_MBUTTONDOWN: pushMouseButton(hwnd, VK_MBUTTON, true, wParam); break;
+        case WM_MBUTTONUP: pushMouseButton(hwnd, VK_MBUTTON, false, wParam); break;
+        case WM_XBUTTONDOWN:
+        case WM_XBUTTONUP:
+        {
+            int key = GET_XBUTTON_WPARAM(wParam) == XBUTTON1 ? VK_XBUTTON1 : VK_XBUTTON2;
+            pushMouseButton(hwnd, key, uMsg == WM_XBUTTONDOWN, wParam);
+            return TRUE;
+        }
+        case WM_MOUSEMOVE:
+        {
+            pushInputEvent(inputEventType::MouseMove, (short)LOWORD(lParam), (short)HIWORD(lParam));
+            break;
+        }
+        case WM_CLOSE:
+        {
+            ShowWindow(hwnd, false);
+            PostQuitMessage(0);
+            break;
+        }
+        case WM_MOUSEWHEEL:
+        {
+            short delta = GET_WHEEL_DELTA_WPARAM(wParam);
+            wheelDelta += delta;
+            pushInputEvent(inputEventType::Wheel, delta);
+            break;
+        }
+        case WM_INPUT:
+        {
+            RAWINPUT raw;
+            UINT size = sizeof(raw);
+
+            // this gets relative coords
+            if (GetRawInputData((HRAWINPUT)lParam, RID_INPUT, &raw, &size, sizeof(RAWINPUTHEADER)) == (UINT)-1)
+                break;
+
+            if (raw.header.dwType == RIM_TYPEMOUSE)
+            {
+                // several of these come per frame with high polling rate mice
+                rawMouseDeltax += raw.data.mouse.lLastX;
+                rawMouseDeltay += raw.data.mouse.lLastY;
+                pushInputEvent(inputEventType::RawMouse, raw.data.mouse.lLastX, raw.data.mouse.lLastY);
+            }
+
+            break;
+        }
+        case WM_SETFOCUS:
+            focused = true;
+            break;
+        case WM_KILLFOCUS:
+            focused = false;
+            // key ups go to the window that has focus now
+            pushInputEvent(inputEventType::ReleaseAll, 0);
+            break;
+        default:
+            return DefWindowProc(hwnd, uMsg, wParam, lParam);
+        }
+
+        return 0;
+    }
+
+    struct windowInfo
+    {
+        uint height;
+        uint width;
+        const char* title;
+    };
+
+    struct window
+    {
+        HWND handle;
+        HINSTANCE hinstance;
+        // client height
+        uint height;
+        // client width
+        uint width;
+
+        void init(windowInfo* info)
+        {
+            this->width = info->width;
+            this->height = info->height;
+            this->hinstance = GetModuleHandle(0);
+            HBRUSH bg = CreateSolidBrush(RGB(255, 0, 0));
+
+            WNDCLASS wc = { };
+            ZeroMemory(&wc, sizeof(WNDCLASS));
+            wc.lpfnWndProc = WindowProc;
+            wc.hInstance = this->hinstance;
+            wc.lpszClassName = WND_CLASSNAME;
+            wc.hbrBackground = bg;
+            RegisterClass(&wc);
+
+            DWORD wndStyle = WS_SYSMENU | WS_CAPTION | WS_MINIMIZEBOX;
+            RECT r = { 0, 0, (LONG)info->width, (LONG)info->height };
+            // this tells you what should be the window size if r is rect for client
+            // IMPORTANT. window client, swap chain and VkImages (render target) dimensions must match
+            AdjustWindowRect(&r, wndStyle, false);
+            this->handle = CreateWindowEx(0, WND_CLASSNAME, info->title, wndStyle, 100, 100,
+                r.right - r.left, r.bottom - r.top, 0, 0, this->hinstance, 0);
+#ifdef VI_VALIDATE
+            if (!this->handle)
+            {
+                fprintf(stderr, "Failed to create window");
+                exit(1);
+            }
+#endif
+            ShowWindow(this->handle, SW_SHOW);
+
+            USHORT HID_USAGE_PAGE_GENERIC = 1;
+            USHORT HID_USAGE_GENERIC_MOUSE = 2;
+
+            RAWINPUTDEVICE Rid;
+            Rid.usUsagePage = HID_USAGE_PAGE_GENERIC;
+            Rid.usUsage = HID_USAGE_GENERIC_MOUSE;
+            Rid.dwFlags = RIDEV_INPUTSINK;
+            Rid.hwndTarget = this->handle;
+            RegisterRawInputDevices(&Rid, 1, sizeof(RAWINPUTDEVICE));
+
+            SetFocus(this->handle);
+        }
+
+        void destroy()
+        {
+            DestroyWindow(this->handle);
+            UnregisterClass(WND_CLASSNAME, this->hinstance);
+        }
+
+        bool update()
+        {
+            VI_PROFILE_SCOPE("window::update");
+#ifdef VI_VALIDATE
+            if (inputEventsDropped)
+                fprintf(stderr, "%u input events dropped, raise INPUT_EVENT_CAPACITY\n", inputEventsDropped);
+#endif
+            inputEventsDropped = 0;
+            // reset delta
+            wheelDelta = 0;
+            rawMouseDeltax = 0;
+            rawMouseDeltay = 0;
+            inputEventCount = 0;
+
+            MSG msg;
+            msg.message = 0;
+
+            while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+            {
+                // NEED additional check because WM_QUIT might be immediately followed by something
+                // else in the same while loop so break right away
+                if (msg.message == WM_QUIT)
+                    break;
+
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+
+            if (msg.message == WM_QUIT) return false;
+            return true;
+        }
+    };
+#endif
+}
+
+namespace vi::pack
+{
+    // 'VPAK' in little endian
+    const uint PACK_MAGIC = 0x4b415056;
+    const uint PACK_VERSION = 1;
+    // entry payload is compressed with 'compress'
+    const uint ENTRY_COMPRESSED = 1;
+
+    // Pack file layout:
+    // header, directory (entryCount entries sorted by nameHash), payloads
+    // every payload starts at multiple of 'alignment'
+    struct header
+    {
+        uint magic;
+        uint version;
+        uint entryCount;
+        uint alignment;
+    };
+
+    struct entry
+    {
+        unsigned long long nameHash;
+        // byte offset from the beginning of the file
+        unsigned long long offset;
+        // size in the file
+        uint size;
+        // size after decompression, same as 'size' if not compressed
+        uint originalSize;
+        uint flags;
+        uint padding;
+    };
+
+    // '\\' is treated as '/' so names are the same on every platform
+    unsigned long long hashName(const char* name)
+    {
+        unsigned long long h = 14695981039346656037ull;
+
+        for (const char* c = name; *c; c++)
+        {
+            char ch = *c == '\\' ? '/' : *c;
+            h = util::hash64(&ch, 1, h);
+        }
+
+        return h;
+    }
+
+    // Small LZ77 compressor, it's meant for fast decompression not for ratio.
+    // Stream is a list of sequences: token, literal length extension, literals,
+    // match offset (2 bytes), match length extension. High nibble of token is literal length
+    // low nibble is match length - 4, value 15 means more bytes follow (255 means keep going).
+    // Last sequence has only literals.
+    const uint LZ_MIN_MATCH = 4;
+    const uint LZ_HASH_BITS = 14;
+    const uint LZ_MAX_OFFSET = 65535;
+
+    // max size of compressed data for 'size' bytes of input
+    uint compressBound(uint size)
+    {
+        return size + size / 255 + 16;
+    }
+
+    byte* _lzWriteLength(byte* dst, uint len)
+    {
+        while (len >= 255)
+        {
+            *dst++ = 255;
+            len -= 255;
+        }
+
+        *dst++ = (byte)len;
+        return dst;
+    }
+
+    byte* _lzWriteSequence(byte* dst, const byte* literals, uint literalLen, uint offset, uint matchLen)
+    {
+        byte* token = dst++;
+        uint matchCode = matchLen ? matchLen - LZ_MIN_MATCH : 0;
+        *token = (byte)(((literalLen < 15 ? literalLen : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+
+        if (literalLen >= 15) dst = _lzWriteLength(dst, literalLen - 15);
+        memcpy(dst, literals, literalLen);
+        dst += literalLen;
+
+        if (matchLen)
+        {
+            *dst++ = (byte)offset;
+            *dst++ = (byte)(offset >> 8);
+            if (matchCode >= 15) dst = _lzWriteLength(dst, matchCode - 15);
+        }
+
+        return dst;
+    }
+
+    // 'dst' must have at least 'compressBound(size)' bytes, returns compressed size
+    uint compress(const byte* src, uint size, byte* dst)
+    {
+        std::vector<uint> table(1 << LZ_HASH_BITS, 0xffffffff);
+        byte* out = dst;
+        uint anchor = 0;
+        uint i = 0;
+
+        while (size >= LZ_MIN_MATCH && i <= size - LZ_MIN_MATCH)
+        {
+            uint seq;
+            memcpy(&seq, src + i, 4);
+            uint slot = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+            uint candidate = table[slot];
+            table[slot] = i;
+
+            if (candidate == 0xffffffff || i - candidate > LZ_MAX_OFFSET || memcmp(src + candidate, src + i, 4) != 0)
+            {
+                i++;
+                continue;
+            }
+
+            uint len = LZ_MIN_MATCH;
+            while (i + len < size && src[candidate + len] == src[i + len]) len++;
+
+            out = _lzWriteSequence(out, src + anchor, i - anchor, i - candidate, len);
+            i += len;
+            anchor = i;
+        }
+
+        out = _lzWriteSequence(out, src + anchor, size - anchor, 0, 0);
+        return (uint)(out - dst);
+    }
+
+    // returns false if 'src' is malformed or doesn't decompress to exactly 'dstSize' bytes
+    bool decompress(const byte* src, uint size, byte* dst, uint dstSize)
+    {
+        const byte* in = src;
+        const byte* inEnd = src + size;
+        byte* out = dst;
+        byte* outEnd = dst + dstSize;
+
+        while (in < inEnd)
+        {
+            byte token = *in++;
+            size_t literalLen = token >> 4;
+
+            if (literalLen == 15)
+            {
+                byte b;
+                do
+                {
+                    if (in >= inEnd) return false;
+                    b = *in++;
+                    literalLen += b;
+                } while (b == 255);
+            }
+
+            if ((size_t)(inEnd - in) < literalLen || (size_t)(outEnd - out) < literalLen) return false;
+            memcpy(out, in, literalLen);
+            in += literalLen;
+            out += literalLen;
+
+            // last sequence
+            if (in == inEnd) break;
+
+            if (inEnd - in < 2) return false;
+            size_t offset = in[0] | (in[1] << 8);
+            in += 2;
+            size_t matchLen = (token & 15);
+
+            if (matchLen == 15)
+            {
+                byte b;
+                do
+                {
+                    if (in >= inEnd) return false;
+                    b = *in++;
+                    matchLen += b;
+                } while (b == 255);
+            }
+
+            matchLen += LZ_MIN_MATCH;
+
+            if (offset == 0 || offset > (size_t)(out - dst) || (size_t)(outEnd - out) < matchLen) return false;
+
+            // byte by byte because match can overlap with itself
+            const byte* match = out - offset;
+            for (size_t j = 0; j < matchLen; j++) out[j] = match[j];
+            out += matchLen;
+        }
+
+        return out == outEnd;
+    }
+
+    // Read only pack file. It's mapped once and entries are views into the mapping
+    // so they stay valid until 'close'.
+    struct archive
+    {
+        system::mappedFile file;
+        header* h;
+        entry* entries;
+
+        // returns false if file is missing or is not a valid pack
+        bool open(const char* filename)
+        {
+            this->h = nullptr;
+            this->entries = nullptr;
+
+            if (!this->file.open(filename)) return false;
+
+            header* h = (header*)this->file.data;
+            bool valid = this->file.size >= sizeof(header) &&
+                h->magic == PACK_MAGIC &&
+                h->version == PACK_VERSION &&
+                this->file.size >= sizeof(header) + (size_t)h->entryCount * sizeof(entry);
+
+            entry* entries = (entry*)(this->file.data + sizeof(header));
+            for (uint i = 0; valid && i < h->entryCount; i++)
+                valid = entries[i].offset <= this->file.size && entries[i].size <= this->file.size - entries[i].offset;
+
+            if (!valid)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "%s is not a valid pack\n", filename);
+#endif
+                this->file.close();
+                return false;
+            }
+
+            this->h = h;
+            this->entries = entries;
+            return true;
+        }
+
+        void close()
+        {
+            this->file.close();
+            this->h = nullptr;
+            this->entries = nullptr;
+        }
+
+        // binary search in directory, returns nullptr if not found
+        entry* find(const char* name)
+        {
+            unsigned long long hash = hashName(name);
+            uint lo = 0;
+            uint hi = this->h->entryCount;
+
+            while (lo < hi)
+            {
+                uint mid = (lo + hi) / 2;
+                if (this->entries[mid].nameHash < hash) lo = mid + 1;
+                else hi = mid;
+            }
+
+            if (lo < this->h->entryCount && this->entries[lo].nameHash == hash)
+                return this->entries + lo;
+
+            return nullptr;
+        }
+
+        // zero copy view of entry payload
+        // returns false if entry is missing or compressed (use 'extract' for these)
+        bool view(const char* name, byte** data, uint* size)
+        {
+            entry* e = this->find(name);
+            if (!e || (e->flags & ENTRY_COMPRESSED)) return false;
+
+            *data = this->file.data + e->offset;
+            *size = e->size;
+            return true;
+        }
+
+        // copy or decompress entry to 'dst' which must have 'e->originalSize' bytes
+        bool extract(entry* e, byte* dst)
+        {
+            const byte* src = this->file.data + e->offset;
+
+            if (e->flags & ENTRY_COMPRESSED)
+                return decompress(src, e->size, dst, e->originalSize);
+
+            memcpy(dst, src, e->size);
+            return true;
+        }
+    };
+
+    // collects entries in memory and writes pack file
+    struct builder
+    {
+        struct item
+        {
+            unsigned long long nameHash;
+            std::vector<byte> data;
+            uint originalSize;
+            uint flags;
+        };
+
+        std::vector<item> items;
+        uint alignment;
+
+        // 'alignment' must be power of 2, 16 is enough for SIMD, page size lets payloads be mapped on their own
+        void init(uint alignment)
+        {
+            this->items.clear();
+            this->alignment = alignment;
+        }
+
+        // 'compress' is a hint, data is stored compressed only if it saves at least 1/8 of the size
+        // returns false if name (or its hash) is already in the pack
+        bool add(const char* name, const byte* data, uint size, bool compress)
+        {
+            item it;
+            it.nameHash = hashName(name);
+            it.originalSize = size;
+            it.flags = 0;
+
+            for (uint i = 0; i < this->items.size(); i++)
+            {
+                if (this->items[i].nameHash == it.nameHash)
+                {
+#ifdef VI_VALIDATE
+                    fprintf(stderr, "%s is already in the pack\n", name);
+#endif
+                    return false;
+                }
+            }
+
+            if (compress && size > 0)
+            {
+                it.data.resize(compressBound(size));
+                uint compressed = pack::compress(data, size, it.data.data());
+
+                if (compressed < size - size / 8)
+                {
+                    it.data.resize(compressed);
+                    it.flags = ENTRY_COMPRESSED;
+                }
+            }
+
+            if (!it.flags) it.data.assign(data, data + size);
+
+            this->items.push_back(std::move(it));
+            return true;
+        }
+
+        bool addFile(const char* name, const char* path, bool compress)
+        {
+            system::mappedFile f;
+
+            if (!f.open(path))
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "Could not open %s\n", path);
+#endif
+                return false;
+            }
+
+            bool result = this->add(name, f.data, (uint)f.size, compress);
+            f.close();
+            return result;
+        }
+
+        bool write(const char* filename)
+        {
+            std::sort(this->items.begin(), this->items.end(),
+                [](const item& a, const item& b) { return a.nameHash < b.nameHash; });
+
+            header h;
+            h.magic = PACK_MAGIC;
+            h.version = PACK_VERSION;
+            h.entryCount = (uint)this->items.size();
+            h.alignment = this->alignment;
+
+            std::vector<entry> directory(this->items.size());
+            unsigned long long offset = sizeof(header) + sizeof(entry) * directory.size();
+
+            for (uint i = 0; i < this->items.size(); i++)
+            {
+                offset = (offset + this->alignment - 1) & ~(unsigned long long)(this->alignment - 1);
+                directory[i].nameHash = this->items[i].nameHash;
+                directory[i].offset = offset;
+                directory[i].size = (uint)this->items[i].data.size();
+                directory[i].originalSize = this->items[i].originalSize;
+                directory[i].flags = this->items[i].flags;
+                directory[i].padding = 0;
+                offset += directory[i].size;
+            }
+
+            FILE* file = fopen(filename, "wb");
+
+            if (!file)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "Could not open %s\n", filename);
+#endif
+                return false;
+            }
+
+            bool ok = fwrite(&h, sizeof(h), 1, file) == 1 &&
+                fwrite(directory.data(), sizeof(entry), directory.size(), file) == directory.size();
+            unsigned long long written = sizeof(header) + sizeof(entry) * directory.size();
+            std::vector<byte> padding(this->alignment, 0);
+
+            for (uint i = 0; ok && i < this->items.size(); i++)
+            {
+                size_t paddingSize = (size_t)(directory[i].offset - written);
+                ok = fwrite(padding.data(), 1, paddingSize, file) == paddingSize &&
+                    fwrite(this->items[i].data.data(), 1, directory[i].size, file) == directory[i].size;
+                written = directory[i].offset + directory[i].size;
+            }
+
+            fclose(file);
+            return ok;
+        }
+    };
+}
+
+namespace vi::png
+{
+    const byte SIGNATURE[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+
+    enum colorType : byte { GRAY = 0, RGB = 2, PALETTE = 3, GRAY_ALPHA = 4, RGBA = 6 };
+
+    uint _readBE(const byte* p)
+    {
+        return ((uint)p[0] << 24) | ((uint)p[1] << 16) | ((uint)p[2] << 8) | p[3];
+    }
+
+    // bytes per pixel in filtered stream
+    uint _channels(byte type)
+    {
+        switch (type)
+        {
+        case GRAY: return 1;
+        case RGB: return 3;
+        case PALETTE: return 1;
+        case GRAY_ALPHA: return 2;
+        case RGBA: return 4;
+        default: return 0;
+        }
+    }
+
+    // reads IHDR, returns false if it's not a PNG or it's something 'decoder' doesn't handle:
+    // bit depth other than 8 or interlacing
+    bool getInfo(const byte* file, size_t len, uint* width, uint* height, byte* type)
+    {
+        // signature, IHDR length, type and 13 bytes of data
+        if (len < 33 || memcmp(file, SIGNATURE, 8) != 0 || memcmp(file + 12, "IHDR", 4) != 0)
+            return false;
+
+        const byte* ihdr = file + 16;
+        *width = _readBE(ihdr);
+        *height = _readBE(ihdr + 4);
+        *type = ihdr[9];
+        byte depth = ihdr[8];
+        byte interlace = ihdr[12];
+
+        return depth == 8 && interlace == 0 && _channels(*type) != 0 &&
+            *width > 0 && *height > 0 && *width < (1 << 24) && *height < (1 << 24);
+    }
+
+    // Row unfiltering, 'prior' is previous reconstructed row (zeros for the first row),
+    // 'out' can't overlap 'raw' or 'prior'.
+    // 3 and 4 bytes per pixel use SSE2, one pixel per iteration for Sub, Average and Paeth
+    // because each pixel depends on the one to the left, Up has no dependency so it does 16 bytes at once.
+    inline __m128i _load(const byte* p, uint bpp)
+    {
+        int v = 0;
+        memcpy(&v, p, bpp);
+        return _mm_cvtsi32_si128(v);
+    }
+
+    inline void _store(byte* p, __m128i v, uint bpp)
+    {
+        int x = _mm_cvtsi128_si32(v);
+        memcpy(p, &x, bpp);
+    }
+
+    void _unfilterUp(const byte* raw, const byte* prior, byte* out, size_t n)
+    {
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i r = _mm_loadu_si128((const __m128i*)(raw + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(prior + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(r, b));
+        }
+        for (; i < n; i++) out[i] = raw[i] + prior[i];
+    }
+
+    void _unfilterSub(const byte* raw, byte* out, size_t n, uint bpp)
+    {
+        __m128i a = _mm_setzero_si128();
+        for (size_t i = 0; i < n; i += bpp)
+        {
+            a = _mm_add_epi8(a, _load(raw + i, bpp));
+            _store(out + i, a, bpp);
+        }
+    }
+
+    void _unfilterAverage(const byte* raw, const byte* prior, byte* out, size_t n, uint bpp)
+    {
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i a = _mm_setzero_si128();
+        for (size_t i = 0; i < n; i += bpp)
+        {
+            __m128i b = _load(prior + i, bpp);
+            // avg_epu8 rounds up, png wants floor
+            __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+            a = _mm_add_epi8(_load(raw + i, bpp), avg);
+            _store(out + i, a, bpp);
+        }
+    }
+
+    inline __m128i _abs16(__m128i x)
+    {
+        return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+    }
+
+    inline __m128i _select(__m128i mask, __m128i a, __m128i b)
+    {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    void _unfilterPaeth(const byte* raw, const byte* prior, byte* out, size_t n, uint bpp)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        // a = left, b = above, c = above left, all unpacked to 16 bit
+        __m128i a = zero;
+        __m128i c = zero;
+        for (size_t i = 0; i < n; i += bpp)
+        {
+            __m128i b = _mm_unpacklo_epi8(_load(prior + i, bpp), zero);
+            __m128i d = _mm_unpacklo_epi8(_load(raw + i, bpp), zero);
+            // p = a + b - c, pa = |p - a| = |b - c|, pb = |p - b| = |a - c|, pc = |p - c| = |b - c + a - c|
+            __m128i pa = _mm_sub_epi16(b, c);
+            __m128i pb = _mm_sub_epi16(a, c);
+            __m128i pc = _abs16(_mm_add_epi16(pa, pb));
+            pa = _abs16(pa);
+            pb = _abs16(pb);
+            // ties go to a, then b
+            __m128i nearest = _select(_mm_cmplt_epi16(pb, pa), b, a);
+            __m128i smallest = _mm_min_epi16(pa, pb);
+            nearest = _select(_mm_cmplt_epi16(pc, smallest), c, nearest);
+            a = _mm_and_si128(_mm_add_epi16(d, nearest), _mm_set1_epi16(0xff));
+            _store(out + i, _mm_packus_epi16(a, zero), bpp);
+            c = b;
+        }
+    }
+
+    // plain version for 1 and 2 bytes per pixel
+    byte _paeth(int a, int b, int c)
+    {
+        int p = a + b - c;
+        int pa = abs(p - a);
+        int pb = abs(p - b);
+        int pc = abs(p - c);
+        if (pa <= pb && pa <= pc) return (byte)a;
+        if (pb <= pc) return (byte)b;
+        return (byte)c;
+    }
+
+    bool _unfilter(byte filter, const byte* raw, const byte* prior, byte* out, size_t n, uint bpp)
+    {
+        bool simd = bpp >= 3;
+
+        switch (filter)
+        {
+        case 0:
+            memcpy(out, raw, n);
+            return true;
+        case 1:
+            if (simd) _unfilterSub(raw, out, n, bpp);
+            else for (size_t i = 0; i < n; i++) out[i] = raw[i] + (i >= bpp ? out[i - bpp] : 0);
+            return true;
+        case 2:
+            _unfilterUp(raw, prior, out, n);
+            return true;
+        case 3:
+            if (simd) _unfilterAverage(raw, prior, out, n, bpp);
+            else for (size_t i = 0; i < n; i++) out[i] = raw[i] + (((i >= bpp ? out[i - bpp] : 0) + prior[i]) >> 1);
+            return true;
+        case 4:
+            if (simd) _unfilterPaeth(raw, prior, out, n, bpp);
+            else for (size_t i = 0; i < n; i++)
+                out[i] = raw[i] + _paeth(i >= bpp ? out[i - bpp] : 0, prior[i], i >= bpp ? prior[i - bpp] : 0);
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool _hasSSSE3()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+#else
+        return __builtin_cpu_supports("ssse3");
+#endif
+    }
+
+    // returns how many pixels were expanded, the rest is left to the scalar loop
+    VI_TARGET_SSSE3 uint _expandRGBSSSE3(const byte* src, byte* dst, uint count)
+    {
+        uint i = 0;
+        const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+        // 16 bytes are loaded but only 12 used, stop early enough to not read past the row
+        for (; i + 6 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 3));
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+        }
+
+        return i;
+    }
+
+    // 'src' must be readable for one byte past the last pixel
+    void _expandRGB(const byte* src, byte* dst, uint count)
+    {
+        static const bool ssse3 = _hasSSSE3();
+        uint i = ssse3 ? _expandRGBSSSE3(src, dst, count) : 0;
+
+        // 4 bytes are loaded and the 4th (next pixel's red) is replaced with alpha
+        for (; i < count; i++)
+        {
+            uint v;
+            memcpy(&v, src + i * 3, 4);
+            v |= 0xff000000;
+            memcpy(dst + i * 4, &v, 4);
+        }
+    }
+
+    void _expandGray(const byte* src, byte* dst, uint count)
+    {
+        uint i = 0;
+        const __m128i alpha = _mm_set1_epi8((char)0xff);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m128i g = _mm_loadu_si128((const __m128i*)(src + i));
+            // gg pairs and g,255 pairs interleaved again give g,g,g,255
+            __m128i gglo = _mm_unpacklo_epi8(g, g);
+            __m128i gghi = _mm_unpackhi_epi8(g, g);
+            __m128i galo = _mm_unpacklo_epi8(g, alpha);
+            __m128i gahi = _mm_unpackhi_epi8(g, alpha);
+            _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_unpacklo_epi16(gglo, galo));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 16), _mm_unpackhi_epi16(gglo, galo));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 32), _mm_unpacklo_epi16(gghi, gahi));
+            _mm_storeu_si128((__m128i*)(dst + i * 4 + 48), _mm_unpackhi_epi16(gghi, gahi));
+        }
+        for (; i < count; i++)
+        {
+            dst[i * 4] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i];
+            dst[i * 4 + 3] = 255;
+        }
+    }
+
+    void _expandGrayAlpha(const byte* src, byte* dst, uint count)
+    {
+        for (uint i = 0; i < count; i++)
+        {
+            dst[i * 4] = dst[i * 4 + 1] = dst[i * 4 + 2] = src[i * 2];
+            dst[i * 4 + 3] = src[i * 2 + 1];
+        }
+    }
+
+    // palette is expanded beforehand to RGBA table so each pixel is a single 32 bit load
+    void _expandPalette(const byte* src, byte* dst, uint count, const uint* table)
+    {
+        uint* out = (uint*)dst;
+        uint i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            out[i] = table[src[i]];
+            out[i + 1] = table[src[i + 1]];
+            out[i + 2] = table[src[i + 2]];
+            out[i + 3] = table[src[i + 3]];
+        }
+        for (; i < count; i++) out[i] = table[src[i]];
+    }
+
+    // PNG decoder for formats we ship: 8 bit gray, gray alpha, RGB, RGBA and palette, not interlaced.
+    // Pixels are written as RGBA8 to memory given by caller. Scratch buffers are kept between calls
+    // so decoding many files with the same decoder doesn't allocate after the first few.
+    // Decoder is not thread safe, use one per thread.
+    struct decoder
+    {
+        // IDAT chunks concatenated, used only if there is more than one
+        std::vector<byte> compressed;
+        // inflated stream, filter byte + row for every row
+        std::vector<byte> filtered;
+        // two reconstructed rows for formats that are expanded to RGBA afterwards
+        std::vector<byte> rows;
+
+        // 'dst' must have width * height * 4 bytes (see 'getInfo')
+        // returns false if format is not supported or file is corrupted, stb can be used then
+        bool decode(const byte* file, size_t len, byte* dst, size_t dstSize)
+        {
+            uint width, height;
+            byte type;
+
+            if (!getInfo(file, len, &width, &height, &type)) return false;
+            if (dstSize < (size_t)width * height * 4) return false;
+
+            uint bpp = _channels(type);
+            uint palette[256];
+            uint paletteSize = 0;
+            const byte* idat = nullptr;
+            size_t idatSize = 0;
+            uint idatCount = 0;
+            this->compressed.clear();
+
+            // walk chunks, IHDR is already validated
+            size_t pos = 8;
+            while (pos + 12 <= len)
+            {
+                uint size = _readBE(file + pos);
+                const byte* type4 = file + pos + 4;
+                const byte* data = file + pos + 8;
+
+                if (size > len - pos - 12) return false;
+
+                if (memcmp(type4, "IDAT", 4) == 0)
+                {
+                    // one IDAT is inflated in place, more are joined first
+                    if (idatCount == 1) this->compressed.assign(idat, idat + idatSize);
+                    if (idatCount >= 1) this->compressed.insert(this->compressed.end(), data, data + size);
+                    idat = data;
+                    idatSize = size;
+                    idatCount++;
+                }
+                else if (memcmp(type4, "PLTE", 4) == 0)
+                {
+                    paletteSize = size / 3;
+                    if (paletteSize > 256) return false;
+                    for (uint i = 0; i < paletteSize; i++)
+                        palette[i] = data[i * 3] | (data[i * 3 + 1] << 8) | (data[i * 3 + 2] << 16) | 0xff000000u;
+                    for (uint i = paletteSize; i < 256; i++) palette[i] = 0xff000000u;
+                }
+                else if (memcmp(type4, "tRNS", 4) == 0)
+                {
+                    // color key transparency is rare, leave it to stb
+                    if (type != PALETTE || size > paletteSize) return false;
+                    for (uint i = 0; i < size; i++)
+                        palette[i] = (palette[i] & 0x00ffffffu) | ((uint)data[i] << 24);
+                }
+                else if (memcmp(type4, "IEND", 4) == 0)
+                {
+                    break;
+                }
+
+                pos += 12 + size;
+            }
+
+            if (idatCount == 0 || (type == PALETTE && paletteSize == 0)) return false;
+
+            if (idatCount > 1)
+            {
+                idat = this->compressed.data();
+                idatSize = this->compressed.size();
+            }
+
+            size_t stride = (size_t)width * bpp;
+            size_t filteredSize = (stride + 1) * height;
+            this->filtered.resize(filteredSize);
+
+            int inflated = stbi_zlib_decode_buffer((char*)this->filtered.data(), (int)filteredSize,
+                (const char*)idat, (int)idatSize);
+            if (inflated != (int)filteredSize) return false;
+
+            // row 0 is zeros used as prior for the first row, +16 so expansion can read past the last pixel
+            this->rows.assign(stride * 3 + 16, 0);
+            byte* zeros = this->rows.data();
+            byte* rowA = zeros + stride;
+            byte* rowB = rowA + stride;
+
+            for (uint y = 0; y < height; y++)
+            {
+                const byte* raw = this->filtered.data() + y * (stride + 1);
+                byte* out = dst + (size_t)y * width * 4;
+
+                if (type == RGBA)
+                {
+                    // nothing to expand, reconstruct straight into 'dst'
+                    const byte* prior = y ? out - (size_t)width * 4 : zeros;
+                    if (!_unfilter(raw[0], raw + 1, prior, out, stride, bpp)) return false;
+                    continue;
+                }
+
+                const byte* prior = y ? rowA : zeros;
+                if (!_unfilter(raw[0], raw + 1, prior, rowB, stride, bpp)) return false;
+
+                switch (type)
+                {
+                case RGB: _expandRGB(rowB, out, width); break;
+                case GRAY: _expandGray(rowB, out, width); break;
+                case GRAY_ALPHA: _expandGrayAlpha(rowB, out, width); break;
+                case PALETTE: _expandPalette(rowB, out, width, palette); break;
+                }
+
+                util::swap(rowA, rowB);
+            }
+
+            return true;
+        }
+    };
+
+    // decode any image stb can decode, PNGs go through 'd'
+    // returns RGBA8 pixels allocated with STBI_MALLOC (free with stbi_image_free) or nullptr
+    byte* load(decoder* d, const byte* file, size_t len, int* width, int* height)
+    {
+        uint w, h;
+        byte type;
+
+        if (getInfo(file, len, &w, &h, &type))
+        {
+            size_t size = (size_t)w * h * 4;
+            byte* pixels = (byte*)STBI_MALLOC(size);
+            if (!pixels) return nullptr;
+
+            if (d->decode(file, len, pixels, size))
+            {
+                *width = (int)w;
+                *height = (int)h;
+                return pixels;
+            }
+
+            stbi_image_free(pixels);
+        }
+
+        int n;
+        return stbi_load_from_memory(file, (int)len, width, height, &n, 4);
+    }
+}
+
+#ifdef _WIN32
+// d3d11
+namespace vi::gl
+{
+    const uint APPLY_TRANSFORM = 4;
+    const uint psBufferSize = 16;
+    const char rc_PixelShader[] = R"(
+Texture2D textures[1];
+SamplerState ObjSamplerState;
+
+cbuffer jedziemy
+{
+	bool notexture;
+};
+
+struct VS_OUTPUT
+{
+	float4 Pos : SV_POSITION;
+	float4 Col : COLOR;
+	float2 TexCoord : TEXCOORD;
+    uint4 data: COLOR2;
+};
+
+float4 main(VS_OUTPUT input) : SV_TARGET
+{
+    if(input.Col.a == 0.0f)
+    {
+        discard;
+        return float4(0,0,0,0);
+    }
+    else if(notexture)
+    {
+        return float4(input.Col.rgba);
+    }
+    else
+    {
+		float4 result = textures[0].Sample(ObjSamplerState, input.TexCoord);
+        if(result.a == 0.0f)
+            discard;
+		return result * input.Col;
+    }
+}
+)";
+
+    const char rc_VertexShader[] = R"(
+struct sprite
+{
+    float x,y,z;
+    float sx,sy;
+    float rot;
+    float ox,oy;
+    float4 uv;
+    float4 color;
+};
+
+struct camera
+{
+	float aspectRatio;
+	float x;
+	float y;
+	float rotation;
+	float scale;
+};
+
+cbuffer jedziemy: register(b0)
+{
+	sprite spr;
+};
+
+cbuffer poziolo: register(b1)
+{
+	camera camObj;
+};
+
+struct VS_OUTPUT
+{
+	float4 Pos : SV_POSITION;
+	float4 Col : COLOR;
+	float2 TexCoord : TEXCOORD;
+    uint4 data: COLOR2;
+};
+
+static float4 vertices[6] = {
+    float4(-0.5f, -0.5f, 1.0f, 1.0f),
+    float4(0.5f, -0.5f, 0.0f, 1.0f),
+    float4(-0.5f, 0.5f, 1.0f, 0.0f),
+    float4(-0.5f, 0.5f, 1.0f, 0.0f),
+    float4(0.5f, -0.5f, 0.0f, 1.0f),
+	float4(0.5f, 0.5f, 0.0f, 0.0f)
+};
+
+static uint2 uv[6] = {
+    uint2(0,3),
+    uint2(2,3),
+    uint2(0,1),
+    uint2(0,1),
+    uint2(2,3),
+	uint2(2,1)
+};
+
+VS_OUTPUT main(uint vid : SV_VertexID)
+{
+	// camera
+    // that is correct camera transformation
+    // includes aspect ratio adjustment and it FIRST moves camera to postion and then scales
+    // so when zooming, it always zooms around the center of the screen
+	float4x4 cam = float4x4(
+		1/camObj.aspectRatio * camObj.scale, 0, 0, 1/camObj.aspectRatio * camObj.scale * -camObj.x,
+		0, camObj.scale, 0, -camObj.scale * -camObj.y,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+
+    // hack do draw a line because I dont want to write a new VS for this
+    if(spr.z < 0)
+    {
+        // this is for point A
+        float4 pos = float4(spr.x,spr.y,0,1.0f);
+        // this is for point B
+        if(vid > 0)
+            pos = float4(spr.sx,spr.sy,0,1.0f);
+        VS_OUTPUT output;
+	    output.Pos = mul(cam, pos);
+        output.Pos.z = -spr.z;
+        if(vid > 0)
+            output.Pos.z = -spr.rot;
+	    output.Col = spr.color;
+        output.TexCoord = float2(0,0);
+        output.data = float4(0,0,0,0);
+	    return output;
+    }
+
+	// origin
+	float4x4 ori = float4x4(
+		1, 0, 0, -spr.ox,
+		0, 1, 0, spr.oy,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+	// scale
+	float4x4 sca = float4x4(
+		spr.sx, 0, 0, 0,
+		0, spr.sy, 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+	// rot
+	float4x4 rot = float4x4(
+		cos(spr.rot), sin(spr.rot), 0, 0,
+		-sin(spr.rot), cos(spr.rot), 0, 0,
+		0, 0, 1, 0,
+		0, 0, 0, 1
+	);
+	// loc
+	float4x4 loc = float4x4(
+		1, 0, 0, spr.x,
+		0, 1, 0, -spr.y,
+		0, 0, 1, 0,
+		0, 0, 0, 1 // z from transform is not put over here because it's on the vertex itself
+	);
+	float4 pos = float4(vertices[vid].x,vertices[vid].y,0,1.0f);
+
+	VS_OUTPUT output;
+	output.Pos = mul(mul(mul(mul(mul(cam,loc), rot), sca), ori), pos);
+    output.Pos.z = spr.z;
+	output.Col = spr.color;
+    int u = uv[vid].x;
+    int v = uv[vid].y;
+    output.TexCoord = float2(spr.uv[u],spr.uv[v]);
+    output.data = float4(0,0,0,0);
+
+	return output;
+}
+)";
+
+    const char rc_VertexShaderMesh[] = R"(
+struct VertexInputType
+{
+    float3 pos : POSITION;
+    float2 TexCoord : TEXCOORD;
+    float4 light : LIGHT;
+};
+
+struct world
+{
+    float x,y,z, pad1;
+    float q1,q2,q3, pad2;
+    float sx,sy,sz;
+    uint data;
+    float4 color;
+};
+
+struct view
+{
+    float aspectRatio,fovy,near,far;
+    float eyex,eyey,eyez;
+    float atx,aty,atz;
+    float upx,upy,upz;
+};
+
+cbuffer jedziemy: register(b0)
+{
+    world w;
+};
+
+cbuffer poziolo : register(b1)
+{
+	view v;
+};
+
+cbuffer testb : register(b2)
+{
+    float4x4 transform;
+};
+
+struct VS_OUTPUT
+{
+	float4 Pos : SV_POSITION;
+	float4 Col : COLOR;
+	float2 TexCoord : TEXCOORD;
+    uint4 data: COLOR2;
+};
+
+float4x4 calcWorldViewProj(bool transform)
+{
+    float4x4 worldMat = {1,0,0,0, 0,1,0,0, 0,0,1,1, 0,0,0,1};
+
+    if(transform)
+{
+    float cr = cos(w.q1 * 0.5);
+    float sr = sin(w.q1 * 0.5);
+    float cp = cos(w.q2 * 0.5);
+    float sp = sin(w.q2 * 0.5);
+    float cy = cos(w.q3 * 0.5);
+    float sy = sin(w.q3 * 0.5);
+    float qw = cr * cp * cy + sr * sp * sy;
+    float qx = sr * cp * cy - cr * sp * sy;
+    float qy = cr * sp * cy + sr * cp * sy;
+    float qz = cr * cp * sy - sr * sp * cy;
+    float4x4 rotMat = {
+        qw*qw+qx*qx-qy*qy-qz*qz, 2*(qx*qy-qw*qz), 2*(qw*qy+qx*qz),0,
+        2*(qx*qy+qw*qz),qw*qw-qx*qx+qy*qy-qz*qz,2*(qy*qz-qw*qx),0,
+        2*(qx*qz-qw*qy),2*(qw*qx+qy*qz),qw*qw-qx*qx-qy*qy+qz*qz,0,
+        0,0,0,1
+    };
+    
+    float4x4 locMat = {
+            1,0,0, w.x,
+            0,1,0, w.y,
+            0,0,1, w.z,
+            0,0,0, 1,
+        };
+
+    float4x4 scaleMat = {
+        w.sx,0,0,0,
+        0,w.sy,0,0,
+        0,0,w.sz,0,
+        0,0,0,1
+    };
+
+    worldMat = mul(locMat, mul(rotMat, scaleMat));
+}
+    
+    float3 eye = {v.eyex, v.eyey, v.eyez};
+    float3 at = {v.atx,v.aty,v.atz};
+    float3 up = {v.upx,v.upy,v.upz};
+    float3 zaxis = normalize(at - eye);
+    float3 xaxis = normalize(cross(up, zaxis));
+    float3 yaxis = cross(zaxis, xaxis);
+    float4x4 viewMat = {
+        xaxis.x, xaxis.y, xaxis.z, -dot( xaxis, eye ),
+        yaxis.x, yaxis.y, yaxis.z, -dot( yaxis, eye ),
+        zaxis.x, zaxis.y, zaxis.z, -dot( zaxis, eye ),
+        0,0,0,1
+    };
+
+    // left handed
+    float h = 1/tan(v.fovy*0.5);
+    float4x4 projMat = {
+        h/v.aspectRatio, 0, 0, 0,
+        0, h, 0, 0,
+        0, 0, v.far/(v.far-v.near), (-v.near*v.far)/(v.far-v.near),
+        0, 0, 1, 0
+    };
+
+    float4x4 worldViewProj = mul(projMat, mul(viewMat, worldMat));
+    return worldViewProj;
+}
+
+VS_OUTPUT main(VertexInputType data, uint vid : SV_VertexID)
+{
+	float4 pos = float4(data.pos.x,data.pos.y,data.pos.z,1.0f);
+
+	VS_OUTPUT output;
+
+if(w.data == 16)
+{
+if(vid == 0)
+            pos = float4(w.x,w.y,w.z,1.0f);
+        if(vid == 1)
+            pos = float4(w.q1,w.q2,w.q3,1.0f);
+        if(vid == 2)
+            pos = float4(w.x,w.y,w.z,1.0f);
+        output.Pos = mul(calcWorldViewProj(false),pos);
+        output.Col = float4(w.color.r,w.color.g,w.color.b,1);
+	    output.TexCoord = float2(0,0);
+output.data = uint4(w.data,0,0,0);
+return output;
+}   
+
+    if(w.data & 4)
+    {
+	    output.Pos = mul(transform,pos);
+    }
+    else if(w.data & 8)
+    {
+        output.Pos = pos;
+        output.Col = float4(data.light);
+	    output.TexCoord = float2(data.TexCoord[0],data.TexCoord[1]);
+        output.data = uint4(w.data,0,0,0);
+	    return output;
+    }        
+    else
+    {
+        output.Pos = mul(calcWorldViewProj(true),pos);
+    }
+
+	output.Col = w.color;
+    output.Col.a = 1;
+	output.TexCoord = float2(data.TexCoord[0],data.TexCoord[1]);
+    output.data = uint4(w.data,0,0,0);
+
+	return output;
+}
+)";
+
+    struct vector4
+    {
+        float x, y, z, w;
+    };
+
+    struct vector3
+    {
+        float x, y, z;
+    };
+
+    struct camera
+    {
+        float aspectRatio;
+        float x;
+        float y;
+        float rotation;
+        float scale;
+        // padding because this struct must be multiple of 16bytes
+        byte padding[12];
+    };
+
+    struct camera3D
+    {
+        float aspectRatio;
+        float fovy;
+        float znear;
+        float zfar;
+        /// <summary>
+        /// where camera is
+        /// </summary>
+        vector3 eye;
+        /// <summary>
+        /// where camera looks at
+        /// </summary>
+        vector3 at;
+        /// <summary>
+        /// up vector, usually (0,1,0)
+        /// </summary>
+        vector3 up;
+        // padding because this struct must be multiple of 16bytes
+        float padding[3];
+    };
+
+    struct vector2
+    {
+        float x, y;
+    };
+
+    struct color
+    {
+        float r, g, b, a;
+    };
+
+    struct uv
+    {
+        float left, top, right, bottom;
+    };
+
+    struct texture
+    {
+        int index;
+        int width;
+        int height;
+        ID3D11ShaderResourceView* shaderResource;
+    };
+
+    // WARNING !!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+    // you updating something ? update shaders as well
+    // struct passed to uniform buffer must be multiple of 16bytes
+    struct sprite1
+    {
+        float x;
+        float y;
+        float z;
+        // scale x
+        float sx;
+
+        // 16 byte
+
+        // scale y
+        float sy;
+        // angle
+        float rot;
+        // origin x
+        float ox;
+        // origin y
+        float oy;
+
+        // 16 byte
+
+        // uv left
+        float left;
+        // uv top
+        float top;
+        // uv right
+        float right;
+        // uv bottom
+        float bottom;
+
+        // 16 byte
+
+        float r;
+        float g;
+        float b;
+        float a;
+
+        // 16 byte
+        // some extra settings
+        uint nodraw : 1;
+        /// <summary>
+        /// no need to set manually, set to true if no texture on sprite
+        /// </summary>
+        uint notexture : 1;
+        uint padding : 30;
+
+        texture* t;
+    };
+
+    struct sprite2
+    {
+        vector3 pos;
+        vector2 scale;
+        float rot;
+        vector2 origin;
+        uv uv1;
+        color col;
+        uint flags;
+        texture* t;
+    };
+
+    struct line
+    {
+        float x1;
+        float y1;
+        float z1;
+        float x2;
+        float y2;
+        float z2;
+        float _1;
+        float _2;
+        float _3;
+        float _4;
+        float _5;
+        float _6;
+        float r;
+        float g;
+        float b;
+        float a;
+    };
+
+    // 16 bytes alignment, although I'm not sure it's necessary
+    _declspec(align(16))
+        union sprite
+    {
+        sprite1 s1;
+        sprite2 s2;
+        line line;
+
+        // makes minimum changes to make object show when drawn
+        void init(texture* t)
+        {
+            vi::util::zero(this);
+            this->s1.t = t;
+            this->s2.col = { 1,1,1,1 };
+            this->s2.scale = { 1,1 };
+            this->s2.uv1 = { 0,0,1,1 };
+        }
+    };
+
+    // TODO, this should replace sprite
+    _declspec(align(16))
+        union spriten
+    {
+        struct
+        {
+            vector3 pos;
+            vector2 scale;
+            float rot;
+            vector2 origin;
+            uv uv1;
+            color col;
+            uint flags;
+            texture* t;
+        };
+        struct
+        {
+            float x;
+            float y;
+            float z;
+            // scale x
+            float sx;
+
+            // 16 byte
+
+            // scale y
+            float sy;
+            // angle
+            float rot;
+            // origin x
+            float ox;
+            // origin y
+            float oy;
+
+            // 16 byte
+
+            // uv left
+            float left;
+            // uv top
+            float top;
+            // uv right
+            float right;
+            // uv bottom
+            float bottom;
+
+            // 16 byte
+
+            float r;
+            float g;
+            float b;
+            float a;
+
+            // 16 byte
+            // some extra settings
+            uint nodraw : 1;
+            /// <summary>
+            /// no need to set manually, set to true if no texture on sprite
+            /// </summary>
+            uint notexture : 1;
+            uint padding : 30;
+
+            texture* t;
+        };
+    };
+
+    struct dynamic
+    {
+        sprite* s;
+        time::timer* t;
+        float velx, vely, velz;
+        float accx, accy, accz;
+        // angular velocity
+        float velrot;
+        // angular acceleration
+        float accrot;
+        // grow speed
+        float velsx, velsy;
+        // grow acceleration
+        float accsx, accsy;
+        double _lastUpdate;
+
+        void init(sprite* s, time::timer* t)
+        {
+            vi::util::zero(this);
+            this->s = s;
+            this->t = t;
+            this->_lastUpdate = t->getGameTime();
+        }
+
+        void update()
+        {
+            double currentTime = this->t->getGameTime();
+            float delta = (float)(currentTime - this->_lastUpdate);
+            this->_lastUpdate = currentTime;
+            this->step(delta);
+        }
+
+        // advance by 'delta' seconds, use this instead of 'update' when simulation runs at fixed step
+        void step(float delta)
+        {
+            this->velx += this->accx * delta;
+            this->s->s1.x += this->velx * delta;
+            this->vely += this->accy * delta;
+            this->s->s1.y += this->vely * delta;
+            this->velz += this->accz * delta;
+            this->s->s1.z += this->velz * delta;
+            this->velrot += this->accrot * delta;
+            this->s->s1.rot += this->velrot * delta;
+            this->velsx += this->accsx * delta;
+            this->s->s1.sx += this->velsx * delta;
+            this->velsy += this->accsy * delta;
+            this->s->s1.sy += this->velsy * delta;
+        }
+    };
+
+    // for now speed must be non negative
+    struct animation
+    {
+        sprite* s;
+        time::timer* t;
+        uv* u;
+        float speed;
+        uint frameCount;
+        int currentFrame;
+        uint stopAfter;
+        // this is true if last 'updateAnimation' changed 'currentFrame'
+        bool frameChanged;
+
+        uint _frameChanges;
+        float _elapsedTime;
+        double _lastUpdate;
+        bool _playing;
+
+        // 'stopAfter' stop animation after that many frame changes, 0 = never stop
+        void init(sprite* s, time::timer* t, uv* u, uint frameCount, float secondsPerFrame, uint stopAfter)
+        {
+            this->t = t;
+            this->s = s;
+            this->u = u;
+            this->speed = secondsPerFrame;
+            this->frameCount = frameCount;
+            this->currentFrame = 0;
+            this->stopAfter = stopAfter;
+            this->frameChanged = false;
+            this->_elapsedTime = 0;
+            this->_playing = false;
+            this->_frameChanges = 0;
+            this->_lastUpdate = 0;
+            // update uv to the current frame
+            this->s->s2.uv1 = this->u[this->currentFrame];
+        }
+
+        // make 'updateAnimation' animate frames
+        void play()
+        {
+            if (this->_playing) return;
+
+            this->_playing = true;
+            this->_lastUpdate = this->t->getGameTime();
+            // update uv to the current frame
+            this->s->s2.uv1 = { this->u[this->currentFrame] };
+        }
+
+        // animation will stop and 'updateAnimation' will no longer animate frames
+        void pause()
+        {
+            this->_playing = false;
+        }
+
+        // stop and reset animation so it can be played from the beginning
+        void reset()
+        {
+            this->currentFrame = 0;
+            this->frameChanged = false;
+            this->_elapsedTime = 0;
+            this->_playing = false;
+            this->_frameChanges = 0;
+        }
+
+        // stops playing 'from' starts playing 'to'
+        // if 'from' is not playing ot 'to' is playing then nothing happens
+        void change(animation* dst)
+        {
+            if (!this->_playing || dst->_playing) return;
+
+            this->reset();
+            dst->play();
+        }
+
+        void flipHorizontally()
+        {
+            for (uint i = 0; i < this->frameCount; i++)
+                util::swap(this->u[i].left, this->u[i].right);
+        }
+
+        void flipVertically()
+        {
+            for (uint i = 0; i < this->frameCount; i++)
+                util::swap(this->u[i].top, this->u[i].bottom);
+        }
+
+        // current algorithm 
+        // measure how much time elapsed since last update and add it to total time elapsed
+        // if total time elapsed is greater than speed (thus measured in seconds per frame)
+        // then reduce total time elapsed by speed and change frame
+        void update()
+        {
+            // not playing, early break
+            if (!this->_playing) return;
+
+            double gameTime = this->t->getGameTime();
+            // elpased since last update
+            float elapsed = (float)(gameTime - this->_lastUpdate);
+            // update last update
+            this->_lastUpdate = gameTime;
+            this->step(elapsed);
+        }
+
+        // advance by 'elapsed' seconds, use this instead of 'update' when simulation runs at fixed step
+        void step(float elapsed)
+        {
+            if (!this->_playing) return;
+
+            // set frame changed to false to invalidate previous true
+            this->frameChanged = false;
+            // update elapsed
+            this->_elapsedTime += elapsed;
+
+            // see if enough time elapsed to change frame
+            if (this->_elapsedTime > this->speed)
+            {
+                // subtract the duration of one frame
+                this->_elapsedTime -= this->speed;
+                // update frame index including looping
+                this->currentFrame = (this->currentFrame + 1) % this->frameCount;
+                this->frameChanged = true;
+                this->_frameChanges++;
+
+                // update uv
+                uv* uv = this->u + this->currentFrame;
+                this->s->s2.uv1 = *uv;
+
+                // enough frame changed occured so stop playing
+                if (this->stopAfter != 0 && this->_frameChanges > this->stopAfter)
+                    this->_playing = false;
+            }
+        }
+    };
+
+    // part of the sprite that simulation changes, kept for previous and current step
+    // so rendering can blend between them
+    struct transform2D
+    {
+        float x, y, z;
+        float sx, sy;
+        float rot;
+
+        void get(const sprite* s)
+        {
+            this->x = s->s1.x;
+            this->y = s->s1.y;
+            this->z = s->s1.z;
+            this->sx = s->s1.sx;
+            this->sy = s->s1.sy;
+            this->rot = s->s1.rot;
+        }
+
+        void set(sprite* s) const
+        {
+            s->s1.x = this->x;
+            s->s1.y = this->y;
+            s->s1.z = this->z;
+            s->s1.sx = this->sx;
+            s->s1.sy = this->sy;
+            s->s1.rot = this->rot;
+        }
+
+        // 'alpha' 0 gives 'a', 1 gives 'b'
+        void lerp(const transform2D* a, const transform2D* b, float alpha)
+        {
+            this->x = a->x + (b->x - a->x) * alpha;
+            this->y = a->y + (b->y - a->y) * alpha;
+            this->z = a->z + (b->z - a->z) * alpha;
+            this->sx = a->sx + (b->sx - a->sx) * alpha;
+            this->sy = a->sy + (b->sy - a->sy) * alpha;
+            this->rot = a->rot + (b->rot - a->rot) * alpha;
+        }
+    };
+
+    struct font
+    {
+        texture* tex;
+        uv uv[256];
+    };
+
+    struct text
+    {
+        font* f;
+        sprite* s;
+        uint capacity;
+        const char* str;
+        float horizontalSpace;
+        float verticalSpace;
+
+        void init(font* f, sprite* s, uint capacity, const char* str)
+        {
+#ifdef VI_VALIDATE
+            if (!f || !s || capacity < 1 || !str)
+            {
+                fprintf(stderr, "%s invalid argument\n", __func__);
+                return;
+            }
+
+            if (!f->tex)
+            {
+                fprintf(stderr, "%s font has not texture\n", __func__);
+                return;
+            }
+#endif
+
+            this->f = f;
+            this->s = s;
+            this->capacity = capacity;
+            this->str = str;
+            this->verticalSpace = 0;
+            this->horizontalSpace = 0;
+
+            for (uint i = 0; i < capacity; i++)
+            {
+                vi::util::zero(s + i);
+                s[i].init(f->tex);
+                s[i].s2.col = { 0,0,0,1 };
+            }
+        }
+
+        void update()
+        {
+            float x = s->s1.x;
+            float y = s->s1.y;
+
+            bool zero = false;
+            for (uint i = 0; i < this->capacity; i++)
+            {
+                if (!zero && this->str[i] == 0) zero = true;
+
+                if (zero)
+                {
+                    this->s[i].s1.nodraw = 1;
+                }
+                else if (this->str[i] == '\n')
+                {
+                    x = this->s[0].s1.x;
+                    y += this->s[0].s1.sy + this->verticalSpace;
+                    this->s[i].s1.nodraw = true;
+                    this->s[i].s2.scale = { 0,0 };
+                }
+                else
+                {
+                    this->s[i].s2.uv1 = this->f->uv[str[i] - ' '];
+                    this->s[i].s1.x = x;
+                    this->s[i].s1.y = y;
+                    // set scale and origin equal to the first sprite in the set
+                    this->s[i].s2.scale = this->s[0].s2.scale;
+                    this->s[i].s2.origin = this->s[0].s2.origin;
+                    this->s[i].s1.nodraw = 0;
+
+                    x += this->s[0].s1.sx + this->horizontalSpace;
+                }
+            }
+        }
+    };
+
+    struct vertex
+    {
+        vector3 pos;
+        vector2 uv;
+        /// <summary>
+        /// light information
+        /// </summary>
+        color color;
+    };
+
+    _declspec(align(16))
+        struct line3d
+    {
+        vector3 p1;
+        float pad1;
+
+        vector3 p2;
+        float pad2;
+
+        float pad3[3];
+        uint data;
+
+        color color;
+    };
+
+    struct mesh
+    {
+        vertex* v;
+        /// <summary>
+        /// vertex order for index buffer, this can be null
+        /// if it's null then vertices are rendered in order, topology is always 'triangle list'
+        /// </summary>
+        uint* index;
+        texture* t;
+        ID3D11Buffer* vertexBuffer;
+        ID3D11Buffer* indexBuffer;
+        /// <summary>
+        /// this should be multiple of 3 since topology is triangle list
+        /// </summary>
+        uint vertexCount;
+        uint indexCount;
+
+        vector3 pos;
+        float pad1;
+
+        vector3 rot;
+        float pad2;
+
+        vector3 sca;
+        uint data;
+
+        color color;
+        uint pad3;
+    };
+
+    struct rendererInfo
+    {
+        // in headless mode window is not created, only its width and height are read
+        system::window* wnd;
+        float clearColor[4];
+        // no device, nothing is drawn but every call is counted, for benchmarks and CI
+        bool headless;
+    };
+
+    // what renderer did in one frame, see 'renderer::counters'
+    struct renderCounters
+    {
+        uint drawCalls;
+        // 1 per draw until instancing is used
+        uint instances;
+        uint vertices;
+        uint updateSubresourceCalls;
+        uint mapCalls;
+        unsigned long long bytesUploaded;
+        uint textureBinds;
+        uint shaderSwitches;
+        uint constantBufferBinds;
+        // switches between sprite and mesh pipeline, each rebinds vertex shader and constant buffers
+        uint modeFlips;
+        uint rasterizerChanges;
+        uint blendChanges;
+    };
+
+    const uint RENDER_HISTORY = 128;
+
+    enum class TextureFilter { Point, Linear };
+
+    struct uvSplitInfo
+    {
+        uint pixelTexWidth;
+        uint pixelTexHeight;
+        uint pixelOffsetx;
+        uint pixelOffsety;
+        uint pixelFrameWidth;
+        uint pixelFrameHeight;
+        uint rowLength;
+        uint frameCount;
+    };
+
+    // 'VTEX' in little endian
+    const uint VTEX_MAGIC = 0x58455456;
+    const uint VTEX_VERSION = 1;
+    const uint VTEX_MAX_MIPS = 16;
+
+    // payload format of .vtex file, renderer can upload only RGBA8 at this point
+    // block compressed formats are reserved so old cache files are rejected instead of misread
+    enum class textureFormat : uint { RGBA8 = 0, BC1 = 1, BC3 = 2 };
+
+    // header of decoded texture cache file (.vtex)
+    // it's followed by mip levels, each one starts at 16 byte aligned offset
+    struct vtexHeader
+    {
+        uint magic;
+        uint version;
+        textureFormat format;
+        uint width;
+        uint height;
+        uint mipCount;
+        // these identify the source file the payload was decoded from
+        unsigned long long sourceSize;
+        unsigned long long sourceTime;
+        unsigned long long sourceHash;
+        unsigned long long pathHash;
+        // byte offset from the beginning of the file and byte size of each mip level
+        uint mipOffsets[VTEX_MAX_MIPS];
+        uint mipSizes[VTEX_MAX_MIPS];
+    };
+
+    // Cache of decoded textures.
+    // First load of a file decodes it and writes raw pixels to 'dir'/<hash of path>.vtex
+    // next loads map that file and skip decoding.
+    // Entry is valid if source size and write time match. If only write time changed
+    // then source is hashed and if content is the same, entry is reused.
+    // makes temporary names of cache entries being written unique within the process
+    std::atomic<uint> vtexTempId{ 0 };
+
+    struct textureCache
+    {
+        // directory for .vtex files, must exist
+        char dir[260];
+
+        void init(const char* dir)
+        {
+            util::zero(this);
+            strncpy(this->dir, dir, sizeof(this->dir) - 1);
+        }
+
+        void getCachePath(const char* filename, char* dst, uint maxSize)
+        {
+            unsigned long long h = util::hash64(filename, strlen(filename));
+            snprintf(dst, maxSize, "%s/%016llx.vtex", this->dir, h);
+        }
+
+        static unsigned long long hashFile(const char* filename)
+        {
+            system::mappedFile f;
+            if (!f.open(filename)) return 0;
+            unsigned long long h = util::hash64(f.data, f.size);
+            f.close();
+            return h;
+        }
+
+        // on success 'f' is mapped cache file and 'h' points to its header
+        // pixels of the first mip level are at f->data + h->mipOffsets[0]
+        bool lookup(const char* filename, system::mappedFile* f, vtexHeader** h)
+        {
+            unsigned long long size, time;
+            if (!system::getFileStamp(filename, &size, &time)) return false;
+
+            char path[300];
+            this->getCachePath(filename, path, sizeof(path));
+            if (!f->open(path)) return false;
+
+            vtexHeader* header = (vtexHeader*)f->data;
+            bool valid = f->size >= sizeof(vtexHeader) &&
+                header->magic == VTEX_MAGIC &&
+                header->version == VTEX_VERSION &&
+                header->format == textureFormat::RGBA8 &&
+                header->mipCount > 0 && header->mipCount <= VTEX_MAX_MIPS &&
+                header->pathHash == util::hash64(filename, strlen(filename)) &&
+                header->sourceSize == size &&
+                (size_t)header->mipOffsets[0] + header->mipSizes[0] <= f->size &&
+                header->mipSizes[0] == header->width * header->height * 4;
+
+            if (valid && header->sourceTime != time)
+            {
+                // file was touched, compare content before throwing entry away
+                valid = header->sourceHash == hashFile(filename);
+
+                if (valid)
+                {
+                    // remember new time so next lookup takes the fast path, 'f' keeps the old entry
+                    vtexHeader touched = *header;
+                    touched.sourceTime = time;
+                    this->write(path, &touched, f->data + header->mipOffsets[0]);
+                }
+            }
+
+            if (!valid)
+            {
+                f->close();
+                return false;
+            }
+
+            *h = header;
+            return true;
+        }
+
+        // 'pixels' are RGBA8, returns false if file could not be written
+        bool store(const char* filename, const byte* pixels, uint width, uint height)
+        {
+            vtexHeader header;
+            util::zero(&header);
+
+            if (!system::getFileStamp(filename, &header.sourceSize, &header.sourceTime))
+                return false;
+
+            header.magic = VTEX_MAGIC;
+            header.version = VTEX_VERSION;
+            header.format = textureFormat::RGBA8;
+            header.width = width;
+            header.height = height;
+            header.mipCount = 1;
+            header.sourceHash = hashFile(filename);
+            header.pathHash = util::hash64(filename, strlen(filename));
+            header.mipOffsets[0] = (sizeof(vtexHeader) + 15) & ~15u;
+            header.mipSizes[0] = width * height * 4;
+
+            char path[300];
+            this->getCachePath(filename, path, sizeof(path));
+            return this->write(path, &header, pixels);
+        }
+
+        // entry is written to a temporary file next to it and moved over 'path',
+        // so mapped views of the old entry (other threads, 'lookup' results) are never rewritten
+        bool write(const char* path, const vtexHeader* header, const byte* pixels)
+        {
+            char temp[320];
+#ifdef _WIN32
+            unsigned long pid = GetCurrentProcessId();
+#else
+            unsigned long pid = (unsigned long)getpid();
+#endif
+            snprintf(temp, sizeof(temp), "%s.%lu.%u.tmp", path, pid, vtexTempId.fetch_add(1));
+            FILE* file = fopen(temp, "wb");
+            if (!file) return false;
+
+            byte padding[16] = {};
+            size_t paddingSize = header->mipOffsets[0] - sizeof(vtexHeader);
+            bool ok = fwrite(header, sizeof(vtexHeader), 1, file) == 1 &&
+                fwrite(padding, 1, paddingSize, file) == paddingSize &&
+                fwrite(pixels, header->mipSizes[0], 1, file) == 1;
+
+            ok = fclose(file) == 0 && ok;
+            ok = ok && system::replaceFile(temp, path);
+            if (!ok) remove(temp);
+            return ok;
+        }
+    };
+
+    struct renderer
+    {
+        system::window* window;
+        IDXGISwapChain* swapChain;
+        ID3D11RenderTargetView* backBuffer;
+        ID3D11Device* device;
+        ID3D11DeviceContext* context;
+        ID3D11VertexShader* defaultVS;
+        ID3D11VertexShader* defaultMeshVS;
+        ID3D11VertexShader* currentVS;
+        ID3D11PixelShader* defaultPS;
+        ID3D11DepthStencilView* depthStencilView;
+        ID3D11Texture2D* depthStencilBuffer;
+        ID3D11InputLayout* inputLayout;
+        ID3D11RasterizerState* wireframe;
+        ID3D11RasterizerState* solid;
+        ID3D11SamplerState* point;
+        ID3D11SamplerState* linear;
+        ID3D11Buffer* cbufferVS;
+        ID3D11Buffer* cbufferPS;
+        ID3D11Buffer* cbufferVScamera;
+        ID3D11Buffer* world;
+        ID3D11Buffer* view;
+        ID3D11Buffer* transform;
+        ID3D11Buffer* dynamicVertexBuffer;
+        ID3D11BlendState* blendState;
+        // decoded pixels of the last texture loaded from file, reused so loading doesn't allocate
+        std::vector<byte> pixels;
+        png::decoder pngDecoder;
+        camera camera;
+        camera3D* camera3Dptr;
+        float backBufferColor[4];
+        double frequency;
+        long long startTime;
+        long long prevFrameTime;
+        double gameTime;
+        double frameTime;
+        bool fullscreen;
+        bool headless;
+        /// <summary>
+        /// if you render meshes and sprites then batch them together
+        /// different constant buffers have to be set when mesh or sprite is rendered
+        /// </summary>
+        bool drawingSprites;
+        // counted since last 'endScene'
+        renderCounters counters;
+        // finished frames, 'historyHead' is where the next one goes
+        renderCounters history[RENDER_HISTORY];
+        uint historyHead;
+        uint historyCount;
+
+        void checkhr(HRESULT hr, int line)
+        {
+            if (hr == 0) return;
+            char str[128];
+            FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, 0,
+                hr, MAKELANGID(LANG_NEUTRAL, SUBLANG_NEUTRAL),
+                str, 128, 0);
+            fprintf(stderr, str);
+        }
+
+        // every per frame context call goes through these so it's counted and skipped when headless
+
+        void upload(ID3D11Buffer* buffer, const void* data, uint size)
+        {
+            this->counters.updateSubresourceCalls++;
+            this->counters.bytesUploaded += size;
+            if (!this->headless) this->context->UpdateSubresource(buffer, 0, NULL, data, 0, 0);
+        }
+
+        void bindTexture(texture* t)
+        {
+            this->counters.textureBinds++;
+            if (!this->headless) this->context->PSSetShaderResources(0, 1, &t->shaderResource);
+        }
+
+        void bindVS(ID3D11VertexShader* vs)
+        {
+            this->counters.shaderSwitches++;
+            if (!this->headless) this->context->VSSetShader(vs, 0, 0);
+        }
+
+        void bindConstantBuffer(uint slot, ID3D11Buffer* buffer)
+        {
+            this->counters.constantBufferBinds++;
+            if (!this->headless) this->context->VSSetConstantBuffers(slot, 1, &buffer);
+        }
+
+        void draw(uint vertexCount)
+        {
+            this->counters.drawCalls++;
+            this->counters.instances++;
+            this->counters.vertices += vertexCount;
+            if (!this->headless) this->context->Draw(vertexCount, 0);
+        }
+
+        void drawIndexed(uint indexCount)
+        {
+            this->counters.drawCalls++;
+            this->counters.instances++;
+            this->counters.vertices += indexCount;
+            if (!this->headless) this->context->DrawIndexed(indexCount, 0, 0);
+        }
+
+        void beginSprites()
+        {
+            if (this->drawingSprites) return;
+
+            this->drawingSprites = true;
+            this->counters.modeFlips++;
+            this->bindVS(this->currentVS);
+            this->bindConstantBuffer(0, this->cbufferVS);
+            this->bindConstantBuffer(1, this->cbufferVScamera);
+        }
+
+        void beginMeshes()
+        {
+            if (!this->drawingSprites) return;
+
+            this->drawingSprites = false;
+            this->counters.modeFlips++;
+            this->bindVS(this->defaultMeshVS);
+            this->bindConstantBuffer(0, this->world);
+            this->bindConstantBuffer(1, this->view);
+            this->bindConstantBuffer(2, this->transform);
+        }
+
+        // counters of the frame 'framesAgo' frames before the last finished one, nullptr if not recorded
+        renderCounters* getFrameCounters(uint framesAgo = 0)
+        {
+            if (framesAgo >= this->historyCount) return nullptr;
+
+            uint index = (this->historyHead + RENDER_HISTORY - 1 - framesAgo) % RENDER_HISTORY;
+            return this->history + index;
+        }
+
+        ID3D11SamplerState* createSampler(TextureFilter mode)
+        {
+            ID3D11SamplerState* sampler;
+            D3D11_SAMPLER_DESC sampDesc;
+            ZeroMemory(&sampDesc, sizeof(sampDesc));
+            sampDesc.Filter = mode == TextureFilter::Point ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR; // D3D11_FILTER_ANISOTROPIC
+            sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+            sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+            sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+            sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+            //sampDesc.MaxAnisotropy = D3D11_REQ_MAXANISOTROPY;
+            sampDesc.MinLOD = 0;
+            sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+            this->device->CreateSamplerState(&sampDesc, &sampler);
+            return sampler;
+        }
+
+        ID3D11PixelShader* createPixelShaderFromString(const char* str,
+            const char* entryPoint, const char* target)
+        {
+            ID3D11PixelShader* result;
+            ID3D10Blob* ps;
+            ID3D10Blob* errorMsg;
+            HRESULT hr = D3DCompile(str, strlen(str), 0, 0, 0, entryPoint, target, 0, 0, &ps, &errorMsg);
+            if (errorMsg)
+            {
+                void* ptr = errorMsg->GetBufferPointer();
+                uint sz = errorMsg->GetBufferSize();
+                byte buffer[1000];
+                memset(buffer, 0, 1000);
+                memcpy(buffer, ptr, sz);
+                fprintf(stderr, "%s\n", buffer);
+                return nullptr;
+            }
+            else
+            {
+                this->checkhr(hr, __LINE__);
+            }
+            //D3DCompile
+            hr = this->device->CreatePixelShader(ps->GetBufferPointer(), ps->GetBufferSize(), 0, &result);
+            this->checkhr(hr, __LINE__);
+            ps->Release();
+            return result;
+        }
+
+        ID3D11VertexShader* createVertexShaderFromString(const char* str,
+            const char* entryPoint, const char* target, bool setInputLayout)
+        {
+            ID3D11VertexShader* result = nullptr;
+            ID3D10Blob* vs;
+            ID3D10Blob* errorMsg;
+            HRESULT hr = D3DCompile(str, strlen(str), 0, 0, 0, entryPoint, target, 0, 0, &vs, &errorMsg);
+
+            if (errorMsg)
+            {
+                void* ptr = errorMsg->GetBufferPointer();
+                uint sz = errorMsg->GetBufferSize();
+                byte buffer[1000];
+                memset(buffer, 0, 1000);
+                memcpy(buffer, ptr, sz);
+                fprintf(stderr, "%s\n", buffer);
+                return nullptr;
+            }
+            else
+            {
+                this->checkhr(hr, __LINE__);
+            }
+
+            // have to do this only once
+            if (setInputLayout)
+            {
+                //// VERTEX LAYOUT ////
+            //The vertex Structure
+            //The input-layout description
+                D3D11_INPUT_ELEMENT_DESC layout[] =
+                {
+                    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                    {"TEXCOORD",    0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                    {"LIGHT",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
+                };
+                hr = this->device->CreateInputLayout(layout, 3, vs->GetBufferPointer(),
+                    vs->GetBufferSize(), &this->inputLayout);
+                this->checkhr(hr, __LINE__);
+
+                //Set the Input Layout
+                this->context->IASetInputLayout(this->inputLayout);
+            }
+
+            hr = this->device->CreateVertexShader(vs->GetBufferPointer(), vs->GetBufferSize(), 0, &result);
+            this->checkhr(hr, __LINE__);
+            vs->Release();
+            return result;
+        }
+
+        void init(rendererInfo* info)
+        {
+            HRESULT hr = 0;
+            this->drawingSprites = true;
+            this->window = info->wnd;
+            this->fullscreen = false;
+            this->headless = info->headless;
+            util::zero(&this->counters);
+            this->historyHead = 0;
+            this->historyCount = 0;
+            //assign global variable
+            memcpy(this->backBufferColor, info->clearColor, sizeof(float) * 4);
+
+            // camera
+            this->camera3Dptr = nullptr;
+            this->camera.aspectRatio = this->window->width / (float)this->window->height;
+            this->camera.rotation = 0;
+            this->camera.scale = 1;
+            this->camera.x = 0;
+            this->camera.y = 0;
+
+            if (this->headless)
+            {
+                this->swapChain = nullptr;
+                this->device = nullptr;
+                this->context = nullptr;
+                this->currentVS = nullptr;
+                return;
+            }
+
+            //// *********** PIPELINE SETUP STARTS HERE *********** ////
+            // create a struct to hold information about the swap chain
+            DXGI_SWAP_CHAIN_DESC scd;
+            ZeroMemory(&scd, sizeof(DXGI_SWAP_CHAIN_DESC));
+            scd.BufferCount = 1;                                    // one back buffer
+            scd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;     // use 32-bit color
+            scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;      // how swap chain is to be used
+            scd.OutputWindow = info->wnd->handle;                   // the window to be used
+            scd.SampleDesc.Quality = 0;
+            scd.SampleDesc.Count = 1;                               // no anti aliasing
+            scd.Windowed = TRUE;                                    // windowed/full-screen mode
+            //scd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;   // alternative fullscreen mode
+
+            UINT creationFlags = D3D11_CREATE_DEVICE_SINGLETHREADED;
+
+            ////    DEVICE, DEVICE CONTEXT AND SWAP CHAIN    ////
+            hr = D3D11CreateDeviceAndSwapChain(NULL,
+                D3D_DRIVER_TYPE_HARDWARE, NULL, creationFlags, NULL, NULL,
+                D3D11_SDK_VERSION, &scd, &this->swapChain, &this->device, NULL,
+                &this->context);
+            this->checkhr(hr, __LINE__);
+
+            ////    BACK BUFFER AS RENDER TARGET, DEPTH STENCIL   ////
+            // get the address of the back buffer
+            ID3D11Texture2D* buf;
+            this->swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&buf);
+            // use the back buffer address to create the render target
+            hr = this->device->CreateRenderTargetView(buf, NULL, &this->backBuffer);
+            this->checkhr(hr, __LINE__);
+            buf->Release();
+
+            //Describe our Depth/Stencil Buffer and View
+            D3D11_TEXTURE2D_DESC depthStencilDesc;
+            depthStencilDesc.Width = info->wnd->width;
+            depthStencilDesc.Height = info->wnd->height;
+            depthStencilDesc.MipLevels = 1;
+            depthStencilDesc.ArraySize = 1;
+            depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
+            depthStencilDesc.SampleDesc.Count = 1;
+            depthStencilDesc.SampleDesc.Quality = 0;
+            depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
+            depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+            depthStencilDesc.CPUAccessFlags = 0;
+            depthStencilDesc.MiscFlags = 0;
+
+            hr = this->device->CreateTexture2D(&depthStencilDesc, NULL, &this->depthStencilBuffer);
+            this->checkhr(hr, __LINE__);
+            hr = this->device->CreateDepthStencilView(this->depthStencilBuffer, NULL, &this->depthStencilView);
+            this->checkhr(hr, __LINE__);
+
+            ////   VIEWPORT    ////
+            // Set the viewport
+            D3D11_VIEWPORT viewport;
+            ZeroMemory(&viewport, sizeof(D3D11_VIEWPORT));
+            viewport.TopLeftX = 0;
+            viewport.TopLeftY = 0;
+            viewport.Width = (FLOAT)info->wnd->width;
+            viewport.Height = (FLOAT)info->wnd->height;
+            viewport.MinDepth = 0.0f;
+            viewport.MaxDepth = 1.0f;
+            this->context->RSSetViewports(1, &viewport);
+
+            ////    BLEND STATE  ////
+            D3D11_BLEND_DESC blendDesc;
+            ZeroMemory(&blendDesc, sizeof(blendDesc));
+            D3D11_RENDER_TARGET_BLEND_DESC rtbd;
+            ZeroMemory(&rtbd, sizeof(rtbd));
+            rtbd.BlendEnable = true;
+            rtbd.SrcBlend = D3D11_BLEND_SRC_ALPHA;
+            rtbd.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+            rtbd.BlendOp = D3D11_BLEND_OP_ADD;
+            rtbd.SrcBlendAlpha = D3D11_BLEND_ONE;
+            rtbd.DestBlendAlpha = D3D11_BLEND_ZERO;
+            rtbd.BlendOpAlpha = D3D11_BLEND_OP_ADD;
+            rtbd.RenderTargetWriteMask = D3D10_COLOR_WRITE_ENABLE_ALL;
+            //blendDesc.AlphaToCoverageEnable = false;
+            blendDesc.RenderTarget[0] = rtbd;
+            hr = this->device->CreateBlendState(&blendDesc, &this->blendState);
+
+            ////    VS and PS    ////
+            this->defaultVS = this->createVertexShaderFromString(rc_VertexShader, "main", "vs_5_0", false);
+            this->currentVS = this->defaultVS;
+            this->defaultMeshVS = this->createVertexShaderFromString(rc_VertexShaderMesh, "main", "vs_5_0", true);
+            this->defaultPS = this->createPixelShaderFromString(rc_PixelShader, "main", "ps_5_0");
+
+            D3D11_BUFFER_DESC cbbd;
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(sprite);
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVS);
+
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = psBufferSize;
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferPS);
+            this->context->PSSetConstantBuffers(0, 1, &this->cbufferPS);
+
+            // vertex buffer for camera also UpdateSubresource
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(camera);
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);
+
+            // vs cbuffer for world view proj
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = 64;
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->world);
+
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(camera3D);
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->view);
+
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(float) * 16;
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->transform);
+
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DYNAMIC;
+            cbbd.ByteWidth = sizeof(vertex) * 15000;
+            cbbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            cbbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+            this->device->CreateBuffer(&cbbd, NULL, &this->dynamicVertexBuffer);
+
+            /*ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(camera);
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);
+
+            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
+            cbbd.Usage = D3D11_USAGE_DEFAULT;
+            cbbd.ByteWidth = sizeof(camera);
+            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);*/
+
+            D3D11_RASTERIZER_DESC rd;
+            ZeroMemory(&rd, sizeof(rd));
+            rd.FillMode = D3D11_FILL_WIREFRAME;
+            rd.CullMode = D3D11_CULL_NONE;
+            hr = this->device->CreateRasterizerState(&rd, &this->wireframe);
+            this->checkhr(hr, __LINE__);
+            rd.FillMode = D3D11_FILL_SOLID;
+            rd.CullMode = D3D11_CULL_FRONT;
+            hr = this->device->CreateRasterizerState(&rd, &this->solid);
+            this->checkhr(hr, __LINE__);
+
+            this->context->OMSetRenderTargets(1, &this->backBuffer, this->depthStencilView);
+            this->context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            this->context->RSSetState(this->solid);
+            this->context->PSSetShader(this->defaultPS, 0, 0);
+
+            this->point = this->createSampler(TextureFilter::Point);
+            this->linear = this->createSampler(TextureFilter::Linear);
+            this->context->PSSetSamplers(0, 1, &this->point);
+
+            // default is drawing sprites so set them
+            this->context->VSSetShader(this->defaultVS, 0, 0);
+            this->context->VSSetConstantBuffers(0, 1, &this->cbufferVS);
+            this->context->VSSetConstantBuffers(1, 1, &this->cbufferVScamera);
+
+            //// *********** PIPELINE SETUP ENDS HERE *********** ////
+        }
+
+        void destroy()
+        {
+            if (this->headless) return;
+
+            this->blendState->Release();
+            this->blendState = nullptr;
+            this->dynamicVertexBuffer->Release();
+            this->dynamicVertexBuffer = nullptr;
+            this->world->Release();
+            this->world = nullptr;
+            this->view->Release();
+            this->view = nullptr;
+            this->transform->Release();
+            this->transform = nullptr;
+            this->inputLayout->Release();
+            this->inputLayout = nullptr;
+            this->cbufferVS->Release();
+            this->cbufferVS = nullptr;
+            this->cbufferVScamera->Release();
+            this->cbufferVScamera = nullptr;
+            this->point->Release();
+            this->point = nullptr;
+            this->linear->Release();
+            this->linear = nullptr;
+            this->wireframe->Release();
+            this->wireframe = nullptr;
+            this->solid->Release();
+            this->solid = nullptr;
+            this->cbufferPS->Release();
+            this->cbufferPS = nullptr;
+            this->defaultPS->Release();
+            this->defaultPS = nullptr;
+            this->defaultVS->Release();
+            this->defaultVS = nullptr;
+            this->depthStencilView->Release();
+            this->depthStencilView = nullptr;
+            this->depthStencilBuffer->Release();
+            this->depthStencilBuffer = nullptr;
+            this->backBuffer->Release();
+            this->backBuffer = nullptr;
+            this->swapChain->Release();
+            this->swapChain = nullptr;
+            this->context->Release();
+            this->context = nullptr;
+            this->device->Release();
+            this->device = nullptr;
+        }
+
+        // Create texture where pixels are uncompressed, not encoded, 4 bytes per pixel formatted RGBA, stored lineary.
+        // insert texture to internal storage
+        void createTextureFromBytes(texture* t, byte* data, uint width, uint height)
+        {
+            t->width = width;
+            t->height = height;
+            this->counters.bytesUploaded += (unsigned long long)width * height * 4;
+
+            if (this->headless)
+            {
+                t->shaderResource = nullptr;
+                return;
+            }
+
+            ID3D11Texture2D* tex = nullptr;
+            D3D11_TEXTURE2D_DESC desc;
+            D3D11_SUBRESOURCE_DATA sub;
+
+            sub.pSysMem = (void*)data;
+            sub.SysMemPitch = (UINT)width * 4;
+            sub.SysMemSlicePitch = (UINT)height * (UINT)width * 4;
+
+            desc.Width = (UINT)width;
+            desc.Height = (UINT)height;
+            desc.MipLevels = 1;
+            desc.ArraySize = 1;
+
+            desc.SampleDesc.Count = 1;
+            desc.SampleDesc.Quality = 0;
+            desc.Usage = D3D11_USAGE_DEFAULT;
+            desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+            desc.CPUAccessFlags = 0;
+            desc.MiscFlags = 0;
+
+            HRESULT hr = this->device->CreateTexture2D(&desc, &sub, &tex);
+            this->checkhr(hr, __LINE__);
+
+            D3D11_TEXTURE2D_DESC desc2;
+            tex->GetDesc(&desc2);
+            ID3D11ShaderResourceView* srv = nullptr;
+            hr = this->device->CreateShaderResourceView(tex, 0, &srv);
+            this->checkhr(hr, __LINE__);
+            tex->Release();
+
+            t->shaderResource = srv;
+        }
+
+        // decode image file to 'this->pixels', returns false if it's not an image stb or png decoder supports
+        bool decodeImage(const byte* file, size_t len, int* width, int* height)
+        {
+            uint w, h;
+            byte type;
+
+            if (png::getInfo(file, len, &w, &h, &type))
+            {
+                this->pixels.resize((size_t)w * h * 4);
+
+                if (this->pngDecoder.decode(file, len, this->pixels.data(), this->pixels.size()))
+                {
+                    *width = (int)w;
+                    *height = (int)h;
+                    return true;
+                }
+            }
+
+            int n;
+            const int components = 4; // components means how many elements from 'RGBA'
+            // you want to return, I want 4 (RGBA) even in not all 4 are present
+            byte* data = stbi_load_from_memory(file, (int)len, width, height, &n, components);
+            if (!data) return false;
+
+            this->pixels.assign(data, data + (size_t)*width * *height * 4);
+            stbi_image_free(data);
+            return true;
+        }
+
+        // Create texture from file in memory.
+        // Difference between this and 'createTextureFromFile' is that file is in memory.
+        // It's useful because you can have PNG or other encoded image in memory
+        // and this can create texture from that. Supports lots of formats.
+        void createTextureFromInMemoryFile(texture* t, byte* file, int len)
+        {
+            int x = -1, y = -1;
+            bool decoded = this->decodeImage(file, len, &x, &y);
+
+#ifdef VI_VALIDATE
+            if (!decoded)
+            {
+                fprintf(stderr, "createTexture could not process in memory file\n");
+                exit(1);
+            }
+#endif
+
+            this->createTextureFromBytes(t, this->pixels.data(), x, y);
+        }
+
+        // Create texture from encoded file stored in pack.
+        // Uncompressed entries are decoded straight from the mapped pack.
+        void createTextureFromPack(texture* t, pack::archive* a, const char* name)
+        {
+            byte* file;
+            uint len;
+
+            if (a->view(name, &file, &len))
+            {
+                this->createTextureFromInMemoryFile(t, file, len);
+                return;
+            }
+
+            pack::entry* e = a->find(name);
+
+#ifdef VI_VALIDATE
+            if (!e)
+            {
+                fprintf(stderr, "createTexture could not find %s in pack\n", name);
+                exit(1);
+            }
+#endif
+
+            file = (byte*)malloc(e->originalSize);
+            int x = -1, y = -1;
+            bool decoded = a->extract(e, file) && this->decodeImage(file, e->originalSize, &x, &y);
+            ::free(file);
+
+#ifdef VI_VALIDATE
+            if (!decoded)
+            {
+                fprintf(stderr, "createTexture could not process %s from pack\n", name);
+                exit(1);
+            }
+#endif
+
+            this->createTextureFromBytes(t, this->pixels.data(), x, y);
+        }
+
+        // Create texture from file on disk. Supports lots of formats.
+        void createTextureFromFile(texture* t, const char* filename)
+        {
+            system::mappedFile f;
+            int x = -1, y = -1;
+            bool decoded = f.open(filename) && this->decodeImage(f.data, f.size, &x, &y);
+            f.close();
+
+#ifdef VI_VALIDATE
+            if (!decoded)
+            {
+                fprintf(stderr, "createTexture could not open the file %s\n", filename);
+                exit(1);
+            }
+#endif
+
+            this->createTextureFromBytes(t, this->pixels.data(), x, y);
+        }
+
+        // Same as 'createTextureFromFile' but decoded pixels are taken from 'cache' if possible.
+        // If file is not in the cache, it's decoded and added to the cache.
+        void createTextureFromFileCached(texture* t, const char* filename, textureCache* cache)
+        {
+            system::mappedFile f;
+            vtexHeader* h;
+
+            if (cache->lookup(filename, &f, &h))
+            {
+                // pixels go from the mapped file straight to the device
+                this->createTextureFromBytes(t, f.data + h->mipOffsets[0], h->width, h->height);
+                f.close();
+                return;
+            }
+
+            int x = -1, y = -1;
+            bool decoded = f.open(filename) && this->decodeImage(f.data, f.size, &x, &y);
+            f.close();
+
+#ifdef VI_VALIDATE
+            if (!decoded)
+            {
+                fprintf(stderr, "createTexture could not open the file %s\n", filename);
+                exit(1);
+            }
+#endif
+
+            // texture is left as it was and nothing goes to the cache
+            if (!decoded) return;
+
+            this->createTextureFromBytes(t, this->pixels.data(), x, y);
+            cache->store(filename, this->pixels.data(), x, y);
+        }
+
+        void destroyTexture(texture* t)
+        {
+            if (t->shaderResource) t->shaderResource->Release();
+            t->shaderResource = nullptr;
+        }
+
+        /// <summary>
+        /// this can be used to start a new layer
+        /// </summary>
+        void clearDepth()
+        {
+            if (this->headless) return;
+            this->context->ClearDepthStencilView(this->depthStencilView,
+                D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+        }
+
+        void beginScene()
+        {
+            VI_PROFILE_SCOPE("renderer::beginScene");
+
+            if (!this->headless)
+            {
+                this->context->ClearRenderTargetView(this->backBuffer, this->backBufferColor);
+                this->context->ClearDepthStencilView(this->depthStencilView,
+                    D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+            }
+
+            // update camera only once per frame
+            this->upload(this->cbufferVScamera, &this->camera, sizeof(camera));
+            if (this->camera3Dptr)
+                this->upload(this->view, this->camera3Dptr, sizeof(camera3D));
+        }
+
+        void updateCamera(gl::camera* c)
+        {
+            this->upload(this->cbufferVScamera, c, sizeof(camera));
+        }
+
+        void drawSprite(sprite* s)
+        {
+            if (s->s1.nodraw) return;
+
+            this->beginSprites();
+
+            if (s->s1.t) this->bindTexture(s->s1.t);
+            s->s1.notexture = !s->s1.t;
+            this->upload(this->cbufferVS, s, sizeof(sprite));
+            this->upload(this->cbufferPS, &s->s2.flags, psBufferSize);
+            this->draw(6);
+        }
+
+        /// <summary>
+        /// use 'line' component of 'sprite';
+        /// only static line at this point;
+        /// line cannot be scaled, moved or rotated;
+        /// position of end points still exists in world space so it's affected by camera scale and pos
+        /// REMEMBER TO SET WIREFRAME
+        /// </summary>
+        void drawLine(sprite* s)
+        {
+            this->beginSprites();
+
+            // 4 uints because min size is 16 bytes
+            uint flags[4] = { 2 }; // notexture flag on
+            s->s1.z -= 1.0f;
+            this->upload(this->cbufferVS, s, sizeof(sprite));
+            s->s1.z += 1.0f;
+            this->upload(this->cbufferPS, &flags, sizeof(flags));
+
+            this->draw(3);
+        }
+
+        void drawMesh(mesh* m, float* transform = nullptr)
+        {
+            UINT stride = sizeof(vertex);
+            UINT offset = 0;
+            if (!this->headless) this->context->IASetVertexBuffers(0, 1, &m->vertexBuffer, &stride, &offset);
+
+            this->beginMeshes();
+
+            if (m->t)
+                this->bindTexture(m->t);
+
+            int psdata[] = { !m->t,0,0,0 };
+            this->upload(this->cbufferPS, psdata, sizeof(psdata));
+
+            if (transform)
+            {
+                m->data |= APPLY_TRANSFORM;
+                this->upload(this->transform, transform, sizeof(float) * 16);
+            }
+
+            this->upload(this->world, &m->pos, 64);
+
+            if (m->indexBuffer || (this->headless && m->index))
+            {
+                if (!this->headless) this->context->IASetIndexBuffer(m->indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+                this->drawIndexed(m->indexCount);
+            }
+            else
+            {
+                this->draw(m->vertexCount);
+            }
+        }
+
+        /// <summary>
+        /// updates vertex data every call;
+        /// will use global dynamic vertex buffer;
+        /// won't use mesh's vertex buffer or index buffer;
+        /// slower than constant one;
+        /// no transform applied at the moment so pos xy must be in screen coordinates
+        /// </summary>
+        void drawMeshDynamic(mesh* m, uint vertexCount)
+        {
+            this->counters.mapCalls++;
+            this->counters.bytesUploaded += sizeof(vertex) * vertexCount;
+
+            if (!this->headless)
+            {
+                D3D11_MAPPED_SUBRESOURCE mappedResource;
+                ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
+                //  Disable GPU access to the vertex buffer data.
+                this->context->Map(this->dynamicVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+                //  Update the vertex buffer here.
+                memcpy(mappedResource.pData, m->v, sizeof(vertex) * vertexCount);
+                //  Reenable GPU access to the vertex buffer data.
+                this->context->Unmap(this->dynamicVertexBuffer, 0);
+            }
+
+            this->beginMeshes();
+
+            if (m->t)
+                this->bindTexture(m->t);
+
+            int psdata[] = { !m->t,0,0,0 };
+            this->upload(this->cbufferPS, psdata, sizeof(psdata));
+
+            m->data |= 8;
+            this->upload(this->world, &m->pos, 64);
+
+            UINT stride = sizeof(vertex);
+            UINT offset = 0;
+            if (!this->headless) this->context->IASetVertexBuffers(0, 1, &this->dynamicVertexBuffer, &stride, &offset);
+            this->draw(vertexCount);
+        }
+
+        void drawLine3d(line3d* m)
+        {
+            UINT stride = sizeof(vertex);
+            UINT offset = 0;
+
+            this->beginMeshes();
+
+            m->data = 16;
+            this->upload(this->world, m, 64);
+
+            int psdata[] = { 1,0,0,0 };
+            this->upload(this->cbufferPS, psdata, sizeof(psdata));
+
+            this->draw(3);
+        }
+
+        void endScene()
+        {
+            VI_PROFILE_SCOPE("renderer::endScene");
+            if (!this->headless) this->swapChain->Present(0, 0);
+
+            this->history[this->historyHead] = this->counters;
+            this->historyHead = (this->historyHead + 1) % RENDER_HISTORY;
+            if (this->historyCount < RENDER_HISTORY) this->historyCount++;
+            util::zero(&this->counters);
+        }
+
+        // utility function to calculate uv
+        // offset is where on texture to start
+        // width and height are frame size
+        // row length: in case frames on texture are stacked in multiple rows, how many frames per row are there
+        // frame count is how many uv elements to calculate
+        // uv is the destination, there must be at least as many uv elements avaiable as 'frameCount'
+        void uvSplit(uvSplitInfo* info, uv* uv)
+        {
+            const float width = (float)info->pixelFrameWidth / info->pixelTexWidth;
+            const float height = (float)info->pixelFrameHeight / info->pixelTexHeight;
+            float offsetx = (float)info->pixelOffsetx / info->pixelTexWidth;
+            float x = offsetx;
+            float y = (float)info->pixelOffsety / info->pixelTexHeight;
+
+            for (uint i = 0; i < info->frameCount; i++, uv++)
+            {
+                uv->left = x;
+                uv->top = y;
+                uv->right = x + width;
+                uv->bottom = y + height;
+
+                x += width;
+
+                if (x >= width * info->rowLength + offsetx)
+                {
+                    x = offsetx;
+                    y += height;
+                }
+            }
+        }
+
+        // 'pixelWidth' and 'pixelHeight' are dimensions in pixel
+        void setPixelScale(sprite* s, uint pixelWidth, uint pixelHeight)
+        {
+            s->s1.sx = 2.0f / this->window->width / this->camera.scale * pixelWidth * this->camera.aspectRatio;
+            s->s1.sy = 2.0f / this->window->height / this->camera.scale * pixelHeight;
+        }
+
+        // 'pixelx' and 'pixely' are window coordinates in pixels (0,0) is in upper left corner
+        void setScreenPos(sprite* s, uint pixelx, uint pixely)
+        {
+            s->s1.x = 2.0f / this->window->width * (pixelx - this->window->width / 2.0f) / this->camera.scale * this->camera.aspectRatio;
+            s->s1.y = 2.0f / this->window->height * (pixely - this->window->height / 2.0f) / this->camera.scale;
+        }
+
+        // 'pixelWidth' and 'pixelHeight' are dimensions in pixel, camera independent
+        void setPixelScale2(sprite* s, uint pixelWidth, uint pixelHeight)
+        {
+            s->s1.sx = 2.0f / this->window->width * pixelWidth * this->window->width / (float)this->window->height;
+            s->s1.sy = 2.0f / this->window->height * pixelHeight;
+        }
+
+        // 'pixelx' and 'pixely' are window coordinates in pixels (0,0) is in upper left corner, camera independent
+        void setScreenPos2(sprite* s, uint pixelx, uint pixely)
+        {
+            s->s1.x = 2.0f / this->window->width * (pixelx - this->window->width / 2.0f) * this->window->width / (float)this->window->height;
+            s->s1.y = 2.0f / this->window->height * (pixely - this->window->height / 2.0f);
+        }
+
+        // puts width and height in world coordinates of 1px in f[0] and f[1]
+        void getPixelScale(float* f)
+        {
+            f[0] = 2.0f / this->window->width / this->camera.scale * this->camera.aspectRatio;
+            f[1] = 2.0f / this->window->height / this->camera.scale;
+        }
+
+        // utli function that will calc uv coords if you know pixel coords
+        void setUvFromPixels(sprite* s, float pixelOffsetX, float pixelOffsetY, float pixelWidth,
+            float pixelHeight, float pixelTextureWidth, float pixelTextureHeight)
+        {
+            s->s1.left = pixelOffsetX / pixelTextureWidth;
+            s->s1.top = pixelOffsetY / pixelTextureHeight;
+            s->s1.right = s->s1.left + pixelWidth / pixelTextureWidth;
+            s->s1.bottom = s->s1.top + pixelHeight / pixelTextureHeight;
+        }
+
+        /// <summary>
+        /// index is not required;
+        /// mesh will be drawn as triangle list so index count should be multiple of 3
+        /// </summary>
+        void initMesh(mesh* m, vertex* v, uint vertexCount, uint* index, uint indexCount, texture* t)
+        {
+            util::zero(m);
+            m->index = index;
+            m->indexCount = indexCount;
+            m->vertexCount = vertexCount;
+            m->v = v;
+            m->sca = { 1,1,1 };
+            m->color = { 1,1,1 };
+            m->t = t;
+
+            if (this->headless) return;
+
+            D3D11_BUFFER_DESC vertexBufferDesc = {};
+
+            vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+            vertexBufferDesc.ByteWidth = sizeof(vertex) * m->vertexCount;
+            vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+            D3D11_SUBRESOURCE_DATA vertexBufferData = {};
+            vertexBufferData.pSysMem = m->v;
+
+            HRESULT hr = this->device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, &m->vertexBuffer);
+            checkhr(hr, __LINE__);
+
+            D3D11_BUFFER_DESC indexBufferDesc = {};
+
+            indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+            indexBufferDesc.ByteWidth = sizeof(uint) * m->indexCount;
+            indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+            if (m->index)
+            {
+                D3D11_SUBRESOURCE_DATA iinitData = {};
+                iinitData.pSysMem = m->index;
+
+                hr = this->device->CreateBuffer(&indexBufferDesc, &iinitData, &m->indexBuffer);
+                checkhr(hr, __LINE__);
+            }
+        }
+
+        void setWireframe()
+        {
+            this->counters.rasterizerChanges++;
+            if (!this->headless) this->context->RSSetState(this->wireframe);
+        }
+
+        void setSolid()
+        {
+            this->counters.rasterizerChanges++;
+            if (!this->headless) this->context->RSSetState(this->solid);
+        }
+
+        void destroyMesh(mesh* m)
+        {
+            if (m->indexBuffer)
+            {
+                m->indexBuffer->Release();
+                m->indexBuffer = nullptr;
+            }
+            if (m->vertexBuffer) m->vertexBuffer->Release();
+            m->vertexBuffer = nullptr;
+        }
+
+        void enableBlendState()
+        {
+            float blendFactor[] = { 0, 0, 0, 0 };
+            this->counters.blendChanges++;
+            if (!this->headless) this->context->OMSetBlendState(this->blendState, blendFactor, 0xffffffff);
+        }
+
+        void disableBlendState()
+        {
+            this->counters.blendChanges++;
+            if (!this->headless) this->context->OMSetBlendState(0, 0, 0xffffffff);
+        }
+
+        void setDefaultSpriteVS()
+        {
+            this->currentVS = this->defaultVS;
+            this->bindVS(this->currentVS);
+        }
+
+        void setSpriteVS(ID3D11VertexShader* vs)
+        {
+            this->currentVS = vs;
+            this->bindVS(this->currentVS);
+        }
+
+        // returns nullptr in headless mode, it's fine to pass it to 'setSpriteVS'
+        ID3D11VertexShader* createVertexShader(const char* str)
+        {
+            if (this->headless) return nullptr;
+            return this->createVertexShaderFromString(str, "main", "vs_5_0", false);
+        }
+
+        void destroyVertexShader(ID3D11VertexShader* vs)
+        {
+            if (vs) vs->Release();
+        }
+    };
+
+    enum class textureLoadState : uint { Queued, Decoding, Decoded, Resident, Failed, Cancelled };
+
+    struct textureRequest
+    {
+        texture* t;
+        char filename[260];
+        int priority;
+        uint id;
+        textureLoadState state;
+        // decoded pixels, either from stb or from mapped cache file
+        byte* pixels;
+        system::mappedFile cached;
+        int width;
+        int height;
+    };
+
+    // Decodes texture files on worker threads.
+    // 'load' returns right away and texture shows 'placeholder' until 'update'
+    // uploads decoded pixels. Only 'update' touches the device so it must be called
+    // from the thread that owns the renderer, once per frame.
+    struct textureLoader
+    {
+        renderer* r;
+        texture* placeholder;
+        textureCache* cache;
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable wake;
+        // max heap by priority, FIFO for the same priority
+        std::vector<textureRequest*> pending;
+        // taken by workers, one per file so the same cache entry is never written twice at once
+        std::vector<textureRequest*> decoding;
+        // queued requests held back while their file is being decoded, they hit the cache after it
+        std::vector<textureRequest*> waiting;
+        // decoded by workers, waiting for upload
+        std::vector<textureRequest*> decoded;
+        // every request that has not been uploaded, failed or cancelled yet
+        std::vector<textureRequest*> active;
+        // requests that finished with their final state, see 'pollCompleted'
+        std::vector<std::pair<uint, textureLoadState>> completed;
+        // final state of every finished request at handle - 1
+        std::vector<textureLoadState> finished;
+        uint idNext;
+        bool quit;
+
+        static bool comparePriority(const textureRequest* a, const textureRequest* b)
+        {
+            if (a->priority != b->priority) return a->priority < b->priority;
+            return a->id > b->id;
+        }
+
+        // 'placeholder' must be a created texture, it's shown until the real one is resident
+        // 'cache' is optional, if set workers read and write decoded pixels through it
+        // 'threadCount' 0 means one less than hardware threads
+        void init(renderer* r, texture* placeholder, textureCache* cache, uint threadCount)
+        {
+            this->r = r;
+            this->placeholder = placeholder;
+            this->cache = cache;
+            this->idNext = 1;
+            this->quit = false;
+
+            if (threadCount == 0)
+            {
+                uint hw = std::thread::hardware_concurrency();
+                threadCount = hw > 1 ? hw - 1 : 1;
+            }
+
+            for (uint i = 0; i < threadCount; i++)
+                this->workers.push_back(std::thread(&textureLoader::work, this));
+        }
+
+        void destroy()
+        {
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->quit = true;
+            }
+
+            this->wake.notify_all();
+            for (uint i = 0; i < this->workers.size(); i++) this->workers[i].join();
+            this->workers.clear();
+
+            for (uint i = 0; i < this->active.size(); i++) this->release(this->active[i]);
+            this->active.clear();
+            this->pending.clear();
+            this->decoding.clear();
+            this->waiting.clear();
+            this->decoded.clear();
+        }
+
+        // queue 'filename' to be decoded into 't', higher 'priority' is decoded first
+        // returns handle for 'cancel', 'getState' and 'pollCompleted'
+        uint load(texture* t, const char* filename, int priority)
+        {
+            textureRequest* req = new textureRequest();
+            req->t = t;
+            strncpy(req->filename, filename, sizeof(req->filename) - 1);
+            req->priority = priority;
+            req->state = textureLoadState::Queued;
+
+            // texture owns a reference so 'destroyTexture' works in any state
+            t->width = this->placeholder->width;
+            t->height = this->placeholder->height;
+            t->shaderResource = this->placeholder->shaderResource;
+            if (t->shaderResource) t->shaderResource->AddRef();
+
+            // worker may finish and free 'req' as soon as lock is released
+            uint id;
+            {
+                std::lock_guard<std::mutex> guard(this->lock);
+                id = req->id = this->idNext++;
+                this->active.push_back(req);
+                this->pending.push_back(req);
+                std::push_heap(this->pending.begin(), this->pending.end(), comparePriority);
+            }
+
+            this->wake.notify_one();
+            return id;
+        }
+
+        // texture keeps the placeholder, does nothing if request already finished
+        void cancel(uint handle)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            textureRequest* req = this->find(handle);
+            if (!req) return;
+
+            if (req->state == textureLoadState::Queued)
+            {
+                auto w = std::find(this->waiting.begin(), this->waiting.end(), req);
+
+                if (w != this->waiting.end())
+                {
+                    this->waiting.erase(w);
+                }
+                else
+                {
+                    this->pending.erase(std::find(this->pending.begin(), this->pending.end(), req));
+                    std::make_heap(this->pending.begin(), this->pending.end(), comparePriority);
+                }
+
+                this->finish(req, textureLoadState::Cancelled);
+            }
+            else if (req->state == textureLoadState::Decoded)
+            {
+                this->decoded.erase(std::find(this->decoded.begin(), this->decoded.end(), req));
+                this->finish(req, textureLoadState::Cancelled);
+            }
+            else if (req->state == textureLoadState::Decoding)
+            {
+                // worker owns it now, it checks the state when it's done
+                req->state = textureLoadState::Cancelled;
+            }
+        }
+
+        // finished requests report how they ended, Resident, Failed or Cancelled,
+        // handles that were never issued report Failed
+        textureLoadState getState(uint handle)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            textureRequest* req = this->find(handle);
+            if (req) return req->state;
+            return handle > 0 && handle <= this->finished.size() ? this->finished[handle - 1] : textureLoadState::Failed;
+        }
+
+        // returns true and sets 'handle' and 'state' if some request finished since last call,
+        // 'state' is Resident or Failed, cancelled requests are not reported
+        bool pollCompleted(uint* handle, textureLoadState* state)
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            if (this->completed.empty()) return false;
+            *handle = this->completed.front().first;
+            *state = this->completed.front().second;
+            this->completed.erase(this->completed.begin());
+            return true;
+        }
+
+        // upload decoded textures until 'budgetSec' is used up
+        // at least one texture is uploaded per call so loading always makes progress
+        void update(float budgetSec)
+        {
+            time::timer tm;
+            tm.init();
+
+            while (true)
+            {
+                textureRequest* req = nullptr;
+                {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    if (this->decoded.empty()) return;
+                    req = this->decoded.front();
+                    this->decoded.erase(this->decoded.begin());
+                    // past this point 'cancel' has no effect
+                    req->state = textureLoadState::Resident;
+                }
+
+                texture uploaded = *req->t;
+                this->r->createTextureFromBytes(&uploaded, req->pixels, req->width, req->height);
+                if (req->t->shaderResource) req->t->shaderResource->Release();
+                req->t->shaderResource = uploaded.shaderResource;
+                req->t->width = uploaded.width;
+                req->t->height = uploaded.height;
+
+                {
+                    std::lock_guard<std::mutex> guard(this->lock);
+                    this->finish(req, textureLoadState::Resident);
+                }
+
+                tm.update();
+                if (tm.getGameTime() > budgetSec) return;
+            }
+        }
+
+        // lock must be held
+        textureRequest* find(uint handle)
+        {
+            for (uint i = 0; i < this->active.size(); i++)
+            {
+                if (this->active[i]->id == handle) return this->active[i];
+            }
+
+            return nullptr;
+        }
+
+        // lock must be held
+        bool isDecoding(const char* filename)
+        {
+            for (uint i = 0; i < this->decoding.size(); i++)
+            {
+                if (strcmp(this->decoding[i]->filename, filename) == 0) return true;
+            }
+
+            return false;
+        }
+
+        void release(textureRequest* req)
+        {
+            if (req->cached.data) req->cached.close();
+            else if (req->pixels) stbi_image_free(req->pixels);
+            delete req;
+        }
+
+        // lock must be held
+        void finish(textureRequest* req, textureLoadState state)
+        {
+            this->active.erase(std::find(this->active.begin(), this->active.end(), req));
+            if (state != textureLoadState::Cancelled) this->completed.push_back({ req->id, state });
+            if (this->finished.size() < req->id) this->finished.resize(req->id, textureLoadState::Failed);
+            this->finished[req->id - 1] = state;
+            this->release(req);
+        }
+
+        void decode(textureRequest* req, png::decoder* d)
+        {
+            VI_PROFILE_SCOPE("textureLoader::decode");
+            vtexHeader* h;
+
+            if (this->cache && this->cache->lookup(req->filename, &req->cached, &h))
+            {
+                req->pixels = req->cached.data + h->mipOffsets[0];
+                req->width = h->width;
+                req->height = h->height;
+                return;
+            }
+
+            system::mappedFile f;
+            if (!f.open(req->filename)) return;
+            req->pixels = png::load(d, f.data, f.size, &req->width, &req->height);
+            f.close();
+
+            if (req->pixels && this->cache)
+                this->cache->store(req->filename, req->pixels, req->width, req->height);
+        }
+
+        void work()
+        {
+            png::decoder d;
+
+            while (true)
+            {
+                textureRequest* req = nullptr;
+                {
+                    std::unique_lock<std::mutex> guard(this->lock);
+                    this->wake.wait(guard, [this]() { return this->quit || !this->pending.empty(); });
+                    if (this->quit) return;
+                    std::pop_heap(this->pending.begin(), this->pending.end(), comparePriority);
+                    req = this->pending.back();
+                    this->pending.pop_back();
+
+                    if (this->isDecoding(req->filename))
+                    {
+                        this->waiting.push_back(req);
+                        continue;
+                    }
+
+                    req->state = textureLoadState::Decoding;
+                    this->decoding.push_back(req);
+                }
+
+                this->decode(req, &d);
+
+                std::lock_guard<std::mutex> guard(this->lock);
+                this->decoding.erase(std::find(this->decoding.begin(), this->decoding.end(), req));
+
+                // requests for the same file go back to the queue, cache has the entry now
+                for (uint i = 0; i < this->waiting.size();)
+                {
+                    if (strcmp(this->waiting[i]->filename, req->filename) == 0)
+                    {
+                        this->pending.push_back(this->waiting[i]);
+                        std::push_heap(this->pending.begin(), this->pending.end(), comparePriority);
+                        this->waiting.erase(this->waiting.begin() + i);
+                        this->wake.notify_one();
+                        continue;
+                    }
+
+                    i++;
+                }
+
+                if (req->state == textureLoadState::Cancelled)
+                {
+                    this->finish(req, textureLoadState::Cancelled);
+                }
+                else if (!req->pixels)
+                {
+#ifdef VI_VALIDATE
+                    fprintf(stderr, "textureLoader could not open the file %s\n", req->filename);
+#endif
+                    this->finish(req, textureLoadState::Failed);
+                }
+                else
+                {
+                    req->state = textureLoadState::Decoded;
+                    this->decoded.push_back(req);
+                }
+            }
+        }
+    };
+}
+#endif
+
+namespace vi::input
+{
+#ifdef _WIN32
+    // for letters and numbers use 'A' - 'Z', '0' - '9' etc
+    // on other platforms there is no enum, replayed logs use the same virtual key numbers
+    //// this doesnt have to be enum class because numbers are allowed from outside of this set
+    enum key : int
+    {
+        LMOUSE = VK_LBUTTON,
+        RMOUSE = VK_RBUTTON,
+        MMOUSE = VK_MBUTTON,
+
+        LEFT = VK_LEFT,
+        RIGHT = VK_RIGHT,
+        UP = VK_UP,
+        DOWN = VK_DOWN,
+
+        INSERT = VK_INSERT,
+        DEL = VK_DELETE,
+        HOME = VK_HOME,
+        END = VK_END,
+        PAGEUP = VK_PRIOR,
+        PAGEDOWN = VK_NEXT,
+        SCROLLLOCK = VK_SCROLL,
+        PRNT_SCRN = VK_SNAPSHOT,
+
+        TAB = VK_TAB,
+        CAPSLOCK = VK_CAPITAL,
+        LSHIFT = VK_LSHIFT,
+        LALT = VK_LMENU,
+        LCONTROL = VK_LCONTROL,
+        LWIN = VK_LWIN,
+
+        SPACE = VK_SPACE,
+
+        BACKSPACE = VK_BACK,
+        ENTER = VK_RETURN,
+        RSHIFT = VK_RSHIFT,
+        RCONTROL = VK_RCONTROL,
+        RALT = VK_RMENU,
+        RWIN = VK_RWIN,
+        MENU = VK_APPS,
+
+        ESCAPE = VK_ESCAPE,
+        F1 = VK_F1,
+        F2 = VK_F2,
+        F3 = VK_F3,
+        F4 = VK_F4,
+        F5 = VK_F5,
+        F6 = VK_F6,
+        F7 = VK_F7,
+        F8 = VK_F8,
+        F9 = VK_F9,
+        F10 = VK_F10,
+        F11 = VK_F11,
+        F12 = VK_F12,
+
+        NUMLOCK = VK_NUMLOCK,
+        NUM0 = VK_NUMPAD0,
+        NUM1 = VK_NUMPAD1,
+        NUM2 = VK_NUMPAD2,
+        NUM3 = VK_NUMPAD3,
+        NUM4 = VK_NUMPAD4,
+        NUM5 = VK_NUMPAD5,
+        NUM6 = VK_NUMPAD6,
+        NUM7 = VK_NUMPAD7,
+        NUM8 = VK_NUMPAD8,
+        NUM9 = VK_NUMPAD9,
+        NUMDIV = VK_DIVIDE,
+        NUMMUL = VK_MULTIPLY,
+        NUMMINUS = VK_SUBTRACT,
+        MULPLUS = VK_ADD,
+        NUMDEL = VK_DECIMAL,
+
+        MINUS = VK_OEM_MINUS,
+        EQUALS = VK_OEM_PLUS,
+        BRACKETOPEN = VK_OEM_4,
+        BRACKETCLOSE = VK_OEM_6,
+        PIPE = VK_OEM_5,
+        SEMICOLON = VK_OEM_1,
+        QUOTE = VK_OEM_7,
+        COMMA = VK_OEM_COMMA,
+        PERIOD = VK_OEM_PERIOD,
+        SLASH = VK_OEM_2,
+        TILD = VK_OEM_3
+    };
+#endif
+
+    const uint INPUT_LOG_MAGIC = 0x504e4956; // "VINP"
+    const uint INPUT_LOG_VERSION = 2;
+
+    // everything keyboard, mouse and timer produced in one frame
+    struct frameInput
+    {
+        byte keys[KEYBOARD_KEY_COUNT / 8];
+        byte pressed[KEYBOARD_KEY_COUNT / 8];
+        byte released[KEYBOARD_KEY_COUNT / 8];
+        char typed[KEYBOARD_TYPED_CAPACITY];
+        uint typedCount;
+        int cursorScreenx;
+        int cursorScreeny;
+        int cursorClientx;
+        int cursorClienty;
+        short wheel;
+        int rawDeltax;
+        int rawDeltay;
+        long long tickNs;
+
+        bool isKeyDown(int key)
+        {
+            return (this->keys[key >> 3] >> (key & 7)) & 1;
+        }
+    };
+
+    enum inputLogFlags : byte
+    {
+        INPUT_KEYS = 1,
+        INPUT_TYPED = 2,
+        INPUT_SCREEN = 4,
+        INPUT_CLIENT = 8,
+        INPUT_WHEEL = 16,
+        INPUT_RAW = 32,
+        INPUT_TICK = 64,
+        // pressed and released don't follow from key state, a key was tapped within the frame
+        INPUT_EDGES = 128
+    };
+
+    // binary log of frameInput, one flags byte per frame followed only by what changed
+    // positions and tick are stored as zigzag varint deltas to previous frame
+    // so an idle frame with steady frame time is a single byte
+    // record into memory with 'record', 'save' at the end; 'load' then 'replay' until it returns false
+    struct inputLog
+    {
+        // pressed and released as they follow from key state of two frames
+        static void getEdges(const byte* keys, const byte* prevKeys, byte* pressed, byte* released)
+        {
+            for (int i = 0; i < KEYBOARD_KEY_COUNT / 8; i++)
+            {
+                pressed[i] = keys[i] & ~prevKeys[i];
+                released[i] = prevKeys[i] & ~keys[i];
+            }
+        }
+
+        std::vector<byte> data;
+        size_t position;
+        uint frameCount;
+        frameInput previous;
+
+        void init()
+        {
+            this->data.clear();
+            this->position = 0;
+            this->frameCount = 0;
+            memset(&this->previous, 0, sizeof(frameInput));
+        }
+
+        void destroy()
+        {
+            std::vector<byte>().swap(this->data);
+        }
+
+        void putVarint(long long value)
+        {
+            unsigned long long v = ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+
+            while (v >= 0x80)
+            {
+                this->data.push_back((byte)(v | 0x80));
+                v >>= 7;
+            }
+
+            this->data.push_back((byte)v);
+        }
+
+        long long getVarint()
+        {
+            unsigned long long v = 0;
+            int shift = 0;
+
+            while (this->position < this->data.size() && shift < 64)
+            {
+                byte b = this->data[this->position++];
+                v |= (unsigned long long)(b & 0x7f) << shift;
+                shift += 7;
+
+                if (!(b & 0x80))
+                    break;
+            }
+
+            return (long long)(v >> 1) ^ -(long long)(v & 1);
+        }
+
+        bool getBytes(void* out, size_t size)
+        {
+            if (this->position + size > this->data.size())
+                return false;
+
+            memcpy(out, this->data.data() + this->position, size);
+            this->position += size;
+            return true;
+        }
+
+        void record(const frameInput* in)
+        {
+            frameInput* p = &this->previous;
+            byte flags = 0;
+            byte pressed[KEYBOARD_KEY_COUNT / 8];
+            byte released[KEYBOARD_KEY_COUNT / 8];
+            getEdges(in->keys, p->keys, pressed, released);
+
+            if (memcmp(in->keys, p->keys, sizeof(in->keys)) != 0) flags |= INPUT_KEYS;
+            if (in->typedCount) flags |= INPUT_TYPED;
+            if (in->cursorScreenx != p->cursorScreenx || in->cursorScreeny != p->cursorScreeny) flags |= INPUT_SCREEN;
+            if (in->cursorClientx != p->cursorClientx || in->cursorClienty != p->cursorClienty) flags |= INPUT_CLIENT;
+            if (in->wheel) flags |= INPUT_WHEEL;
+            if (in->rawDeltax || in->rawDeltay) flags |= INPUT_RAW;
+            if (in->tickNs != p->tickNs) flags |= INPUT_TICK;
+            if (memcmp(in->pressed, pressed, sizeof(pressed)) != 0 || memcmp(in->released, released, sizeof(released)) != 0)
+                flags |= INPUT_EDGES;
+
+            this->data.push_back(flags);
+
+            if (flags & INPUT_KEYS)
+                this->data.insert(this->data.end(), in->keys, in->keys + sizeof(in->keys));
+
+            if (flags & INPUT_EDGES)
+            {
+                this->data.insert(this->data.end(), in->pressed, in->pressed + sizeof(in->pressed));
+                this->data.insert(this->data.end(), in->released, in->released + sizeof(in->released));
+            }
+
+            if (flags & INPUT_TYPED)
+            {
+                uint count = in->typedCount < KEYBOARD_TYPED_CAPACITY ? in->typedCount : KEYBOARD_TYPED_CAPACITY;
+                this->data.push_back((byte)count);
+                this->data.insert(this->data.end(), in->typed, in->typed + count);
+            }
+
+            if (flags & INPUT_SCREEN)
+            {
+                this->putVarint((long long)in->cursorScreenx - p->cursorScreenx);
+                this->putVarint((long long)in->cursorScreeny - p->cursorScreeny);
+            }
+
+            if (flags & INPUT_CLIENT)
+            {
+                this->putVarint((long long)in->cursorClientx - p->cursorClientx);
+                this->putVarint((long long)in->cursorClienty - p->cursorClienty);
+            }
+
+            if (flags & INPUT_WHEEL)
+                this->putVarint(in->wheel);
+
+            if (flags & INPUT_RAW)
+            {
+                this->putVarint(in->rawDeltax);
+                this->putVarint(in->rawDeltay);
+            }
+
+            if (flags & INPUT_TICK)
+                this->putVarint(in->tickNs - p->tickNs);
+
+            this->previous = *in;
+            this->frameCount++;
+        }
+
+        // fills 'out' with next frame, false when the log is exhausted
+        bool replay(frameInput* out)
+        {
+            if (this->position >= this->data.size())
+                return false;
+
+            frameInput* p = &this->previous;
+            byte flags = this->data[this->position++];
+            byte prevKeys[KEYBOARD_KEY_COUNT / 8];
+            memcpy(prevKeys, p->keys, sizeof(prevKeys));
+
+            if ((flags & INPUT_KEYS) && !this->getBytes(p->keys, sizeof(p->keys)))
+                return false;
+
+            if (flags & INPUT_EDGES)
+            {
+                if (!this->getBytes(p->pressed, sizeof(p->pressed)) || !this->getBytes(p->released, sizeof(p->released)))
+                    return false;
+            }
+            else
+            {
+                getEdges(p->keys, prevKeys, p->pressed, p->released);
+            }
+
+            p->typedCount = 0;
+            p->wheel = 0;
+            p->rawDeltax = 0;
+            p->rawDeltay = 0;
+
+            if (flags & INPUT_TYPED)
+            {
+                byte count = 0;
+                if (!this->getBytes(&count, 1) || count > KEYBOARD_TYPED_CAPACITY || !this->getBytes(p->typed, count))
+                    return false;
+
+                p->typedCount = count;
+            }
+
+            if (flags & INPUT_SCREEN)
+            {
+                p->cursorScreenx += (int)this->getVarint();
+                p->cursorScreeny += (int)this->getVarint();
+            }
+
+            if (flags & INPUT_CLIENT)
+            {
+                p->cursorClientx += (int)this->getVarint();
+                p->cursorClienty += (int)this->getVarint();
+            }
+
+            if (flags & INPUT_WHEEL)
+                p->wheel = (short)this->getVarint();
+
+            if (flags & INPUT_RAW)
+            {
+                p->rawDeltax = (int)this->getVarint();
+                p->rawDeltay = (int)this->getVarint();
+            }
+
+            if (flags & INPUT_TICK)
+                p->tickNs += this->getVarint();
+
+            *out = *p;
+            return true;
+        }
+
+        // header is magic, version and frame count, frames follow
+        bool save(const char* filename)
+        {
+            FILE* f = fopen(filename, "wb");
+
+            if (!f)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "inputLog could not write %s\n", filename);
+#endif
+                return false;
+            }
+
+            uint header[3] = { INPUT_LOG_MAGIC, INPUT_LOG_VERSION, this->frameCount };
+            bool ok = fwrite(header, sizeof(header), 1, f) == 1;
+            ok = ok && fwrite(this->data.data(), 1, this->data.size(), f) == this->data.size();
+            fclose(f);
+
+            return ok;
+        }
+
+        // loads a saved log and rewinds it for replay
+        bool load(const char* filename)
+        {
+            this->init();
+            FILE* f = fopen(filename, "rb");
+
+            if (!f)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "inputLog could not open %s\n", filename);
+#endif
+                return false;
+            }
+
+            size_t size = system::getFileSize(f);
+            uint header[3] = {};
+            bool ok = size >= sizeof(header) && fread(header, sizeof(header), 1, f) == 1
+                && header[0] == INPUT_LOG_MAGIC && header[1] == INPUT_LOG_VERSION;
+
+            if (ok)
+            {
+                this->data.resize(size - sizeof(header));
+                ok = fread(this->data.data(), 1, this->data.size(), f) == this->data.size();
+                this->frameCount = header[2];
+            }
+
+            fclose(f);
+
+#ifdef VI_VALIDATE
+            if (!ok)
+                fprintf(stderr, "inputLog %s is not a valid input log\n", filename);
+#endif
+            if (!ok)
+                this->init();
+
+            return ok;
+        }
+    };
+
+    // key state is a bitset with bit per virtual key code, fed by window message events
+    // pressed and released for all keys are two SSE operations on 256 bits
+    struct keyboard
+    {
+        alignas(16) byte down[KEYBOARD_KEY_COUNT / 8];
+        alignas(16) byte wasDown[KEYBOARD_KEY_COUNT / 8];
+        // keys that got down or up event this frame, catches taps shorter than a frame
+        alignas(16) byte hits[KEYBOARD_KEY_COUNT / 8];
+        alignas(16) byte lifts[KEYBOARD_KEY_COUNT / 8];
+        alignas(16) byte pressed[KEYBOARD_KEY_COUNT / 8];
+        alignas(16) byte released[KEYBOARD_KEY_COUNT / 8];
+        // every character typed this frame in order
+        char typed[KEYBOARD_TYPED_CAPACITY];
+        uint typedCount;
+        // last of 'typed' or 0
+        char typedKey;
+        // for fixed steps that don't run every frame, hits, lifts and typed characters pile up
+        // over frames until consumeEdges instead of being cleared when the next frame begins
+        bool latchEdges;
+
+        void init()
+        {
+            util::zero(this);
+        }
+
+        static bool getBit(const byte* bits, int key)
+        {
+            return (bits[key >> 3] >> (key & 7)) & 1;
+        }
+
+        void beginFrame()
+        {
+            memcpy(this->wasDown, this->down, sizeof(this->down));
+            if (this->latchEdges) return;
+
+            memset(this->hits, 0, sizeof(this->hits));
+            memset(this->lifts, 0, sizeof(this->lifts));
+            this->typedCount = 0;
+        }
+
+        void endFrame()
+        {
+            // messages only have sided shift, control and alt, queries for either side are kept working
+            const int generic[3][3] = { { 16, 160, 161 }, { 17, 162, 163 }, { 18, 164, 165 } };
+
+            for (int i = 0; i < 3; i++)
+            {
+                bool isDown = getBit(this->down, generic[i][1]) || getBit(this->down, generic[i][2]);
+                this->setBit(this->down, generic[i][0], isDown);
+
+                // a side tapped within the frame is a tap of the generic key too,
+                // unless the other side kept it down
+                bool hit = getBit(this->hits, generic[i][1]) || getBit(this->hits, generic[i][2]);
+                bool lift = getBit(this->lifts, generic[i][1]) || getBit(this->lifts, generic[i][2]);
+                if (hit && !getBit(this->wasDown, generic[i][0])) this->setBit(this->hits, generic[i][0], true);
+                if (lift && !isDown) this->setBit(this->lifts, generic[i][0], true);
+            }
+
+            for (int i = 0; i < KEYBOARD_KEY_COUNT / 8; i += 16)
+            {
+                __m128i d = _mm_load_si128((const __m128i*)(this->down + i));
+                __m128i w = _mm_load_si128((const __m128i*)(this->wasDown + i));
+                __m128i h = _mm_load_si128((const __m128i*)(this->hits + i));
+                __m128i l = _mm_load_si128((const __m128i*)(this->lifts + i));
+                _mm_store_si128((__m128i*)(this->pressed + i), _mm_or_si128(_mm_andnot_si128(w, d), h));
+                _mm_store_si128((__m128i*)(this->released + i), _mm_or_si128(_mm_andnot_si128(d, w), l));
+            }
+
+            this->typedKey = this->typedCount ? this->typed[this->typedCount - 1] : 0;
+        }
+
+        // with latchEdges, call after the step that handled pressed, released and typed keys
+        void consumeEdges()
+        {
+            memset(this->hits, 0, sizeof(this->hits));
+            memset(this->lifts, 0, sizeof(this->lifts));
+            memset(this->pressed, 0, sizeof(this->pressed));
+            memset(this->released, 0, sizeof(this->released));
+            this->typedCount = 0;
+            this->typedKey = 0;
+        }
+
+        static void setBit(byte* bits, int key, bool value)
+        {
+            if (value) bits[key >> 3] |= (byte)(1 << (key & 7));
+            else bits[key >> 3] &= (byte)~(1 << (key & 7));
+        }
+
+        // applies input events of this frame, see system::inputEvents
+        void update()
+        {
+            VI_PROFILE_SCOPE("keyboard::update");
+            this->beginFrame();
+
+            for (uint i = 0; i < system::inputEventCount; i++)
+            {
+                system::inputEvent* e = system::inputEvents + i;
+
+                switch (e->type)
+                {
+                case system::inputEventType::KeyDown:
+                case system::inputEventType::KeyUp:
+                {
+                    if (e->x <= 0 || e->x >= KEYBOARD_KEY_COUNT) break;
+                    bool isDown = e->type == system::inputEventType::KeyDown;
+                    this->setBit(this->down, e->x, isDown);
+                    this->setBit(isDown ? this->hits : this->lifts, e->x, true);
+                    break;
+                }
+                case system::inputEventType::Char:
+                {
+                    // same set as before, printable ascii and tab, control characters come as keys
+                    bool printable = e->x == '\t' || (e->x >= 32 && e->x < 127);
+                    if (printable && this->typedCount < KEYBOARD_TYPED_CAPACITY)
+                        this->typed[this->typedCount++] = (char)e->x;
+                    break;
+                }
+                case system::inputEventType::ReleaseAll:
+                {
+                    for (int k = 0; k < KEYBOARD_KEY_COUNT / 8; k++)
+                        this->lifts[k] |= this->down[k];
+
+                    memset(this->down, 0, sizeof(this->down));
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            this->endFrame();
+        }
+
+        // store current state to a frame for inputLog
+        void capture(frameInput* in)
+        {
+            memcpy(in->keys, this->down, sizeof(in->keys));
+            memcpy(in->pressed, this->pressed, sizeof(in->pressed));
+            memcpy(in->released, this->released, sizeof(in->released));
+            memcpy(in->typed, this->typed, this->typedCount);
+            in->typedCount = this->typedCount;
+        }
+
+        // replacement for update that takes the state from a recorded frame
+        void apply(const frameInput* in)
+        {
+            this->beginFrame();
+            memcpy(this->down, in->keys, sizeof(this->down));
+            memcpy(this->hits, in->pressed, sizeof(this->hits));
+            memcpy(this->lifts, in->released, sizeof(this->lifts));
+            this->typedCount = in->typedCount < KEYBOARD_TYPED_CAPACITY ? in->typedCount : KEYBOARD_TYPED_CAPACITY;
+            memcpy(this->typed, in->typed, this->typedCount);
+            this->endFrame();
+        }
+
+        bool isKeyDown(int _key)
+        {
+            return getBit(this->down, _key);
+        }
+
+        bool isKeyPressed(int _key)
+        {
+            // TODO, return false if this is the first frame
+            return getBit(this->pressed, _key);
+        }
+
+        bool isKeyReleased(int _key)
+        {
+            return getBit(this->released, _key);
+        }
+
+        // last character typed this frame, use getKeysTyped to get all of them
+        char getKeyTyped()
+        {
+            return this->typedKey;
+        }
+
+        // characters typed this frame in order, count is returned
+        uint getKeysTyped(const char** chars)
+        {
+            *chars = this->typed;
+            return this->typedCount;
+        }
+    };
+
+    struct mouse
+    {
+        int _cursorScreenx;
+        int _cursorScreeny;
+        int _cursorClientx;
+        int _cursorClienty;
+        float _cursorWorldx;
+        float _cursorWorldy;
+        int _cursorDeltax;
+        int _cursorDeltay;
+        short _wheel;
+        int _rawMouseDeltax;
+        int _rawMouseDeltay;
+
+        void init()
+        {
+            util::zero(this);
+        }
+
+#ifdef _WIN32
+        /// <summary>
+        /// can pass null for camera but you wont get 2D world x and y
+        /// </summary>
+        void update(system::window* w, gl::camera* c)
+        {
+            POINT p;
+            GetCursorPos(&p);
+            this->_cursorDeltax = p.x - this->_cursorScreenx;
+            this->_cursorDeltay = p.y - this->_cursorScreeny;
+            this->_cursorScreenx = p.x;
+            this->_cursorScreeny = p.y;
+            this->_wheel = system::wheelDelta;
+            this->_rawMouseDeltax = system::rawMouseDeltax;
+            this->_rawMouseDeltay = system::rawMouseDeltay;
+
+            p = { this->_cursorScreenx, this->_cursorScreeny };
+            ScreenToClient(w->handle, &p);
+            this->_cursorClientx = p.x;
+            this->_cursorClienty = p.y;
+            this->updateWorld(w, c);
+        }
+
+        void updateWorld(system::window* w, gl::camera* c)
+        {
+            if (c)
+            {
+                this->_cursorWorldx = ((float)this->_cursorClientx - w->width / 2) / w->width / c->scale * c->aspectRatio * 2 + c->x;
+                this->_cursorWorldy = ((float)this->_cursorClienty - w->height / 2) / w->height / c->scale * 2 + c->y;
+            }
+        }
+#endif
+
+        // store current state to a frame for inputLog
+        void capture(frameInput* in)
+        {
+            in->cursorScreenx = this->_cursorScreenx;
+            in->cursorScreeny = this->_cursorScreeny;
+            in->cursorClientx = this->_cursorClientx;
+            in->cursorClienty = this->_cursorClienty;
+            in->wheel = this->_wheel;
+            in->rawDeltax = this->_rawMouseDeltax;
+            in->rawDeltay = this->_rawMouseDeltay;
+        }
+
+        // replacement for update that takes the state from a recorded frame
+        // world position needs 'updateWorld' afterwards because it depends on the camera
+        void apply(const frameInput* in)
+        {
+            this->_cursorDeltax = in->cursorScreenx - this->_cursorScreenx;
+            this->_cursorDeltay = in->cursorScreeny - this->_cursorScreeny;
+            this->_cursorScreenx = in->cursorScreenx;
+            this->_cursorScreeny = in->cursorScreeny;
+            this->_cursorClientx = in->cursorClientx;
+            this->_cursorClienty = in->cursorClienty;
+            this->_wheel = in->wheel;
+            this->_rawMouseDeltax = in->rawDeltax;
+            this->_rawMouseDeltay = in->rawDeltay;
+        }
+
+        // this is relative to monitor's upper left corner
+        void getCursorScreenPos(int* x, int* y)
+        {
+            *x = this->_cursorScreenx;
+            *y = this->_cursorScreeny;
+        }
+
+        // this is relative to client's upper left corner 
+        void getCursorClientPos(int* x, int* y)
+        {
+            *x = this->_cursorClientx;
+            *y = this->_cursorClienty;
+        }
+
+        void getCursorWorldPos(float* x, float* y)
+        {
+            *x = this->_cursorWorldx;
+            *y = this->_cursorWorldy;
+        }
+
+        void getCursorScreenDelta(int* x, int* y)
+        {
+            *x = this->_cursorDeltax;
+            *y = this->_cursorDeltay;
+        }
+
+        void getCursorDeltaRaw(int* x, int* y)
+        {
+            *x = this->_rawMouseDeltax;
+            *y = this->_rawMouseDeltay;
+        }
+
+        /// <summary>
+        /// Is cursor position different that last update
+        /// </summary>
+        bool moved()
+        {
+            return (this->_cursorDeltax + this->_cursorDeltay) != 0;
+        }
+
+        short getWheelDelta()
+        {
+            return this->_wheel;
+        }
+    };
+}
+
+namespace vi::net
+{
+#ifdef _WIN32
+    typedef SOCKET socketHandle;
+#else
+    typedef int socketHandle;
+    const int INVALID_SOCKET = -1;
+    const int SOCKET_ERROR = -1;
+#endif
+
+    // largest datagram that fits ethernet MTU without IP fragmentation is 1472, buffers have some slack
+    const uint NET_PACKET_SIZE = 1500;
+    // datagrams moved per recvmmsg / sendmmsg call
+    const uint NET_BATCH_SIZE = 64;
+    // kernel socket buffers, default ones overflow at high packet rates
+    const int NET_SOCKET_BUFFER = 4 << 20;
+
+    // servers and clients may be created from several threads
+    std::atomic<uint> uid{ 1 };
+#ifdef _WIN32
+    WSAData wsadata;
+#endif
+    char lastWinsockError[300];
+
+    void _getLastWinsockErrorMessage(int errorCode)
+    {
+#ifdef _WIN32
+        ZeroMemory(lastWinsockError, 300);
+        FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, 0, errorCode,
+            MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), lastWinsockError, 300, 0);
+#else
+        snprintf(lastWinsockError, sizeof(lastWinsockError), "%s\n", strerror(errorCode));
+#endif
+    }
+
+    int _getLastError()
+    {
+#ifdef _WIN32
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    void _printLastError()
+    {
+        _getLastWinsockErrorMessage(_getLastError());
+        fprintf(stderr, "%s", lastWinsockError);
+    }
+
+    // non blocking call had nothing to do, not an error
+    // on windows ICMP port unreachable from an earlier send shows up as reset, skip it too
+    bool _wouldBlock()
+    {
+#ifdef _WIN32
+        int e = WSAGetLastError();
+        return e == WSAEWOULDBLOCK || e == WSAECONNRESET;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNREFUSED || errno == EINTR;
+#endif
+    }
+
+    int _setNonBlocking(socketHandle s)
+    {
+#ifdef _WIN32
+        ULONG mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode);
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags < 0 ? -1 : fcntl(s, F_SETFL, flags | O_NONBLOCK);
+#endif
+    }
+
+    void _closeSocket(socketHandle s)
+    {
+        if (s == INVALID_SOCKET) return;
+#ifdef _WIN32
+        closesocket(s);
+#else
+        ::close(s);
+#endif
+    }
+
+    // waits until 's' is readable or timeout passes, -1 waits forever
+    bool _waitReadable(socketHandle s, int epoll, int timeoutMs)
+    {
+#ifdef __linux__
+        // 'epoll' already watches 's'
+        (void)s;
+        epoll_event e;
+        return epoll_wait(epoll, &e, 1, timeoutMs) > 0;
+#elif defined(_WIN32)
+        WSAPOLLFD p = { s, POLLRDNORM, 0 };
+        return WSAPoll(&p, 1, timeoutMs) > 0;
+#else
+        pollfd p = { s, POLLIN, 0 };
+        return poll(&p, 1, timeoutMs) > 0;
+#endif
+    }
+
+    int _createEpoll(socketHandle s)
+    {
+#ifdef __linux__
+        int epoll = epoll_create1(0);
+        epoll_event e = {};
+        e.events = EPOLLIN;
+        e.data.fd = s;
+        if (epoll >= 0) epoll_ctl(epoll, EPOLL_CTL_ADD, s, &e);
+        return epoll;
+#else
+        return -1;
+#endif
+    }
+
+    void initNetwork()
+    {
+#ifdef _WIN32
+        int res = WSAStartup(MAKEWORD(2, 2), &wsadata);
+
+#ifdef VI_VALIDATE
+        if (res != 0)
+        {
+            _getLastWinsockErrorMessage(res);
+            fprintf(stderr, "%s", lastWinsockError);
+        }
+#endif
+#endif
+    }
+
+    void uninitNetwork()
+    {
+#ifdef _WIN32
+        int res = WSACleanup();
+#ifdef VI_VALIDATE
+        if (res == SOCKET_ERROR)
+            _printLastError();
+#endif
+#endif
+    }
+
+    struct endpoint
+    {
+        sockaddr_in address;
+        float lastMessage;
+        bool isConnected;
+
+        void getAddress(char* dst, uint maxSize)
+        {
+            inet_ntop(AF_INET, &this->address.sin_addr, dst, maxSize);
+        }
+    };
+
+    // up to NET_BATCH_SIZE datagrams with their addresses, storage is allocated once in init
+    // received batch has sender in 'endpoints', outgoing batch has destination
+    struct batch
+    {
+        byte* storage;
+        // datagram i is at data[i], which points into storage unless repointed to avoid a copy
+        byte* data[NET_BATCH_SIZE];
+        uint lengths[NET_BATCH_SIZE];
+        endpoint endpoints[NET_BATCH_SIZE];
+        uint count;
+        // datagrams flush skipped because the send failed for good, e.g. unreachable network
+        unsigned long long dropped;
+#ifdef __linux__
+        mmsghdr headers[NET_BATCH_SIZE];
+        iovec vectors[NET_BATCH_SIZE];
+#endif
+
+        void init()
+        {
+            util::zero(this);
+            this->storage = (byte*)malloc((size_t)NET_BATCH_SIZE * NET_PACKET_SIZE);
+            for (uint i = 0; i < NET_BATCH_SIZE; i++) this->data[i] = this->storage + (size_t)i * NET_PACKET_SIZE;
+        }
+
+        void destroy()
+        {
+            ::free(this->storage);
+            this->storage = nullptr;
+        }
+
+        byte* getData(uint i)
+        {
+            return this->data[i];
+        }
+
+#ifdef __linux__
+        // points message headers at storage, 'len' of every entry is 'limit' for receive or length for send
+        void prepare(uint first, uint count, bool withAddress, bool forReceive)
+        {
+            for (uint i = first; i < first + count; i++)
+            {
+                this->vectors[i].iov_base = this->getData(i);
+                this->vectors[i].iov_len = forReceive ? NET_PACKET_SIZE : this->lengths[i];
+                msghdr* h = &this->headers[i].msg_hdr;
+                memset(h, 0, sizeof(msghdr));
+                h->msg_iov = &this->vectors[i];
+                h->msg_iovlen = 1;
+                h->msg_name = withAddress ? &this->endpoints[i].address : nullptr;
+                h->msg_namelen = withAddress ? sizeof(sockaddr_in) : 0;
+            }
+        }
+#endif
+    };
+
+    // receives up to 'limit' datagrams without blocking, returns number of datagrams in 'b'
+    // one recvmmsg per batch on linux, one recvfrom per datagram elsewhere
+    uint _receiveBatch(socketHandle s, batch* b, bool withAddress, uint limit)
+    {
+        b->count = 0;
+#ifdef __linux__
+        b->prepare(0, limit, withAddress, true);
+        int n = recvmmsg(s, b->headers, limit, MSG_DONTWAIT, nullptr);
+
+        if (n < 0)
+        {
+#ifdef VI_VALIDATE
+            if (!_wouldBlock()) _printLastError();
+#endif
+            return 0;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            b->lengths[i] = b->headers[i].msg_len;
+            b->endpoints[i].isConnected = true;
+        }
+
+        b->count = (uint)n;
+#else
+        while (b->count < limit)
+        {
+            endpoint* ep = &b->endpoints[b->count];
+            socklen_t len = sizeof(sockaddr_in);
+            int result = recvfrom(s, (char*)b->getData(b->count), NET_PACKET_SIZE, 0,
+                withAddress ? (sockaddr*)&ep->address : nullptr, withAddress ? &len : nullptr);
+
+            if (result < 0)
+            {
+#ifdef VI_VALIDATE
+                if (!_wouldBlock()) _printLastError();
+#endif
+                break;
+            }
+
+            b->lengths[b->count] = (uint)result;
+            ep->isConnected = true;
+            b->count++;
+        }
+#endif
+        return b->count;
+    }
+
+    // sends every datagram of 'b', what the socket doesn't take right now stays in 'b' for next flush
+    // a datagram that fails with anything else is dropped and counted so it doesn't block the rest
+    // returns number of datagrams sent
+    uint _flushBatch(socketHandle s, batch* b, bool withAddress)
+    {
+        uint sent = 0;
+        // sent and dropped, they leave the batch
+        uint done = 0;
+#ifdef __linux__
+        b->prepare(0, b->count, withAddress, false);
+
+        while (done < b->count)
+        {
+            int n = sendmmsg(s, b->headers + done, b->count - done, MSG_DONTWAIT);
+
+            if (n < 0 && !_wouldBlock())
+            {
+                // error is about the first datagram, the ones after it weren't tried
+#ifdef VI_VALIDATE
+                _printLastError();
+#endif
+                b->dropped++;
+                done++;
+                continue;
+            }
+
+            if (n <= 0) break;
+
+            sent += (uint)n;
+            done += (uint)n;
+        }
+#else
+        for (; done < b->count; done++)
+        {
+            int result = withAddress
+                ? sendto(s, (const char*)b->getData(done), b->lengths[done], 0, (const sockaddr*)&b->endpoints[done].address, (int)sizeof(sockaddr_in))
+                : ::send(s, (const char*)b->getData(done), b->lengths[done], 0);
+
+            if (result < 0)
+            {
+                if (_wouldBlock()) break;
+#ifdef VI_VALIDATE
+                _printLastError();
+#endif
+                b->dropped++;
+                continue;
+            }
+
+            sent++;
+        }
+#endif
+        // keep the rest at the front, payloads stay where they are and only the pointers move
+        if (done > 0 && done < b->count)
+        {
+            uint rest = b->count - done;
+            std::rotate(b->data, b->data + done, b->data + b->count);
+            memmove(b->lengths, b->lengths + done, rest * sizeof(uint));
+            memmove(b->endpoints, b->endpoints + done, rest * sizeof(endpoint));
+        }
+
+        b->count -= done;
+        return sent;
+    }
+
+    socketHandle _openSocket()
+    {
+        socketHandle s = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        if (s == INVALID_SOCKET)
+        {
+#ifdef VI_VALIDATE
+            _printLastError();
+#endif
+            return s;
+        }
+
+        int size = NET_SOCKET_BUFFER;
+        setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&size, sizeof(size));
+        setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char*)&size, sizeof(size));
+        return s;
+    }
+
+#ifdef VI_URING
+    // provided receive buffers, each holds io_uring_recvmsg_out, sender address and the datagram
+    const uint NET_URING_BUFFERS = 1024;
+    const uint NET_URING_BUFFER_SIZE = 2048;
+    const uint NET_URING_SQ_ENTRIES = 256;
+    // multishot receive posts one completion per datagram, completion ring is sized for bursts
+    const uint NET_URING_CQ_ENTRIES = 4096;
+    const unsigned long long NET_URING_RECV = 1;
+    const unsigned long long NET_URING_SEND = 2;
+    const unsigned long long NET_URING_CANCEL = 3;
+    // send completions carry index of the datagram in the batch above the low byte
+    const uint NET_URING_INDEX_SHIFT = 8;
+
+    // io_uring transport of a server socket through raw syscalls
+    // one multishot recvmsg keeps receiving into a registered ring of provided buffers,
+    // sends are submitted all at once on flush, socket is a registered file
+    struct uring
+    {
+        int fd;
+        io_uring_params params;
+        void* sqPtr;
+        size_t sqSize;
+        void* cqPtr;
+        size_t cqSize;
+        io_uring_sqe* sqes;
+        unsigned* sqHead;
+        unsigned* sqTail;
+        unsigned* sqMask;
+        unsigned* sqArray;
+        unsigned* cqHead;
+        unsigned* cqTail;
+        unsigned* cqMask;
+        io_uring_cqe* cqes;
+        // sqes filled since last submit
+        uint unsubmitted;
+
+        io_uring_buf_ring* bufRing;
+        byte* bufStorage;
+        ushort bufTail;
+        // template for multishot recvmsg, tells how much room the address gets in every buffer
+        msghdr recvHeader;
+        bool receiving;
+        // set when the kernel refused multishot receive
+        bool failed;
+        bool closing;
+        // received buffer ids in arrival order, NET_URING_BUFFERS of them at most
+        uint* ready;
+        uint readyHead;
+        uint readyCount;
+        uint pendingSends;
+        // result of each send of the batch being flushed
+        int sendResults[NET_BATCH_SIZE];
+
+        static int enter(int fd, uint submit, uint wait, uint flags, void* arg, size_t argSize)
+        {
+            return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, argSize);
+        }
+
+        static int registerResource(int fd, uint opcode, void* arg, uint count)
+        {
+            return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+        }
+
+        bool init(socketHandle s)
+        {
+            memset(this, 0, sizeof(uring));
+            this->params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+            this->params.cq_entries = NET_URING_CQ_ENTRIES;
+            this->fd = (int)syscall(__NR_io_uring_setup, NET_URING_SQ_ENTRIES, &this->params);
+
+            // older kernels don't know the optional flags
+            if (this->fd < 0)
+            {
+                memset(&this->params, 0, sizeof(io_uring_params));
+                this->params.flags = IORING_SETUP_CQSIZE;
+                this->params.cq_entries = NET_URING_CQ_ENTRIES;
+                this->fd = (int)syscall(__NR_io_uring_setup, NET_URING_SQ_ENTRIES, &this->params);
+            }
+
+            if (this->fd < 0 || !(this->params.features & IORING_FEAT_EXT_ARG))
+            {
+                this->destroy();
+                return false;
+            }
+
+            io_uring_params* p = &this->params;
+            this->sqSize = p->sq_off.array + p->sq_entries * sizeof(unsigned);
+            this->cqSize = p->cq_off.cqes + p->cq_entries * sizeof(io_uring_cqe);
+            bool single = p->features & IORING_FEAT_SINGLE_MMAP;
+            if (single) this->sqSize = this->cqSize = this->sqSize > this->cqSize ? this->sqSize : this->cqSize;
+
+            this->sqPtr = mmap(nullptr, this->sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+            this->cqPtr = single ? this->sqPtr
+                : mmap(nullptr, this->cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+            void* sqes = mmap(nullptr, p->sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                this->fd, IORING_OFF_SQES);
+            void* bufRing = mmap(nullptr, NET_URING_BUFFERS * sizeof(io_uring_buf), PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            this->sqes = sqes == MAP_FAILED ? nullptr : (io_uring_sqe*)sqes;
+            this->bufRing = bufRing == MAP_FAILED ? nullptr : (io_uring_buf_ring*)bufRing;
+            if (this->sqPtr == MAP_FAILED) this->sqPtr = nullptr;
+            if (this->cqPtr == MAP_FAILED) this->cqPtr = nullptr;
+
+            if (!this->sqPtr || !this->cqPtr || !this->sqes || !this->bufRing)
+            {
+                this->destroy();
+                return false;
+            }
+
+            byte* sq = (byte*)this->sqPtr;
+            byte* cq = (byte*)this->cqPtr;
+            this->sqHead = (unsigned*)(sq + p->sq_off.head);
+            this->sqTail = (unsigned*)(sq + p->sq_off.tail);
+            this->sqMask = (unsigned*)(sq + p->sq_off.ring_mask);
+            this->sqArray = (unsigned*)(sq + p->sq_off.array);
+            this->cqHead = (unsigned*)(cq + p->cq_off.head);
+            this->cqTail = (unsigned*)(cq + p->cq_off.tail);
+            this->cqMask = (unsigned*)(cq + p->cq_off.ring_mask);
+            this->cqes = (io_uring_cqe*)(cq + p->cq_off.cqes);
+
+            // socket is file 0 of this ring, saves a file table lookup per operation
+            int files[1] = { s };
+            io_uring_buf_reg reg = {};
+            reg.ring_addr = (unsigned long long)this->bufRing;
+            reg.ring_entries = NET_URING_BUFFERS;
+            reg.bgid = 0;
+
+            if (registerResource(this->fd, IORING_REGISTER_FILES, files, 1) < 0
+                || registerResource(this->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+            {
+                this->destroy();
+                return false;
+            }
 
-	VS_OUTPUT output;
-	output.Pos = mul(mul(mul(mul(mul(cam,loc), rot), sca), ori), pos);
-    output.Pos.z = spr.z;
-	output.Col = spr.color;
-    int u = uv[vid].x;
-    int v = uv[vid].y;
-    output.TexCoord = float2(spr.uv[u],spr.uv[v]);
-    output.data = float4(0,0,0,0);
+            this->bufStorage = (byte*)malloc((size_t)NET_URING_BUFFERS * NET_URING_BUFFER_SIZE);
+            this->ready = (uint*)malloc(NET_URING_BUFFERS * sizeof(uint));
 
-	return output;
-}
-)";
+            for (uint i = 0; i < NET_URING_BUFFERS; i++)
+                this->recycle(i);
 
-    const char rc_VertexShaderMesh[] = R"(
-struct VertexInputType
-{
-    float3 pos : POSITION;
-    float2 TexCoord : TEXCOORD;
-    float4 light : LIGHT;
-};
+            this->publishBuffers();
+            this->recvHeader.msg_namelen = sizeof(sockaddr_in);
+            this->arm();
+            this->submit(0);
+            this->reap();
 
-struct world
-{
-    float x,y,z, pad1;
-    float q1,q2,q3, pad2;
-    float sx,sy,sz;
-    uint data;
-    float4 color;
-};
+            if (this->failed)
+            {
+                this->destroy();
+                return false;
+            }
 
-struct view
-{
-    float aspectRatio,fovy,near,far;
-    float eyex,eyey,eyez;
-    float atx,aty,atz;
-    float upx,upy,upz;
-};
+            return true;
+        }
 
-cbuffer jedziemy: register(b0)
-{
-    world w;
-};
+        void destroy()
+        {
+            // ring teardown is asynchronous and would hold the socket open for a while,
+            // so the port could not be bound again right away. receive is cancelled and socket unregistered first
+            if (this->fd >= 0 && this->sqes)
+            {
+                this->closing = true;
+                io_uring_sqe* sqe = this->receiving ? this->getSqe() : nullptr;
 
-cbuffer poziolo : register(b1)
-{
-	view v;
-};
+                if (sqe)
+                {
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->addr = NET_URING_RECV;
+                    sqe->user_data = NET_URING_CANCEL;
+                    this->submit(0);
 
-cbuffer testb : register(b2)
-{
-    float4x4 transform;
-};
+                    while (this->receiving)
+                    {
+                        this->reap();
+                        if (this->receiving) enter(this->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                    }
+                }
 
-struct VS_OUTPUT
-{
-	float4 Pos : SV_POSITION;
-	float4 Col : COLOR;
-	float2 TexCoord : TEXCOORD;
-    uint4 data: COLOR2;
-};
+                registerResource(this->fd, IORING_UNREGISTER_FILES, nullptr, 0);
+            }
 
-float4x4 calcWorldViewProj(bool transform)
-{
-    float4x4 worldMat = {1,0,0,0, 0,1,0,0, 0,0,1,1, 0,0,0,1};
+            if (this->fd >= 0) ::close(this->fd);
+            if (this->sqes) munmap(this->sqes, this->params.sq_entries * sizeof(io_uring_sqe));
+            if (this->cqPtr && this->cqPtr != this->sqPtr) munmap(this->cqPtr, this->cqSize);
+            if (this->sqPtr) munmap(this->sqPtr, this->sqSize);
+            if (this->bufRing) munmap(this->bufRing, NET_URING_BUFFERS * sizeof(io_uring_buf));
+            ::free(this->bufStorage);
+            ::free(this->ready);
+            memset(this, 0, sizeof(uring));
+            this->fd = -1;
+        }
 
-    if(transform)
-{
-    float cr = cos(w.q1 * 0.5);
-    float sr = sin(w.q1 * 0.5);
-    float cp = cos(w.q2 * 0.5);
-    float sp = sin(w.q2 * 0.5);
-    float cy = cos(w.q3 * 0.5);
-    float sy = sin(w.q3 * 0.5);
-    float qw = cr * cp * cy + sr * sp * sy;
-    float qx = sr * cp * cy - cr * sp * sy;
-    float qy = cr * sp * cy + sr * cp * sy;
-    float qz = cr * cp * sy - sr * sp * cy;
-    float4x4 rotMat = {
-        qw*qw+qx*qx-qy*qy-qz*qz, 2*(qx*qy-qw*qz), 2*(qw*qy+qx*qz),0,
-        2*(qx*qy+qw*qz),qw*qw-qx*qx+qy*qy-qz*qz,2*(qy*qz-qw*qx),0,
-        2*(qx*qz-qw*qy),2*(qw*qx+qy*qz),qw*qw-qx*qx-qy*qy+qz*qz,0,
-        0,0,0,1
-    };
-    
-    float4x4 locMat = {
-            1,0,0, w.x,
-            0,1,0, w.y,
-            0,0,1, w.z,
-            0,0,0, 1,
-        };
+        byte* getBuffer(uint id)
+        {
+            return this->bufStorage + (size_t)id * NET_URING_BUFFER_SIZE;
+        }
 
-    float4x4 scaleMat = {
-        w.sx,0,0,0,
-        0,w.sy,0,0,
-        0,0,w.sz,0,
-        0,0,0,1
-    };
+        // gives buffer back to the kernel, visible after publishBuffers
+        void recycle(uint id)
+        {
+            // not bufRing->bufs, its flexible array wrapper has an extra byte in C++ and shifts the entries
+            io_uring_buf* b = (io_uring_buf*)this->bufRing + (this->bufTail & (NET_URING_BUFFERS - 1));
+            b->addr = (unsigned long long)this->getBuffer(id);
+            b->len = NET_URING_BUFFER_SIZE;
+            b->bid = (ushort)id;
+            this->bufTail++;
+        }
 
-    worldMat = mul(locMat, mul(rotMat, scaleMat));
-}
-    
-    float3 eye = {v.eyex, v.eyey, v.eyez};
-    float3 at = {v.atx,v.aty,v.atz};
-    float3 up = {v.upx,v.upy,v.upz};
-    float3 zaxis = normalize(at - eye);
-    float3 xaxis = normalize(cross(up, zaxis));
-    float3 yaxis = cross(zaxis, xaxis);
-    float4x4 viewMat = {
-        xaxis.x, xaxis.y, xaxis.z, -dot( xaxis, eye ),
-        yaxis.x, yaxis.y, yaxis.z, -dot( yaxis, eye ),
-        zaxis.x, zaxis.y, zaxis.z, -dot( zaxis, eye ),
-        0,0,0,1
-    };
+        void publishBuffers()
+        {
+            // tail overlays resv of the first entry
+            __atomic_store_n(&((io_uring_buf*)this->bufRing)->resv, this->bufTail, __ATOMIC_RELEASE);
+        }
 
-    // left handed
-    float h = 1/tan(v.fovy*0.5);
-    float4x4 projMat = {
-        h/v.aspectRatio, 0, 0, 0,
-        0, h, 0, 0,
-        0, 0, v.far/(v.far-v.near), (-v.near*v.far)/(v.far-v.near),
-        0, 0, 1, 0
-    };
+        // null when submission ring is full, submit and retry then
+        io_uring_sqe* getSqe()
+        {
+            unsigned tail = *this->sqTail;
+            if (tail - __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE) >= this->params.sq_entries)
+                return nullptr;
 
-    float4x4 worldViewProj = mul(projMat, mul(viewMat, worldMat));
-    return worldViewProj;
-}
+            unsigned index = tail & *this->sqMask;
+            io_uring_sqe* sqe = this->sqes + index;
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            this->sqArray[index] = index;
+            __atomic_store_n(this->sqTail, tail + 1, __ATOMIC_RELEASE);
+            this->unsubmitted++;
+            return sqe;
+        }
 
-VS_OUTPUT main(VertexInputType data, uint vid : SV_VertexID)
-{
-	float4 pos = float4(data.pos.x,data.pos.y,data.pos.z,1.0f);
+        // submits filled sqes and waits for 'wait' completions in the same syscall
+        int submit(uint wait)
+        {
+            int result = enter(this->fd, this->unsubmitted, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (result > 0) this->unsubmitted -= (uint)result < this->unsubmitted ? (uint)result : this->unsubmitted;
+            return result;
+        }
 
-	VS_OUTPUT output;
+        void arm()
+        {
+            io_uring_sqe* sqe = this->getSqe();
+            if (!sqe) return;
+
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = 0;
+            sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->addr = (unsigned long long)&this->recvHeader;
+            sqe->len = 1;
+            sqe->buf_group = 0;
+            sqe->user_data = NET_URING_RECV;
+            this->receiving = true;
+        }
 
-if(w.data == 16)
-{
-if(vid == 0)
-            pos = float4(w.x,w.y,w.z,1.0f);
-        if(vid == 1)
-            pos = float4(w.q1,w.q2,w.q3,1.0f);
-        if(vid == 2)
-            pos = float4(w.x,w.y,w.z,1.0f);
-        output.Pos = mul(calcWorldViewProj(false),pos);
-        output.Col = float4(w.color.r,w.color.g,w.color.b,1);
-	    output.TexCoord = float2(0,0);
-output.data = uint4(w.data,0,0,0);
-return output;
-}   
+        // moves completions to ready list and send count, rearms receive if it stopped
+        void reap()
+        {
+            unsigned head = *this->cqHead;
+            unsigned tail = __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE);
 
-    if(w.data & 4)
-    {
-	    output.Pos = mul(transform,pos);
-    }
-    else if(w.data & 8)
-    {
-        output.Pos = pos;
-        output.Col = float4(data.light);
-	    output.TexCoord = float2(data.TexCoord[0],data.TexCoord[1]);
-        output.data = uint4(w.data,0,0,0);
-	    return output;
-    }        
-    else
-    {
-        output.Pos = mul(calcWorldViewProj(true),pos);
-    }
+            for (; head != tail; head++)
+            {
+                io_uring_cqe* cqe = this->cqes + (head & *this->cqMask);
 
-	output.Col = w.color;
-    output.Col.a = 1;
-	output.TexCoord = float2(data.TexCoord[0],data.TexCoord[1]);
-    output.data = uint4(w.data,0,0,0);
+                if (cqe->user_data == NET_URING_CANCEL)
+                    continue;
 
-	return output;
-}
-)";
+                if ((cqe->user_data & 0xff) == NET_URING_SEND)
+                {
+                    this->sendResults[cqe->user_data >> NET_URING_INDEX_SHIFT] = cqe->res;
+                    this->pendingSends--;
+                    continue;
+                }
 
-    struct vector4
-    {
-        float x, y, z, w;
-    };
+                // no more flag means the multishot receive ended, usually because buffers ran out
+                if (!(cqe->flags & IORING_CQE_F_MORE))
+                    this->receiving = false;
 
-    struct vector3
-    {
-        float x, y, z;
-    };
+                if (cqe->res < 0)
+                {
+                    if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) this->failed = true;
+                    continue;
+                }
 
-    struct camera
-    {
-        float aspectRatio;
-        float x;
-        float y;
-        float rotation;
-        float scale;
-        // padding because this struct must be multiple of 16bytes
-        byte padding[12];
-    };
+                if (!(cqe->flags & IORING_CQE_F_BUFFER))
+                    continue;
 
-    struct camera3D
-    {
-        float aspectRatio;
-        float fovy;
-        float znear;
-        float zfar;
-        /// <summary>
-        /// where camera is
-        /// </summary>
-        vector3 eye;
-        /// <summary>
-        /// where camera looks at
-        /// </summary>
-        vector3 at;
-        /// <summary>
-        /// up vector, usually (0,1,0)
-        /// </summary>
-        vector3 up;
-        // padding because this struct must be multiple of 16bytes
-        float padding[3];
-    };
+                uint id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                uint at = (this->readyHead + this->readyCount) & (NET_URING_BUFFERS - 1);
+                this->ready[at] = id;
+                this->readyCount++;
+            }
 
-    struct vector2
-    {
-        float x, y;
-    };
+            __atomic_store_n(this->cqHead, head, __ATOMIC_RELEASE);
+
+            // rearming with every buffer still waiting in ready list would only fail with ENOBUFS again
+            if (!this->receiving && !this->failed && !this->closing && this->readyCount < NET_URING_BUFFERS)
+            {
+                this->arm();
+                this->submit(0);
+            }
+        }
+
+        // copies next received datagram out of its buffer and recycles the buffer, 0 when nothing is ready
+        uint pop(byte* data, uint limit, endpoint* ep)
+        {
+            while (this->readyCount > 0)
+            {
+                uint id = this->ready[this->readyHead];
+                this->readyHead = (this->readyHead + 1) & (NET_URING_BUFFERS - 1);
+                this->readyCount--;
+
+                byte* buffer = this->getBuffer(id);
+                io_uring_recvmsg_out* out = (io_uring_recvmsg_out*)buffer;
+                byte* name = buffer + sizeof(io_uring_recvmsg_out);
+                byte* payload = name + this->recvHeader.msg_namelen + this->recvHeader.msg_controllen;
+                uint len = out->payloadlen < limit ? out->payloadlen : limit;
+                bool truncated = out->flags & MSG_TRUNC;
+
+                memcpy(data, payload, len);
+                memcpy(&ep->address, name, sizeof(sockaddr_in));
+                this->recycle(id);
+
+                // larger than a buffer, same as a datagram dropped by the kernel
+                if (truncated || len == 0) continue;
+
+                ep->isConnected = true;
+                return len;
+            }
+
+            return 0;
+        }
+
+        uint receiveBatch(batch* b, uint limit)
+        {
+            this->reap();
+            b->count = 0;
+
+            while (b->count < limit)
+            {
+                uint len = this->pop(b->getData(b->count), NET_PACKET_SIZE, &b->endpoints[b->count]);
+                if (!len) break;
+                b->lengths[b->count++] = len;
+            }
+
+            this->publishBuffers();
+            return b->count;
+        }
+
+        uint receive(byte* data, uint limit, endpoint* ep)
+        {
+            if (this->readyCount == 0) this->reap();
+            uint len = this->pop(data, limit, ep);
+            this->publishBuffers();
+            return len;
+        }
+
+        // one sendmsg sqe per datagram, all submitted with one syscall that also waits for them
+        // same contract as _flushBatch, datagrams that would block stay in 'b', failed ones are dropped
+        uint flush(batch* b)
+        {
+            b->prepare(0, b->count, true, false);
+            uint queued = 0;
+
+            while (queued < b->count)
+            {
+                io_uring_sqe* sqe = this->getSqe();
 
-    struct color
-    {
-        float r, g, b, a;
-    };
+                if (!sqe)
+                {
+                    this->submit(0);
+                    continue;
+                }
 
-    struct uv
-    {
-        float left, top, right, bottom;
-    };
+                sqe->opcode = IORING_OP_SENDMSG;
+                sqe->fd = 0;
+                sqe->flags = IOSQE_FIXED_FILE;
+                sqe->addr = (unsigned long long)&b->headers[queued].msg_hdr;
+                sqe->len = 1;
+                sqe->user_data = NET_URING_SEND | ((unsigned long long)queued << NET_URING_INDEX_SHIFT);
+                this->pendingSends++;
+                queued++;
+            }
 
-    struct texture
-    {
-        int index;
-        int width;
-        int height;
-        ID3D11ShaderResourceView* shaderResource;
-    };
+            // message headers live in 'b', wait until kernel is done with them
+            this->submit(0);
 
-    // WARNING !!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-    // you updating something ? update shaders as well
-    // struct passed to uniform buffer must be multiple of 16bytes
-    struct sprite1
-    {
-        float x;
-        float y;
-        float z;
-        // scale x
-        float sx;
+            while (this->pendingSends > 0)
+            {
+                this->reap();
+                if (this->pendingSends > 0) enter(this->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            }
 
-        // 16 byte
+            // socket is non blocking so io_uring doesn't poll, full socket buffer comes back as EAGAIN
+            uint sent = 0;
+            uint kept = 0;
 
-        // scale y
-        float sy;
-        // angle
-        float rot;
-        // origin x
-        float ox;
-        // origin y
-        float oy;
+            for (uint i = 0; i < b->count; i++)
+            {
+                int res = this->sendResults[i];
 
-        // 16 byte
+                if (res >= 0)
+                {
+                    sent++;
+                    continue;
+                }
 
-        // uv left
-        float left;
-        // uv top
-        float top;
-        // uv right
-        float right;
-        // uv bottom
-        float bottom;
+                if (res != -EAGAIN)
+                {
+#ifdef VI_VALIDATE
+                    fprintf(stderr, "uring send failed: %s\n", strerror(-res));
+#endif
+                    b->dropped++;
+                    continue;
+                }
 
-        // 16 byte
+                // payload pointers are swapped so every storage slot stays owned by one datagram
+                std::swap(b->data[kept], b->data[i]);
+                b->lengths[kept] = b->lengths[i];
+                b->endpoints[kept] = b->endpoints[i];
+                kept++;
+            }
 
-        float r;
-        float g;
-        float b;
-        float a;
+            b->count = kept;
+            return sent;
+        }
 
-        // 16 byte
-        // some extra settings
-        uint nodraw : 1;
-        /// <summary>
-        /// no need to set manually, set to true if no texture on sprite
-        /// </summary>
-        uint notexture : 1;
-        uint padding : 30;
+        bool wait(int timeoutMs)
+        {
+            this->reap();
+            if (this->readyCount > 0) return true;
 
-        texture* t;
-    };
+            if (timeoutMs < 0)
+            {
+                enter(this->fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            }
+            else
+            {
+                __kernel_timespec ts = { timeoutMs / 1000, (long long)(timeoutMs % 1000) * 1000000 };
+                io_uring_getevents_arg arg = {};
+                arg.ts = (unsigned long long)&ts;
+                enter(this->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+            }
 
-    struct sprite2
-    {
-        vector3 pos;
-        vector2 scale;
-        float rot;
-        vector2 origin;
-        uv uv1;
-        color col;
-        uint flags;
-        texture* t;
+            this->reap();
+            return this->readyCount > 0;
+        }
     };
+#endif
 
-    struct line
+    enum class transport : byte
     {
-        float x1;
-        float y1;
-        float z1;
-        float x2;
-        float y2;
-        float z2;
-        float _1;
-        float _2;
-        float _3;
-        float _4;
-        float _5;
-        float _6;
-        float r;
-        float g;
-        float b;
-        float a;
+        // plain sockets, recvmmsg/sendmmsg and epoll on linux
+        Sockets,
+        // io_uring on linux, falls back to Sockets when the kernel or its headers don't support it
+        Uring
     };
 
-    // 16 bytes alignment, although I'm not sure it's necessary
-    _declspec(align(16))
-        union sprite
+    struct server
     {
-        sprite1 s1;
-        sprite2 s2;
-        line line;
+        socketHandle s;
+        sockaddr_in address;
+        unsigned short port;
+        uint id;
+        int epoll;
+        // filled by queueSend, sent by flush
+        batch outgoing;
+        // what init ended up with, can differ from what was asked for
+        transport active;
+#ifdef VI_URING
+        uring ring;
+#endif
 
-        // makes minimum changes to make object show when drawn
-        void init(texture* t)
+        // 'reusePort' lets more sockets bind the same port and the kernel spreads datagrams
+        // between them, it's ignored where SO_REUSEPORT doesn't exist
+        void init(ushort port, transport t = transport::Sockets, bool reusePort = false)
         {
-            vi::util::zero(this);
-            this->s1.t = t;
-            this->s2.col = { 1,1,1,1 };
-            this->s2.scale = { 1,1 };
-            this->s2.uv1 = { 0,0,1,1 };
+            this->port = port;
+            this->active = transport::Sockets;
+#ifdef VI_URING
+            this->ring.fd = -1;
+#endif
+            this->id = uid++;
+            this->epoll = -1;
+            this->outgoing.init();
+            this->s = _openSocket();
+
+            if (this->s == INVALID_SOCKET)
+                return;
+
+            memset(&this->address, 0, sizeof(sockaddr_in));
+            this->address.sin_port = htons(port);
+            this->address.sin_family = AF_INET;
+            this->address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+#ifdef SO_REUSEPORT
+            int on = 1;
+            if (reusePort) setsockopt(this->s, SOL_SOCKET, SO_REUSEPORT, (const char*)&on, sizeof(on));
+#endif
+
+            if (bind(this->s, (sockaddr*)&this->address, (int)sizeof(sockaddr)) == SOCKET_ERROR
+                || _setNonBlocking(this->s) == SOCKET_ERROR)
+            {
+#ifdef VI_VALIDATE
+                _printLastError();
+#endif
+                // 's' tells the caller it failed
+                _closeSocket(this->s);
+                this->s = INVALID_SOCKET;
+                return;
+            }
+
+            this->epoll = _createEpoll(this->s);
+
+#ifdef VI_URING
+            if (t == transport::Uring && this->ring.init(this->s))
+                this->active = transport::Uring;
+#endif
+#ifdef VI_VALIDATE
+            if (t != this->active)
+                fprintf(stderr, "server: io_uring is not available, using epoll\n");
+#endif
         }
-    };
 
-    // TODO, this should replace sprite
-    _declspec(align(16))
-        union spriten
-    {
-        struct
-        {
-            vector3 pos;
-            vector2 scale;
-            float rot;
-            vector2 origin;
-            uv uv1;
-            color col;
-            uint flags;
-            texture* t;
-        };
-        struct
+        // false if the datagram was not sent
+        bool send(const byte* data, uint len, const endpoint* ep)
         {
-            float x;
-            float y;
-            float z;
-            // scale x
-            float sx;
+            int result = sendto(this->s, (const char*)data, len, 0, (const sockaddr*)&ep->address, (int)sizeof(sockaddr));
+#ifdef VI_VALIDATE
+            if (result == SOCKET_ERROR && !_wouldBlock())
+                _printLastError();
+#endif
+            return result != SOCKET_ERROR;
+        }
 
-            // 16 byte
+        // copies datagram to outgoing batch, everything goes out in one call on flush
+        // flushes by itself when the batch is full
+        void queueSend(const byte* data, uint len, const endpoint* ep)
+        {
+            if (this->outgoing.count == NET_BATCH_SIZE)
+                this->flush();
 
-            // scale y
-            float sy;
-            // angle
-            float rot;
-            // origin x
-            float ox;
-            // origin y
-            float oy;
+            if (this->outgoing.count == NET_BATCH_SIZE || len > NET_PACKET_SIZE)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "server::queueSend dropped datagram of %u bytes\n", len);
+#endif
+                return;
+            }
 
-            // 16 byte
+            uint i = this->outgoing.count++;
+            memcpy(this->outgoing.getData(i), data, len);
+            this->outgoing.lengths[i] = len;
+            this->outgoing.endpoints[i] = *ep;
+        }
 
-            // uv left
-            float left;
-            // uv top
-            float top;
-            // uv right
-            float right;
-            // uv bottom
-            float bottom;
+        // returns number of datagrams sent
+        uint flush()
+        {
+            return this->flushBatch(&this->outgoing);
+        }
 
-            // 16 byte
+        // sends a batch filled by the caller, unsent datagrams stay in 'b'
+        uint flushBatch(batch* b)
+        {
+#ifdef VI_URING
+            if (this->active == transport::Uring) return this->ring.flush(b);
+#endif
+            return _flushBatch(this->s, b, true);
+        }
 
-            float r;
-            float g;
-            float b;
-            float a;
+        /// <summary>
+        /// Returns number of bytes received, sender is written to 'ep'.
+        /// It's 0 if there was nothing to receive, 'ep' is not touched then.
+        /// </summary>
+        uint receive(byte* data, uint limit, endpoint* ep)
+        {
+#ifdef VI_URING
+            if (this->active == transport::Uring) return this->ring.receive(data, limit, ep);
+#endif
+            sockaddr_in address;
+            socklen_t len = sizeof(sockaddr_in);
+            int result = recvfrom(this->s, (char*)data, limit, 0, (sockaddr*)&address, &len);
 
-            // 16 byte
-            // some extra settings
-            uint nodraw : 1;
-            /// <summary>
-            /// no need to set manually, set to true if no texture on sprite
-            /// </summary>
-            uint notexture : 1;
-            uint padding : 30;
+            if (result == SOCKET_ERROR)
+            {
+#ifdef VI_VALIDATE
+                if (!_wouldBlock()) _printLastError();
+#endif
+                return 0;
+            }
 
-            texture* t;
-        };
-    };
+            memcpy(&ep->address, &address, sizeof(sockaddr_in));
+            ep->isConnected = true;
+            return (uint)result;
+        }
 
-    struct dynamic
-    {
-        sprite* s;
-        time::timer* t;
-        float velx, vely, velz;
-        float accx, accy, accz;
-        // angular velocity
-        float velrot;
-        // angular acceleration
-        float accrot;
-        // grow speed
-        float velsx, velsy;
-        // grow acceleration
-        float accsx, accsy;
-        float _lastUpdate;
+        // receives up to 'limit' datagrams, returns how many
+        uint receiveBatch(batch* b, uint limit = NET_BATCH_SIZE)
+        {
+#ifdef VI_URING
+            if (this->active == transport::Uring) return this->ring.receiveBatch(b, limit);
+#endif
+            return _receiveBatch(this->s, b, true, limit);
+        }
 
-        void init(sprite* s, time::timer* t)
+        // blocks until something can be received or 'timeoutMs' passes, -1 waits forever
+        bool wait(int timeoutMs)
         {
-            vi::util::zero(this);
-            this->s = s;
-            this->t = t;
-            this->_lastUpdate = t->getGameTimeSec();
+#ifdef VI_URING
+            if (this->active == transport::Uring) return this->ring.wait(timeoutMs);
+#endif
+            return _waitReadable(this->s, this->epoll, timeoutMs);
         }
 
-        void update()
+        void destroyServer()
         {
-            float currentTime = this->t->getGameTimeSec();
-            float delta = currentTime - this->_lastUpdate;
-            this->_lastUpdate = currentTime;
-
-            this->velx += this->accx * delta;
-            this->s->s1.x += this->velx * delta;
-            this->vely += this->accy * delta;
-            this->s->s1.y += this->vely * delta;
-            this->velz += this->accz * delta;
-            this->s->s1.z += this->velz * delta;
-            this->velrot += this->accrot * delta;
-            this->s->s1.rot += this->velrot * delta;
-            this->velsx += this->accsx * delta;
-            this->s->s1.sx += this->velsx * delta;
-            this->velsy += this->accsy * delta;
-            this->s->s1.sy += this->velsy * delta;
+#ifdef VI_URING
+            if (this->active == transport::Uring) this->ring.destroy();
+#endif
+            _closeSocket(this->s);
+#ifdef __linux__
+            if (this->epoll >= 0) ::close(this->epoll);
+#endif
+            this->outgoing.destroy();
+            this->s = INVALID_SOCKET;
+            this->epoll = -1;
         }
     };
 
-    // for now speed must be non negative
-    struct animation
+    struct client
     {
-        sprite* s;
-        time::timer* t;
-        uv* u;
-        float speed;
-        uint frameCount;
-        int currentFrame;
-        uint stopAfter;
-        // this is true if last 'updateAnimation' changed 'currentFrame'
-        bool frameChanged;
+        socketHandle s;
+        sockaddr_in serverAddress;
+        unsigned short serverPort;
+        uint id;
+        int epoll;
+        batch outgoing;
 
-        uint _frameChanges;
-        float _elapsedTime;
-        float _lastUpdate;
-        bool _playing;
+        void init(const char* address, uint port)
+        {
+            vi::util::zero<client>(this);
+            this->serverPort = port;
+            this->id = uid++;
+            this->epoll = -1;
+            this->outgoing.init();
+            this->s = _openSocket();
 
-        // 'stopAfter' stop animation after that many frame changes, 0 = never stop
-        void init(sprite* s, time::timer* t, uv* u, uint frameCount, float secondsPerFrame, uint stopAfter)
+            if (this->s == INVALID_SOCKET)
+                return;
+
+            this->serverAddress.sin_port = htons(port);
+            this->serverAddress.sin_family = AF_INET;
+            inet_pton(AF_INET, address, &this->serverAddress.sin_addr);
+            // connect is done so you dont have to pass address in sendto and recvfrom
+            // client communicates with only one address
+            // and set non blocking
+            if (connect(this->s, (sockaddr*)&this->serverAddress, sizeof(sockaddr)) == SOCKET_ERROR
+                || _setNonBlocking(this->s) == SOCKET_ERROR)
+            {
+#ifdef VI_VALIDATE
+                _printLastError();
+#endif
+                // 's' tells the caller it failed
+                _closeSocket(this->s);
+                this->s = INVALID_SOCKET;
+                return;
+            }
+
+            this->epoll = _createEpoll(this->s);
+        }
+
+        bool send(const byte* data, uint len)
         {
-            this->t = t;
-            this->s = s;
-            this->u = u;
-            this->speed = secondsPerFrame;
-            this->frameCount = frameCount;
-            this->currentFrame = 0;
-            this->stopAfter = stopAfter;
-            this->frameChanged = false;
-            this->_elapsedTime = 0;
-            this->_playing = false;
-            this->_frameChanges = 0;
-            this->_lastUpdate = 0;
-            // update uv to the current frame
-            this->s->s2.uv1 = this->u[this->currentFrame];
+            int result = ::send(this->s, (const char*)data, len, 0);
+#ifdef VI_VALIDATE
+            if (result == SOCKET_ERROR && !_wouldBlock())
+                _printLastError();
+#endif
+            return result != SOCKET_ERROR;
         }
 
-        // make 'updateAnimation' animate frames
-        void play()
+        void queueSend(const byte* data, uint len)
         {
-            if (this->_playing) return;
+            if (this->outgoing.count == NET_BATCH_SIZE)
+                this->flush();
 
-            this->_playing = true;
-            this->_lastUpdate = this->t->getGameTimeSec();
-            // update uv to the current frame
-            this->s->s2.uv1 = { this->u[this->currentFrame] };
+            if (this->outgoing.count == NET_BATCH_SIZE || len > NET_PACKET_SIZE)
+            {
+#ifdef VI_VALIDATE
+                fprintf(stderr, "client::queueSend dropped datagram of %u bytes\n", len);
+#endif
+                return;
+            }
+
+            uint i = this->outgoing.count++;
+            memcpy(this->outgoing.getData(i), data, len);
+            this->outgoing.lengths[i] = len;
         }
 
-        // animation will stop and 'updateAnimation' will no longer animate frames
-        void pause()
+        uint flush()
         {
-            this->_playing = false;
+            return this->flushBatch(&this->outgoing);
         }
 
-        // stop and reset animation so it can be played from the beginning
-        void reset()
+        uint flushBatch(batch* b)
         {
-            this->currentFrame = 0;
-            this->frameChanged = false;
-            this->_elapsedTime = 0;
-            this->_playing = false;
-            this->_frameChanges = 0;
+            return _flushBatch(this->s, b, false);
         }
 
-        // stops playing 'from' starts playing 'to'
-        // if 'from' is not playing ot 'to' is playing then nothing happens
-        void change(animation* dst)
+        // returns number of bytes received, 0 if there was nothing
+        uint receive(byte* data, uint limit)
         {
-            if (!this->_playing || dst->_playing) return;
+            int result = recv(this->s, (char*)data, limit, 0);
 
-            this->reset();
-            dst->play();
+            if (result == SOCKET_ERROR)
+            {
+#ifdef VI_VALIDATE
+                if (!_wouldBlock()) _printLastError();
+#endif
+                return 0;
+            }
+
+            return (uint)result;
         }
 
-        void flipHorizontally()
+        uint receiveBatch(batch* b, uint limit = NET_BATCH_SIZE)
         {
-            for (uint i = 0; i < this->frameCount; i++)
-                util::swap(this->u[i].left, this->u[i].right);
+            return _receiveBatch(this->s, b, false, limit);
         }
 
-        void flipVertically()
+        bool wait(int timeoutMs)
         {
-            for (uint i = 0; i < this->frameCount; i++)
-                util::swap(this->u[i].top, this->u[i].bottom);
+            return _waitReadable(this->s, this->epoll, timeoutMs);
         }
 
-        // current algorithm 
-        // measure how much time elapsed since last update and add it to total time elapsed
-        // if total time elapsed is greater than speed (thus measured in seconds per frame)
-        // then reduce total time elapsed by speed and change frame
-        void update()
+        void destroyClient()
         {
-            // not playing, early break
-            if (!this->_playing) return;
+            _closeSocket(this->s);
+#ifdef __linux__
+            if (this->epoll >= 0) ::close(this->epoll);
+#endif
+            this->outgoing.destroy();
+            this->s = INVALID_SOCKET;
+            this->epoll = -1;
+        }
+    };
 
-            // set frame changed to false to invalidate previous true
-            this->frameChanged = false;
-            float gameTime = this->t->getGameTimeSec();
-            // elpased since last update
-            float elapsed = gameTime - this->_lastUpdate;
-            // update last update
-            this->_lastUpdate = gameTime;
-            // update elapsed
-            this->_elapsedTime += elapsed;
+    bool compareEndpoints(const endpoint* a, const endpoint* b)
+    {
+        return memcmp(&a->address, &b->address, 8) == 0;
+    }
 
-            // see if enough time elapsed to change frame
-            if (this->_elapsedTime > this->speed)
+    // wait-free ring for one producer and one consumer thread, capacity is power of 2
+    // each side keeps a cached copy of the other side's index so it rarely touches its cache line
+    template<typename T>
+    struct spscRing
+    {
+        T* items;
+        uint mask;
+        alignas(64) std::atomic<uint> head;
+        uint cachedTail;
+        alignas(64) std::atomic<uint> tail;
+        uint cachedHead;
+
+        void init(uint capacity)
+        {
+#ifdef VI_VALIDATE
+            if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+                fprintf(stderr, "spscRing capacity must be power of 2\n");
+#endif
+            this->items = (T*)malloc(capacity * sizeof(T));
+            this->mask = capacity - 1;
+            this->head.store(0, std::memory_order_relaxed);
+            this->tail.store(0, std::memory_order_relaxed);
+            this->cachedHead = 0;
+            this->cachedTail = 0;
+        }
+
+        void destroy()
+        {
+            ::free(this->items);
+            this->items = nullptr;
+        }
+
+        // producer only, false when full
+        bool push(T value)
+        {
+            uint h = this->head.load(std::memory_order_relaxed);
+
+            if (h - this->cachedTail > this->mask)
             {
-                // subtract the duration of one frame
-                this->_elapsedTime -= this->speed;
-                // update frame index including looping
-                this->currentFrame = (this->currentFrame + 1) % this->frameCount;
-                this->frameChanged = true;
-                this->_frameChanges++;
+                this->cachedTail = this->tail.load(std::memory_order_acquire);
+                if (h - this->cachedTail > this->mask) return false;
+            }
 
-                // update uv
-                uv* uv = this->u + this->currentFrame;
-                this->s->s2.uv1 = *uv;
+            this->items[h & this->mask] = value;
+            this->head.store(h + 1, std::memory_order_release);
+            return true;
+        }
 
-                // enough frame changed occured so stop playing
-                if (this->stopAfter != 0 && this->_frameChanges > this->stopAfter)
-                    this->_playing = false;
+        // consumer only, false when empty
+        bool pop(T* value)
+        {
+            uint t = this->tail.load(std::memory_order_relaxed);
+
+            if (t == this->cachedHead)
+            {
+                this->cachedHead = this->head.load(std::memory_order_acquire);
+                if (t == this->cachedHead) return false;
             }
+
+            *value = this->items[t & this->mask];
+            this->tail.store(t + 1, std::memory_order_release);
+            return true;
         }
     };
 
-    struct font
+    struct packetPool;
+
+    // room in front of the payload for headers added on the way out
+    const uint NET_HEADROOM = 64;
+
+    // reference counted buffer from a packetPool, MTU sized unless the pool says otherwise
+    // it's passed along instead of copying, from receive through handlers, and
+    // one buffer can go to many endpoints, each send holds a reference
+    struct packetBuffer
     {
-        texture* tex;
-        uv uv[256];
+        packetPool* pool;
+        std::atomic<uint> refs;
+        // index in pool, links free list
+        uint index;
+        // payload is bytes[offset .. offset + len]
+        uint offset;
+        uint len;
+        // headroom and payload capacity
+        uint size;
+        // arrival time of received buffer
+        long long timeNs;
+        // sender of received buffer
+        endpoint ep;
+        byte* bytes;
+
+        byte* getData()
+        {
+            return this->bytes + this->offset;
+        }
+
+        // room for a header in front of the payload, null if headroom is used up
+        byte* prepend(uint size)
+        {
+            if (size > this->offset) return nullptr;
+            this->offset -= size;
+            this->len += size;
+            return this->bytes + this->offset;
+        }
+
+        // skips a parsed header
+        byte* consume(uint size)
+        {
+            if (size > this->len) size = this->len;
+            this->offset += size;
+            this->len -= size;
+            return this->bytes + this->offset;
+        }
+
+        // room for more payload at the end, null if it wouldn't fit
+        byte* append(uint size)
+        {
+            if (this->offset + this->len + size > this->size) return nullptr;
+            byte* at = this->bytes + this->offset + this->len;
+            this->len += size;
+            return at;
+        }
+
+        void retain(uint count = 1)
+        {
+            this->refs.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // last release returns the buffer to its pool
+        void release();
     };
 
-    struct text
+    // fixed array of packetBuffer and their bytes, allocated once
+    // free list is a lock free stack, index and a tag against ABA packed in one 64 bit word
+    // so any thread can allocate and release
+    struct packetPool
     {
-        font* f;
-        sprite* s;
+        packetBuffer* buffers;
+        byte* storage;
+        uint* next;
         uint capacity;
-        const char* str;
-        float horizontalSpace;
-        float verticalSpace;
-
-        void init(font* f, sprite* s, uint capacity, const char* str)
-        {
-#ifdef VI_VALIDATE
-            if (!f || !s || capacity < 1 || !str)
-            {
-                fprintf(stderr, "%s invalid argument\n", __func__);
-                return;
-            }
+        std::atomic<unsigned long long> head;
+        std::atomic<uint> available;
 
-            if (!f->tex)
-            {
-                fprintf(stderr, "%s font has not texture\n", __func__);
-                return;
-            }
-#endif
+        static const uint NONE = 0xffffffff;
 
-            this->f = f;
-            this->s = s;
+        // 'payloadSize' is room after headroom, bigger than a datagram for reassembled messages
+        void init(uint capacity, uint payloadSize = NET_PACKET_SIZE)
+        {
+            size_t stride = (NET_HEADROOM + payloadSize + 15) & ~(size_t)15;
             this->capacity = capacity;
-            this->str = str;
-            this->verticalSpace = 0;
-            this->horizontalSpace = 0;
+            this->buffers = (packetBuffer*)malloc((size_t)capacity * sizeof(packetBuffer));
+            this->storage = (byte*)malloc(stride * capacity);
+            this->next = (uint*)malloc(capacity * sizeof(uint));
 
             for (uint i = 0; i < capacity; i++)
             {
-                vi::util::zero(s + i);
-                s[i].init(f->tex);
-                s[i].s2.col = { 0,0,0,1 };
+                packetBuffer* b = this->buffers + i;
+                b->pool = this;
+                b->index = i;
+                b->size = NET_HEADROOM + payloadSize;
+                b->bytes = this->storage + stride * i;
+                b->refs.store(0, std::memory_order_relaxed);
+                this->next[i] = i + 1 < capacity ? i + 1 : NONE;
             }
+
+            this->head.store(capacity ? 0 : NONE);
+            this->available.store(capacity);
         }
 
-        void update()
+        void destroy()
         {
-            float x = s->s1.x;
-            float y = s->s1.y;
-
-            bool zero = false;
-            for (uint i = 0; i < this->capacity; i++)
-            {
-                if (!zero && this->str[i] == 0) zero = true;
+            ::free(this->buffers);
+            ::free(this->storage);
+            ::free(this->next);
+            this->buffers = nullptr;
+            this->storage = nullptr;
+            this->next = nullptr;
+        }
 
-                if (zero)
-                {
-                    this->s[i].s1.nodraw = 1;
-                }
-                else if (this->str[i] == '\n')
-                {
-                    x = this->s[0].s1.x;
-                    y += this->s[0].s1.sy + this->verticalSpace;
-                    this->s[i].s1.nodraw = true;
-                    this->s[i].s2.scale = { 0,0 };
-                }
-                else
-                {
-                    this->s[i].s2.uv1 = this->f->uv[str[i] - ' '];
-                    this->s[i].s1.x = x;
-                    this->s[i].s1.y = y;
-                    // set scale and origin equal to the first sprite in the set
-                    this->s[i].s2.scale = this->s[0].s2.scale;
-                    this->s[i].s2.origin = this->s[0].s2.origin;
-                    this->s[i].s1.nodraw = 0;
+        // buffer with one reference, full headroom and no payload, null when the pool is empty
+        packetBuffer* allocate()
+        {
+            unsigned long long h = this->head.load(std::memory_order_acquire);
 
-                    x += this->s[0].s1.sx + this->horizontalSpace;
+            while (true)
+            {
+                uint index = (uint)h;
+                if (index == NONE) return nullptr;
+
+                unsigned long long tagged = ((h >> 32) + 1) << 32 | this->next[index];
+                if (this->head.compare_exchange_weak(h, tagged, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    packetBuffer* b = this->buffers + index;
+                    b->refs.store(1, std::memory_order_relaxed);
+                    b->offset = NET_HEADROOM;
+                    b->len = 0;
+                    this->available.fetch_sub(1, std::memory_order_relaxed);
+                    return b;
                 }
             }
         }
-    };
 
-    struct vertex
-    {
-        vector3 pos;
-        vector2 uv;
-        /// <summary>
-        /// light information
-        /// </summary>
-        color color;
-    };
+        void free(packetBuffer* b)
+        {
+            unsigned long long h = this->head.load(std::memory_order_relaxed);
 
-    _declspec(align(16))
-        struct line3d
-    {
-        vector3 p1;
-        float pad1;
+            while (true)
+            {
+                this->next[b->index] = (uint)h;
+                unsigned long long tagged = ((h >> 32) + 1) << 32 | b->index;
+                if (this->head.compare_exchange_weak(h, tagged, std::memory_order_release, std::memory_order_relaxed))
+                    break;
+            }
 
-        vector3 p2;
-        float pad2;
+            this->available.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
 
-        float pad3[3];
-        uint data;
+    void packetBuffer::release()
+    {
+        if (this->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            this->pool->free(this);
+    }
 
-        color color;
+    // one entry of netThread outgoing ring, the same buffer can be in many of them
+    struct sendItem
+    {
+        packetBuffer* buffer;
+        endpoint ep;
     };
 
-    struct mesh
+    // Owns a server or client socket on its own thread. Datagrams are received straight into
+    // pooled buffers, stamped with arrival time and handed over through wait-free rings,
+    // so the game thread never waits for the network and nothing is copied on the way.
+    // game thread: drain and release received buffers, allocate + enqueue or broadcast to send
+    struct netThread
     {
-        vertex* v;
-        /// <summary>
-        /// vertex order for index buffer, this can be null
-        /// if it's null then vertices are rendered in order, topology is always 'triangle list'
-        /// </summary>
-        uint* index;
-        texture* t;
-        ID3D11Buffer* vertexBuffer;
-        ID3D11Buffer* indexBuffer;
-        /// <summary>
-        /// this should be multiple of 3 since topology is triangle list
-        /// </summary>
-        uint vertexCount;
-        uint indexCount;
-
-        vector3 pos;
-        float pad1;
+        server srv;
+        client cli;
+        bool isClient;
+        packetPool pool;
+        spscRing<packetBuffer*> received;
+        spscRing<sendItem> outgoing;
+        // wait timeout when idle, bounds how long an enqueued packet waits
+        int idleWaitMs;
+        // buffers kept ready for the next receive, receiving stops when this many are left in the pool
+        // so allocate doesn't starve while the game holds received buffers, it's a quarter of the pool
+        uint receiveSlots;
+        std::atomic<bool> running;
+        // received while the ring to the game thread was full, with a low pool datagrams wait in the socket instead
+        std::atomic<unsigned long long> dropped;
+        std::thread thread;
+
+        // false when the socket can't be opened, no thread runs then but destroy is still needed
+        bool initServer(ushort port, uint capacity, transport t = transport::Sockets)
+        {
+            this->isClient = false;
+            this->srv.init(port, t);
+            return this->start(capacity);
+        }
 
-        vector3 rot;
-        float pad2;
+        bool initClient(const char* address, uint port, uint capacity)
+        {
+            this->isClient = true;
+            this->cli.init(address, port);
+            return this->start(capacity);
+        }
 
-        vector3 sca;
-        uint data;
+        // 'capacity' buffers are shared by both directions, rings can hold all of them
+        bool start(uint capacity)
+        {
+            uint ring = 1;
+            while (ring < capacity) ring <<= 1;
+
+            this->pool.init(capacity);
+            this->received.init(ring);
+            this->outgoing.init(ring);
+            this->idleWaitMs = 1;
+            this->receiveSlots = capacity / 4 < NET_BATCH_SIZE ? capacity / 4 : NET_BATCH_SIZE;
+            if (this->receiveSlots == 0) this->receiveSlots = 1;
+            this->dropped.store(0);
+            this->running.store(false);
+
+            // wait would return at once on a closed socket and the thread would spin
+            if ((this->isClient ? this->cli.s : this->srv.s) == INVALID_SOCKET) return false;
+
+            this->running.store(true);
+            this->thread = std::thread([this]() { this->run(); });
+            return true;
+        }
 
-        color color;
-        uint pad3;
-    };
+        void destroy()
+        {
+            this->running.store(false);
+            if (this->thread.joinable()) this->thread.join();
 
-    struct rendererInfo
-    {
-        system::window* wnd;
-        float clearColor[4];
-    };
+            // what the game didn't drain goes back to the pool, rings have no other user after join
+            packetBuffer* p;
+            while (this->received.pop(&p)) p->release();
+            sendItem item;
+            while (this->outgoing.pop(&item)) item.buffer->release();
 
-    enum class TextureFilter { Point, Linear };
+            if (this->isClient) this->cli.destroyClient();
+            else this->srv.destroyServer();
 
-    struct uvSplitInfo
-    {
-        uint pixelTexWidth;
-        uint pixelTexHeight;
-        uint pixelOffsetx;
-        uint pixelOffsety;
-        uint pixelFrameWidth;
-        uint pixelFrameHeight;
-        uint rowLength;
-        uint frameCount;
-    };
+            this->received.destroy();
+            this->outgoing.destroy();
+            this->pool.destroy();
+        }
 
-    struct renderer
-    {
-        system::window* window;
-        IDXGISwapChain* swapChain;
-        ID3D11RenderTargetView* backBuffer;
-        ID3D11Device* device;
-        ID3D11DeviceContext* context;
-        ID3D11VertexShader* defaultVS;
-        ID3D11VertexShader* defaultMeshVS;
-        ID3D11VertexShader* currentVS;
-        ID3D11PixelShader* defaultPS;
-        ID3D11DepthStencilView* depthStencilView;
-        ID3D11Texture2D* depthStencilBuffer;
-        ID3D11InputLayout* inputLayout;
-        ID3D11RasterizerState* wireframe;
-        ID3D11RasterizerState* solid;
-        ID3D11SamplerState* point;
-        ID3D11SamplerState* linear;
-        ID3D11Buffer* cbufferVS;
-        ID3D11Buffer* cbufferPS;
-        ID3D11Buffer* cbufferVScamera;
-        ID3D11Buffer* world;
-        ID3D11Buffer* view;
-        ID3D11Buffer* transform;
-        ID3D11Buffer* dynamicVertexBuffer;
-        ID3D11BlendState* blendState;
-        camera camera;
-        camera3D* camera3Dptr;
-        float backBufferColor[4];
-        double frequency;
-        long long startTime;
-        long long prevFrameTime;
-        double gameTime;
-        double frameTime;
-        bool fullscreen;
-        /// <summary>
-        /// if you render meshes and sprites then batch them together
-        /// different constant buffers have to be set when mesh or sprite is rendered
-        /// </summary>
-        bool drawingSprites;
+        // game thread, takes up to 'max' received buffers, each one has to be released
+        uint drain(packetBuffer** out, uint max)
+        {
+            uint n = 0;
+            while (n < max && this->received.pop(out + n)) n++;
+            return n;
+        }
 
-        void checkhr(HRESULT hr, int line)
+        // any thread, null when the pool is empty
+        packetBuffer* allocate()
         {
-            if (hr == 0) return;
-            char str[128];
-            FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, 0,
-                hr, MAKELANGID(LANG_NEUTRAL, SUBLANG_NEUTRAL),
-                str, 128, 0);
-            fprintf(stderr, str);
+            return this->pool.allocate();
         }
 
-        ID3D11SamplerState* createSampler(TextureFilter mode)
+        // game thread, takes over one reference of 'b', 'ep' is ignored by client
+        bool enqueue(packetBuffer* b, const endpoint* ep)
         {
-            ID3D11SamplerState* sampler;
-            D3D11_SAMPLER_DESC sampDesc;
-            ZeroMemory(&sampDesc, sizeof(sampDesc));
-            sampDesc.Filter = mode == TextureFilter::Point ? D3D11_FILTER_MIN_MAG_MIP_POINT : D3D11_FILTER_MIN_MAG_MIP_LINEAR; // D3D11_FILTER_ANISOTROPIC
-            sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-            sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-            sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-            sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-            //sampDesc.MaxAnisotropy = D3D11_REQ_MAXANISOTROPY;
-            sampDesc.MinLOD = 0;
-            sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-            this->device->CreateSamplerState(&sampDesc, &sampler);
-            return sampler;
+            sendItem item = { b, {} };
+            if (ep) item.ep = *ep;
+            if (this->outgoing.push(item)) return true;
+
+            b->release();
+            return false;
         }
 
-        ID3D11PixelShader* createPixelShaderFromString(const char* str,
-            const char* entryPoint, const char* target)
+        // game thread, same buffer to every endpoint, takes over one reference of 'b'
+        // returns how many sends were queued
+        uint broadcast(packetBuffer* b, const endpoint* eps, uint count)
         {
-            ID3D11PixelShader* result;
-            ID3D10Blob* ps;
-            ID3D10Blob* errorMsg;
-            HRESULT hr = D3DCompile(str, strlen(str), 0, 0, 0, entryPoint, target, 0, 0, &ps, &errorMsg);
-            if (errorMsg)
+            if (count == 0)
             {
-                void* ptr = errorMsg->GetBufferPointer();
-                uint sz = errorMsg->GetBufferSize();
-                byte buffer[1000];
-                memset(buffer, 0, 1000);
-                memcpy(buffer, ptr, sz);
-                fprintf(stderr, "%s\n", buffer);
-                return nullptr;
+                b->release();
+                return 0;
             }
-            else
+
+            b->retain(count - 1);
+            uint queued = 0;
+            for (uint i = 0; i < count; i++) queued += this->enqueue(b, eps + i);
+            return queued;
+        }
+
+        void receiveAll(batch* b, packetBuffer** spare)
+        {
+            while (true)
             {
-                this->checkhr(hr, __LINE__);
+                // point the batch at pooled buffers so the kernel writes into them directly
+                uint ready = 0;
+
+                for (; ready < this->receiveSlots; ready++)
+                {
+                    if (!spare[ready])
+                    {
+                        if (this->pool.available.load(std::memory_order_relaxed) <= this->receiveSlots) break;
+                        spare[ready] = this->pool.allocate();
+                        if (!spare[ready]) break;
+                    }
+
+                    b->data[ready] = spare[ready]->bytes + NET_HEADROOM;
+                }
+
+                // pool is low, datagrams wait in the socket and the kernel drops them if it overflows
+                if (ready == 0) return;
+
+                uint n = this->isClient ? this->cli.receiveBatch(b, ready) : this->srv.receiveBatch(b, ready);
+                long long now = vi::time::nowNs();
+
+                for (uint i = 0; i < n; i++)
+                {
+                    packetBuffer* p = spare[i];
+                    p->timeNs = now;
+                    p->ep = b->endpoints[i];
+                    p->offset = NET_HEADROOM;
+                    p->len = b->lengths[i];
+                    spare[i] = nullptr;
+
+                    if (!this->received.push(p))
+                    {
+                        this->dropped.fetch_add(1, std::memory_order_relaxed);
+                        p->release();
+                    }
+                }
+
+                if (n < ready) return;
             }
-            //D3DCompile
-            hr = this->device->CreatePixelShader(ps->GetBufferPointer(), ps->GetBufferSize(), 0, &result);
-            this->checkhr(hr, __LINE__);
-            ps->Release();
-            return result;
         }
 
-        ID3D11VertexShader* createVertexShaderFromString(const char* str,
-            const char* entryPoint, const char* target, bool setInputLayout)
+        // returns number of datagrams sent, batch points into the buffers being sent
+        uint sendAll(batch* b, packetBuffer** sending)
         {
-            ID3D11VertexShader* result = nullptr;
-            ID3D10Blob* vs;
-            ID3D10Blob* errorMsg;
-            HRESULT hr = D3DCompile(str, strlen(str), 0, 0, 0, entryPoint, target, 0, 0, &vs, &errorMsg);
+            sendItem item;
+            uint total = 0;
 
-            if (errorMsg)
+            while (this->outgoing.pop(&item))
             {
-                void* ptr = errorMsg->GetBufferPointer();
-                uint sz = errorMsg->GetBufferSize();
-                byte buffer[1000];
-                memset(buffer, 0, 1000);
-                memcpy(buffer, ptr, sz);
-                fprintf(stderr, "%s\n", buffer);
-                return nullptr;
+                uint i = b->count++;
+                b->data[i] = item.buffer->getData();
+                b->lengths[i] = item.buffer->len;
+                b->endpoints[i] = item.ep;
+                sending[i] = item.buffer;
+
+                if (b->count == NET_BATCH_SIZE)
+                    total += this->flushAll(b, sending);
             }
-            else
+
+            if (b->count > 0)
+                total += this->flushAll(b, sending);
+
+            return total;
+        }
+
+        // retries a few times when socket buffer is full, what is left is dropped
+        uint flushAll(batch* b, packetBuffer** sending)
+        {
+            uint count = b->count;
+            uint sent = 0;
+
+            for (uint attempt = 0; attempt < 100 && b->count > 0; attempt++)
             {
-                this->checkhr(hr, __LINE__);
+                uint n = this->isClient ? this->cli.flushBatch(b) : this->srv.flushBatch(b);
+                sent += n;
+                if (n == 0) std::this_thread::yield();
             }
 
-            // have to do this only once
-            if (setInputLayout)
+            b->count = 0;
+            for (uint i = 0; i < count; i++) sending[i]->release();
+            return sent;
+        }
+
+        void run()
+        {
+            batch in, out;
+            in.init();
+            out.init();
+            packetBuffer* spare[NET_BATCH_SIZE] = {};
+            packetBuffer* sending[NET_BATCH_SIZE];
+
+            while (this->running.load(std::memory_order_relaxed))
             {
-                //// VERTEX LAYOUT ////
-            //The vertex Structure
-            //The input-layout description
-                D3D11_INPUT_ELEMENT_DESC layout[] =
+                this->receiveAll(&in, spare);
+
+                if (this->sendAll(&out, sending) == 0)
                 {
-                    {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-                    {"TEXCOORD",    0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-                    {"LIGHT",    0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
-                };
-                hr = this->device->CreateInputLayout(layout, 3, vs->GetBufferPointer(),
-                    vs->GetBufferSize(), &this->inputLayout);
-                this->checkhr(hr, __LINE__);
+                    if (this->isClient) this->cli.wait(this->idleWaitMs);
+                    else this->srv.wait(this->idleWaitMs);
+                }
+            }
 
-                //Set the Input Layout
-                this->context->IASetInputLayout(this->inputLayout);
+            for (uint i = 0; i < NET_BATCH_SIZE; i++)
+                if (spare[i]) spare[i]->release();
+
+            in.destroy();
+            out.destroy();
+        }
+    };
+
+    // address and port in one word, key of connectionTable
+    unsigned long long getEndpointKey(const endpoint* ep)
+    {
+        return (unsigned long long)ep->address.sin_addr.s_addr << 16 | ep->address.sin_port;
+    }
+
+    const uint NET_CONNECTION_QUEUE = 64;
+    // timeouts are rounded up to whole ticks, wheel covers slots * tick and longer ones wait for later rounds
+    const uint NET_WHEEL_SLOTS = 256;
+    const uint NET_WHEEL_TICK_MS = 50;
+
+    struct connectionStats
+    {
+        unsigned long long packetsReceived;
+        unsigned long long packetsSent;
+        unsigned long long bytesReceived;
+        unsigned long long bytesSent;
+        // sends that didn't fit the send queue or the network thread
+        unsigned long long packetsDropped;
+        // filled by whatever protocol runs on top
+        unsigned long long packetsLost;
+        unsigned long long resends;
+    };
+
+    // state of one peer, lives in connectionTable and is reused after disconnect
+    struct connection
+    {
+        endpoint ep;
+        unsigned long long key;
+        // index in connectionTable, stable while connected, for parallel arrays of game state
+        uint id;
+        bool isConnected;
+        // next sequence number to send and newest received
+        ushort localSequence;
+        ushort remoteSequence;
+        // bit n set when remoteSequence - 1 - n was received
+        uint ackBits;
+        // smoothed round trip time and its variation
+        float rttMs;
+        float rttVarMs;
+        long long connectedNs;
+        long long lastReceivedNs;
+        long long lastSentNs;
+        connectionStats stats;
+        // outgoing buffers waiting for flush, each holds a reference
+        packetBuffer* sendQueue[NET_CONNECTION_QUEUE];
+        uint sendHead;
+        uint sendCount;
+        // timing wheel links, indexes of connections
+        uint wheelPrev;
+        uint wheelNext;
+        uint wheelSlot;
+        unsigned long long deadlineTick;
+        // position in connectionTable active list
+        uint activeIndex;
+
+        // takes over one reference of 'b', false and released when the queue is full
+        bool queue(packetBuffer* b)
+        {
+            if (this->sendCount == NET_CONNECTION_QUEUE)
+            {
+                this->stats.packetsDropped++;
+                b->release();
+                return false;
+            }
+
+            this->sendQueue[(this->sendHead + this->sendCount) % NET_CONNECTION_QUEUE] = b;
+            this->sendCount++;
+            return true;
+        }
+
+        packetBuffer* dequeue()
+        {
+            if (this->sendCount == 0) return nullptr;
+
+            packetBuffer* b = this->sendQueue[this->sendHead];
+            this->sendHead = (this->sendHead + 1) % NET_CONNECTION_QUEUE;
+            this->sendCount--;
+            return b;
+        }
+
+        // same smoothing as TCP, first sample sets it directly
+        void addRttSample(float ms)
+        {
+            if (this->rttMs == 0)
+            {
+                this->rttMs = ms;
+                this->rttVarMs = ms * 0.5f;
+                return;
             }
 
-            hr = this->device->CreateVertexShader(vs->GetBufferPointer(), vs->GetBufferSize(), 0, &result);
-            this->checkhr(hr, __LINE__);
-            vs->Release();
-            return result;
+            float diff = ms - this->rttMs;
+            this->rttVarMs += ((diff < 0 ? -diff : diff) - this->rttVarMs) * 0.25f;
+            this->rttMs += diff * 0.125f;
         }
+    };
 
-        void init(rendererInfo* info)
+    // Connections keyed by address and port in an open addressing hash table, so finding
+    // the sender of a datagram is one probe in the common case instead of a scan over clients.
+    // Timeouts are kept in a timing wheel, receive reschedules in O(1) and expire only looks
+    // at the slots that passed. Connection storage is allocated once in init.
+    struct connectionTable
+    {
+        connection* connections;
+        uint capacity;
+        // hash slots hold key and connection index, linear probing, deletion shifts back so no tombstones
+        unsigned long long* keys;
+        uint* indexes;
+        uint mask;
+        // free connection indexes
+        uint* freeList;
+        uint freeCount;
+        // connected indexes in no particular order, for iteration
+        uint* active;
+        uint activeCount;
+        uint wheel[NET_WHEEL_SLOTS];
+        unsigned long long currentTick;
+        uint timeoutTicks;
+
+        static const uint NONE = 0xffffffff;
+
+        void init(uint capacity, uint timeoutMs)
         {
-            HRESULT hr = 0;
-            this->drawingSprites = true;
-            this->window = info->wnd;
-            this->fullscreen = false;
-            //assign global variable
-            memcpy(this->backBufferColor, info->clearColor, sizeof(float) * 4);
+            uint slots = 1;
+            while (slots < capacity * 2) slots <<= 1;
 
-            // camera
-            this->camera3Dptr = nullptr;
-            this->camera.aspectRatio = this->window->width / (float)this->window->height;
-            this->camera.rotation = 0;
-            this->camera.scale = 1;
-            this->camera.x = 0;
-            this->camera.y = 0;
+            this->capacity = capacity;
+            this->connections = (connection*)calloc(capacity, sizeof(connection));
+            this->keys = (unsigned long long*)malloc(slots * sizeof(unsigned long long));
+            this->indexes = (uint*)malloc(slots * sizeof(uint));
+            this->mask = slots - 1;
+            this->freeList = (uint*)malloc(capacity * sizeof(uint));
+            this->active = (uint*)malloc(capacity * sizeof(uint));
+            this->activeCount = 0;
+            this->freeCount = capacity;
+            this->currentTick = 0;
+            this->timeoutTicks = (timeoutMs + NET_WHEEL_TICK_MS - 1) / NET_WHEEL_TICK_MS;
+            if (this->timeoutTicks == 0) this->timeoutTicks = 1;
+
+            for (uint i = 0; i < slots; i++) this->indexes[i] = NONE;
+            // lowest index is taken first
+            for (uint i = 0; i < capacity; i++) this->freeList[i] = capacity - 1 - i;
+            for (uint i = 0; i < NET_WHEEL_SLOTS; i++) this->wheel[i] = NONE;
+        }
 
-            //// *********** PIPELINE SETUP STARTS HERE *********** ////
-            // create a struct to hold information about the swap chain
-            DXGI_SWAP_CHAIN_DESC scd;
-            ZeroMemory(&scd, sizeof(DXGI_SWAP_CHAIN_DESC));
-            scd.BufferCount = 1;                                    // one back buffer
-            scd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;     // use 32-bit color
-            scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;      // how swap chain is to be used
-            scd.OutputWindow = info->wnd->handle;                   // the window to be used
-            scd.SampleDesc.Quality = 0;
-            scd.SampleDesc.Count = 1;                               // no anti aliasing
-            scd.Windowed = TRUE;                                    // windowed/full-screen mode
-            //scd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH;   // alternative fullscreen mode
+        // releases what is still queued
+        void destroy()
+        {
+            while (this->activeCount > 0)
+                this->disconnect(&this->connections[this->active[0]]);
+
+            ::free(this->connections);
+            ::free(this->keys);
+            ::free(this->indexes);
+            ::free(this->freeList);
+            ::free(this->active);
+            this->connections = nullptr;
+        }
 
-            UINT creationFlags = D3D11_CREATE_DEVICE_SINGLETHREADED;
+        uint getSlot(unsigned long long key)
+        {
+            // fibonacci hashing spreads sequential addresses and ports
+            return (uint)((key * 0x9E3779B97F4A7C15ull) >> 32) & this->mask;
+        }
 
-            ////    DEVICE, DEVICE CONTEXT AND SWAP CHAIN    ////
-            hr = D3D11CreateDeviceAndSwapChain(NULL,
-                D3D_DRIVER_TYPE_HARDWARE, NULL, creationFlags, NULL, NULL,
-                D3D11_SDK_VERSION, &scd, &this->swapChain, &this->device, NULL,
-                &this->context);
-            this->checkhr(hr, __LINE__);
+        // null when 'ep' is not connected
+        connection* find(const endpoint* ep)
+        {
+            unsigned long long key = getEndpointKey(ep);
 
-            ////    BACK BUFFER AS RENDER TARGET, DEPTH STENCIL   ////
-            // get the address of the back buffer
-            ID3D11Texture2D* buf;
-            this->swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&buf);
-            // use the back buffer address to create the render target
-            hr = this->device->CreateRenderTargetView(buf, NULL, &this->backBuffer);
-            this->checkhr(hr, __LINE__);
-            buf->Release();
+            for (uint i = this->getSlot(key); this->indexes[i] != NONE; i = (i + 1) & this->mask)
+                if (this->keys[i] == key) return &this->connections[this->indexes[i]];
 
-            //Describe our Depth/Stencil Buffer and View
-            D3D11_TEXTURE2D_DESC depthStencilDesc;
-            depthStencilDesc.Width = info->wnd->width;
-            depthStencilDesc.Height = info->wnd->height;
-            depthStencilDesc.MipLevels = 1;
-            depthStencilDesc.ArraySize = 1;
-            depthStencilDesc.Format = DXGI_FORMAT_D32_FLOAT;
-            depthStencilDesc.SampleDesc.Count = 1;
-            depthStencilDesc.SampleDesc.Quality = 0;
-            depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
-            depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-            depthStencilDesc.CPUAccessFlags = 0;
-            depthStencilDesc.MiscFlags = 0;
+            return nullptr;
+        }
 
-            hr = this->device->CreateTexture2D(&depthStencilDesc, NULL, &this->depthStencilBuffer);
-            this->checkhr(hr, __LINE__);
-            hr = this->device->CreateDepthStencilView(this->depthStencilBuffer, NULL, &this->depthStencilView);
-            this->checkhr(hr, __LINE__);
+        connection* get(uint id)
+        {
+            return this->connections[id].isConnected ? &this->connections[id] : nullptr;
+        }
 
-            ////   VIEWPORT    ////
-            // Set the viewport
-            D3D11_VIEWPORT viewport;
-            ZeroMemory(&viewport, sizeof(D3D11_VIEWPORT));
-            viewport.TopLeftX = 0;
-            viewport.TopLeftY = 0;
-            viewport.Width = (FLOAT)info->wnd->width;
-            viewport.Height = (FLOAT)info->wnd->height;
-            viewport.MinDepth = 0.0f;
-            viewport.MaxDepth = 1.0f;
-            this->context->RSSetViewports(1, &viewport);
+        // existing connection of 'ep' or a new one, null when table is full
+        connection* connect(const endpoint* ep, long long nowNs)
+        {
+            unsigned long long key = getEndpointKey(ep);
+            uint i = this->getSlot(key);
+
+            for (; this->indexes[i] != NONE; i = (i + 1) & this->mask)
+                if (this->keys[i] == key) return &this->connections[this->indexes[i]];
+
+            if (this->freeCount == 0) return nullptr;
+
+            uint id = this->freeList[--this->freeCount];
+            this->keys[i] = key;
+            this->indexes[i] = id;
+
+            connection* c = &this->connections[id];
+            memset(c, 0, sizeof(connection));
+            c->ep = *ep;
+            c->ep.isConnected = true;
+            c->key = key;
+            c->id = id;
+            c->isConnected = true;
+            c->connectedNs = nowNs;
+            c->lastReceivedNs = nowNs;
+            c->activeIndex = this->activeCount;
+            this->active[this->activeCount++] = id;
+            this->schedule(c);
+            return c;
+        }
 
-            ////    BLEND STATE  ////
-            D3D11_BLEND_DESC blendDesc;
-            ZeroMemory(&blendDesc, sizeof(blendDesc));
-            D3D11_RENDER_TARGET_BLEND_DESC rtbd;
-            ZeroMemory(&rtbd, sizeof(rtbd));
-            rtbd.BlendEnable = true;
-            rtbd.SrcBlend = D3D11_BLEND_SRC_ALPHA;
-            rtbd.DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-            rtbd.BlendOp = D3D11_BLEND_OP_ADD;
-            rtbd.SrcBlendAlpha = D3D11_BLEND_ONE;
-            rtbd.DestBlendAlpha = D3D11_BLEND_ZERO;
-            rtbd.BlendOpAlpha = D3D11_BLEND_OP_ADD;
-            rtbd.RenderTargetWriteMask = D3D10_COLOR_WRITE_ENABLE_ALL;
-            //blendDesc.AlphaToCoverageEnable = false;
-            blendDesc.RenderTarget[0] = rtbd;
-            hr = this->device->CreateBlendState(&blendDesc, &this->blendState);
+        void disconnect(connection* c)
+        {
+            if (!c->isConnected) return;
 
-            ////    VS and PS    ////
-            this->defaultVS = this->createVertexShaderFromString(rc_VertexShader, "main", "vs_5_0", false);
-            this->currentVS = this->defaultVS;
-            this->defaultMeshVS = this->createVertexShaderFromString(rc_VertexShaderMesh, "main", "vs_5_0", true);
-            this->defaultPS = this->createPixelShaderFromString(rc_PixelShader, "main", "ps_5_0");
+            uint i = this->getSlot(c->key);
+            while (this->keys[i] != c->key || this->indexes[i] != c->id) i = (i + 1) & this->mask;
+            this->indexes[i] = NONE;
 
-            D3D11_BUFFER_DESC cbbd;
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(sprite);
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVS);
+            // shift following entries back into the hole if it's on their probe path
+            for (uint j = (i + 1) & this->mask; this->indexes[j] != NONE; j = (j + 1) & this->mask)
+            {
+                uint home = this->getSlot(this->keys[j]);
 
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = psBufferSize;
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferPS);
-            this->context->PSSetConstantBuffers(0, 1, &this->cbufferPS);
+                if (((j - home) & this->mask) >= ((j - i) & this->mask))
+                {
+                    this->keys[i] = this->keys[j];
+                    this->indexes[i] = this->indexes[j];
+                    this->indexes[j] = NONE;
+                    i = j;
+                }
+            }
 
-            // vertex buffer for camera also UpdateSubresource
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(camera);
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);
+            this->unschedule(c);
 
-            // vs cbuffer for world view proj
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = 64;
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->world);
+            uint last = this->active[--this->activeCount];
+            this->active[c->activeIndex] = last;
+            this->connections[last].activeIndex = c->activeIndex;
 
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(camera3D);
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->view);
+            while (packetBuffer* b = c->dequeue()) b->release();
 
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(float) * 16;
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->transform);
+            c->isConnected = false;
+            c->ep.isConnected = false;
+            this->freeList[this->freeCount++] = c->id;
+        }
 
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DYNAMIC;
-            cbbd.ByteWidth = sizeof(vertex) * 15000;
-            cbbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-            cbbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-            this->device->CreateBuffer(&cbbd, NULL, &this->dynamicVertexBuffer);
+        // call for every datagram from 'c', pushes its timeout back
+        void received(connection* c, uint len, long long nowNs)
+        {
+            c->lastReceivedNs = nowNs;
+            c->stats.packetsReceived++;
+            c->stats.bytesReceived += len;
+            this->unschedule(c);
+            this->schedule(c);
+        }
 
-            /*ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(camera);
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);
+        // disconnects connections silent for the timeout and writes them to 'expired',
+        // they are readable until the next connect, returns how many
+        // when more than 'max' expire the rest is reported by the next call
+        uint expire(long long nowNs, connection** expired, uint max)
+        {
+            unsigned long long tick = getTick(nowNs);
+            if (this->currentTick == 0) this->currentTick = tick;
+            uint count = 0;
 
-            ZeroMemory(&cbbd, sizeof(D3D11_BUFFER_DESC));
-            cbbd.Usage = D3D11_USAGE_DEFAULT;
-            cbbd.ByteWidth = sizeof(camera);
-            cbbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-            this->device->CreateBuffer(&cbbd, NULL, &this->cbufferVScamera);*/
+            // after a long pause every slot is visited once
+            if (tick - this->currentTick > NET_WHEEL_SLOTS) this->currentTick = tick - NET_WHEEL_SLOTS;
 
-            D3D11_RASTERIZER_DESC rd;
-            ZeroMemory(&rd, sizeof(rd));
-            rd.FillMode = D3D11_FILL_WIREFRAME;
-            rd.CullMode = D3D11_CULL_NONE;
-            hr = this->device->CreateRasterizerState(&rd, &this->wireframe);
-            this->checkhr(hr, __LINE__);
-            rd.FillMode = D3D11_FILL_SOLID;
-            rd.CullMode = D3D11_CULL_FRONT;
-            hr = this->device->CreateRasterizerState(&rd, &this->solid);
-            this->checkhr(hr, __LINE__);
+            while (this->currentTick < tick)
+            {
+                uint slot = (uint)(this->currentTick % NET_WHEEL_SLOTS);
+                uint i = this->wheel[slot];
 
-            this->context->OMSetRenderTargets(1, &this->backBuffer, this->depthStencilView);
-            this->context->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            this->context->RSSetState(this->solid);
-            this->context->PSSetShader(this->defaultPS, 0, 0);
+                while (i != NONE)
+                {
+                    connection* c = &this->connections[i];
+                    i = c->wheelNext;
 
-            this->point = this->createSampler(TextureFilter::Point);
-            this->linear = this->createSampler(TextureFilter::Linear);
-            this->context->PSSetSamplers(0, 1, &this->point);
+                    // later round of the wheel
+                    if (c->deadlineTick >= tick) continue;
 
-            // default is drawing sprites so set them
-            this->context->VSSetShader(this->defaultVS, 0, 0);
-            this->context->VSSetConstantBuffers(0, 1, &this->cbufferVS);
-            this->context->VSSetConstantBuffers(1, 1, &this->cbufferVScamera);
+                    if (count == max) return count;
 
-            //// *********** PIPELINE SETUP ENDS HERE *********** ////
+                    this->disconnect(c);
+                    expired[count++] = c;
+                }
+
+                this->currentTick++;
+            }
+
+            return count;
         }
 
-        void destroy()
+        static unsigned long long getTick(long long nowNs)
         {
-            this->blendState->Release();
-            this->blendState = nullptr;
-            this->dynamicVertexBuffer->Release();
-            this->dynamicVertexBuffer = nullptr;
-            this->world->Release();
-            this->world = nullptr;
-            this->view->Release();
-            this->view = nullptr;
-            this->transform->Release();
-            this->transform = nullptr;
-            this->inputLayout->Release();
-            this->inputLayout = nullptr;
-            this->cbufferVS->Release();
-            this->cbufferVS = nullptr;
-            this->cbufferVScamera->Release();
-            this->cbufferVScamera = nullptr;
-            this->point->Release();
-            this->point = nullptr;
-            this->linear->Release();
-            this->linear = nullptr;
-            this->wireframe->Release();
-            this->wireframe = nullptr;
-            this->solid->Release();
-            this->solid = nullptr;
-            this->cbufferPS->Release();
-            this->cbufferPS = nullptr;
-            this->defaultPS->Release();
-            this->defaultPS = nullptr;
-            this->defaultVS->Release();
-            this->defaultVS = nullptr;
-            this->depthStencilView->Release();
-            this->depthStencilView = nullptr;
-            this->depthStencilBuffer->Release();
-            this->depthStencilBuffer = nullptr;
-            this->backBuffer->Release();
-            this->backBuffer = nullptr;
-            this->swapChain->Release();
-            this->swapChain = nullptr;
-            this->context->Release();
-            this->context = nullptr;
-            this->device->Release();
-            this->device = nullptr;
+            return (unsigned long long)(nowNs / 1000000) / NET_WHEEL_TICK_MS;
+        }
+
+        // moves queued buffers of every connection to the network thread
+        // returns number of datagrams handed over
+        uint flush(netThread* t, long long nowNs)
+        {
+            uint total = 0;
+
+            for (uint a = 0; a < this->activeCount; a++)
+            {
+                connection* c = &this->connections[this->active[a]];
+
+                while (packetBuffer* b = c->dequeue())
+                {
+                    uint len = b->len;
+
+                    if (!t->enqueue(b, &c->ep))
+                    {
+                        c->stats.packetsDropped++;
+                        continue;
+                    }
+
+                    c->stats.packetsSent++;
+                    c->stats.bytesSent += len;
+                    c->lastSentNs = nowNs;
+                    total++;
+                }
+            }
+
+            return total;
         }
 
-        // Create texture where pixels are uncompressed, not encoded, 4 bytes per pixel formatted RGBA, stored lineary.
-        // insert texture to internal storage
-        void createTextureFromBytes(texture* t, byte* data, uint width, uint height)
+        void schedule(connection* c)
         {
-            t->width = width;
-            t->height = height;
+            if (this->currentTick == 0) this->currentTick = getTick(c->lastReceivedNs);
+            c->deadlineTick = getTick(c->lastReceivedNs) + this->timeoutTicks;
+            if (c->deadlineTick < this->currentTick) c->deadlineTick = this->currentTick;
+
+            uint slot = (uint)(c->deadlineTick % NET_WHEEL_SLOTS);
+            c->wheelSlot = slot;
+            c->wheelPrev = NONE;
+            c->wheelNext = this->wheel[slot];
+            if (c->wheelNext != NONE) this->connections[c->wheelNext].wheelPrev = c->id;
+            this->wheel[slot] = c->id;
+        }
 
-            ID3D11Texture2D* tex = nullptr;
-            D3D11_TEXTURE2D_DESC desc;
-            D3D11_SUBRESOURCE_DATA sub;
+        void unschedule(connection* c)
+        {
+            if (c->wheelPrev != NONE) this->connections[c->wheelPrev].wheelNext = c->wheelNext;
+            else this->wheel[c->wheelSlot] = c->wheelNext;
 
-            sub.pSysMem = (void*)data;
-            sub.SysMemPitch = (UINT)width * 4;
-            sub.SysMemSlicePitch = (UINT)height * (UINT)width * 4;
+            if (c->wheelNext != NONE) this->connections[c->wheelNext].wheelPrev = c->wheelPrev;
+        }
+    };
 
-            desc.Width = (UINT)width;
-            desc.Height = (UINT)height;
-            desc.MipLevels = 1;
-            desc.ArraySize = 1;
+    const uint NET_CHANNELS = 4;
+    // reliable messages in flight per channel, also how far ahead out of order ones are held
+    const uint NET_RELIABLE_WINDOW = 64;
+    // sent packets remembered until acked, older acks are ignored
+    const uint NET_ACK_WINDOW = 256;
+    // reliable messages one datagram can carry
+    const uint NET_PACKET_MESSAGES = 32;
+    // sequence, ack, ack bits, flags
+    const uint NET_PACKET_HEADER = 9;
+    // channel, id, length
+    const uint NET_MESSAGE_HEADER = 5;
+    // index and count after the message header of a fragment
+    const uint NET_FRAGMENT_HEADER = 2;
+    // high bit of the channel byte marks a fragment
+    const byte NET_FRAGMENT_FLAG = 0x80;
+    const uint NET_MESSAGE_SIZE = NET_PACKET_SIZE - NET_PACKET_HEADER - NET_MESSAGE_HEADER;
+    // bigger messages are split in fragments of this size, each one in its own datagram
+    const uint NET_FRAGMENT_SIZE = NET_MESSAGE_SIZE - NET_FRAGMENT_HEADER;
+    const uint NET_MAX_FRAGMENTS = 32;
+    const uint NET_MAX_MESSAGE_SIZE = NET_MAX_FRAGMENTS * NET_FRAGMENT_SIZE;
+    // resend timeout before there is an RTT sample, and its bounds
+    const float NET_RESEND_MS = 100;
+    const float NET_RESEND_MIN_MS = 20;
+    const float NET_RESEND_MAX_MS = 1000;
+
+    enum class channelType : byte
+    {
+        // may be lost, duplicated or come out of order
+        Unreliable,
+        // may be lost, older than the newest received is dropped
+        UnreliableSequenced,
+        // resent until acked, delivered once and in order
+        ReliableOrdered
+    };
 
-            desc.SampleDesc.Count = 1;
-            desc.SampleDesc.Quality = 0;
-            desc.Usage = D3D11_USAGE_DEFAULT;
-            desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-            desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    // true when 'a' is newer than 'b', works across wrap around
+    bool sequenceGreater(ushort a, ushort b)
+    {
+        return (short)(a - b) > 0;
+    }
 
-            desc.CPUAccessFlags = 0;
-            desc.MiscFlags = 0;
+    // received message, 'data' points into 'buffer' which holds a reference for it
+    struct message
+    {
+        packetBuffer* buffer;
+        const byte* data;
+        uint len;
+        byte channel;
+        ushort id;
+    };
 
-            HRESULT hr = this->device->CreateTexture2D(&desc, &sub, &tex);
-            this->checkhr(hr, __LINE__);
+    struct sentPacket
+    {
+        long long sendNs;
+        ushort sequence;
+        bool used;
+        bool acked;
+        byte count;
+        // reliable messages it carried
+        byte channels[NET_PACKET_MESSAGES];
+        ushort ids[NET_PACKET_MESSAGES];
+    };
 
-            D3D11_TEXTURE2D_DESC desc2;
-            tex->GetDesc(&desc2);
-            ID3D11ShaderResourceView* srv = nullptr;
-            hr = this->device->CreateShaderResourceView(tex, 0, &srv);
-            this->checkhr(hr, __LINE__);
-            tex->Release();
+    // sender side, payload waiting for ack
+    struct unackedMessage
+    {
+        packetBuffer* buffer;
+        long long lastSentNs;
+        ushort id;
+        bool used;
+        // fragmentCount is 0 for a whole message
+        byte fragmentIndex;
+        byte fragmentCount;
+    };
 
-            t->shaderResource = srv;
-        }
+    // receiver side, came ahead of a missing one
+    struct pendingMessage
+    {
+        packetBuffer* buffer;
+        const byte* data;
+        ushort len;
+        ushort id;
+        bool used;
+        byte fragmentIndex;
+        byte fragmentCount;
+    };
 
-        // Create texture from file in memory.
-        // Difference between this and 'createTextureFromFile' is that file is in memory.
-        // It's useful because you can have PNG or other encoded image in memory
-        // and this can create texture from that. Supports lots of formats.
-        void createTextureFromInMemoryFile(texture* t, byte* file, int len)
+    // fragments of one message being copied together into a buffer of the message pool
+    struct reassembly
+    {
+        packetBuffer* buffer;
+        // id of the first fragment, every fragment has its own id
+        ushort id;
+        byte count;
+        byte received;
+        unsigned long long mask;
+    };
+
+    struct reliableChannel
+    {
+        channelType type;
+        // next id to send
+        ushort sendId;
+        // next id to deliver, newest + 1 for sequenced
+        ushort receiveId;
+        // send fails when sendId is a window ahead of it
+        ushort oldestUnacked;
+        unackedMessage unacked[NET_RELIABLE_WINDOW];
+        pendingMessage pending[NET_RELIABLE_WINDOW];
+        reassembly assembly;
+    };
+
+    // Optional reliability over a connection. Every datagram has a packet sequence and acks the
+    // newest received one plus 32 before it in a bitfield, so one lost ack costs nothing.
+    // Messages sent during a tick are packed together into as few datagrams as fit the MTU when
+    // update closes them, messages over NET_MESSAGE_SIZE go as fragments and are put back
+    // together in a buffer from 'messagePool' on receive.
+    // Reliable messages stay in pooled buffers until a packet carrying them is acked and only
+    // those are resent, after RTT + 4 * variation. No channel waits for another one.
+    // Uses sequence, ack and RTT fields of 'connection', a client can use a zeroed connection.
+    // Keep one per connection, e.g. in an array indexed by connection id.
+    struct reliability
+    {
+        packetPool* pool;
+        // NET_MAX_MESSAGE_SIZE buffers for reassembly, without a free one a fragmented message is
+        // dropped on unreliable channels and waits on reliable ones, which stall until one is released
+        packetPool* messagePool;
+        reliableChannel channels[NET_CHANNELS];
+        uint channelCount;
+        sentPacket sent[NET_ACK_WINDOW];
+        bool receivedAny;
+        // something came since the last datagram went out, update sends a bare ack
+        bool ackPending;
+        // datagram being filled, its header is written when it's closed
+        packetBuffer* open;
+        sentPacket openRecord;
+
+        // false when 'messagePool' buffers are smaller than NET_MAX_MESSAGE_SIZE, it's not used then
+        bool init(packetPool* pool, packetPool* messagePool, const channelType* types, uint count)
         {
-            int x = -1, y = -1, n = -1;
-            const int components = 4; // components means how many elements from 'RGBA'
-            // you want to return, I want 4 (RGBA) even in not all 4 are present
-            byte* data = stbi_load_from_memory(file, len, &x, &y, &n, components);
+            memset(this, 0, sizeof(reliability));
+            this->pool = pool;
+            this->messagePool = messagePool;
+            this->channelCount = count < NET_CHANNELS ? count : NET_CHANNELS;
+            for (uint i = 0; i < this->channelCount; i++) this->channels[i].type = types[i];
 
-#ifdef VI_VALIDATE
-            if (!data)
+            if (messagePool && messagePool->capacity > 0 && messagePool->buffers[0].size < NET_HEADROOM + NET_MAX_MESSAGE_SIZE)
             {
-                fprintf(stderr, "createTexture could not process in memory file\n");
-                exit(1);
-            }
+#ifdef VI_VALIDATE
+                fprintf(stderr, "reliability: message pool buffers hold %u bytes, %u needed\n",
+                    messagePool->buffers[0].size - NET_HEADROOM, NET_MAX_MESSAGE_SIZE);
 #endif
+                this->messagePool = nullptr;
+                return false;
+            }
 
-            this->createTextureFromBytes(t, data, x, y);
-            stbi_image_free(data);
+            return true;
         }
 
-        // Create texture from file on disk. Supports lots of formats.
-        void createTextureFromFile(texture* t, const char* filename)
+        // releases buffers still waiting for ack, delivery or update
+        void destroy()
         {
-            int x = -1, y = -1, n = -1;
-            const int components = 4; // components means how many elements from 'RGBA'
-            // you want to return, I want 4 (RGBA) even in not all 4 are present
-            byte* data = stbi_load(filename, &x, &y, &n, components);
-
-#ifdef VI_VALIDATE
-            if (!data)
+            for (uint i = 0; i < this->channelCount; i++)
             {
-                fprintf(stderr, "createTexture could not open the file %s\n", filename);
-                exit(1);
-            }
-#endif
+                reliableChannel* ch = &this->channels[i];
 
-            this->createTextureFromBytes(t, data, x, y);
-            stbi_image_free(data);
-        }
+                for (uint j = 0; j < NET_RELIABLE_WINDOW; j++)
+                {
+                    if (ch->unacked[j].used) ch->unacked[j].buffer->release();
+                    if (ch->pending[j].used) ch->pending[j].buffer->release();
+                    ch->unacked[j].used = false;
+                    ch->pending[j].used = false;
+                }
 
-        void destroyTexture(texture* t)
-        {
-            t->shaderResource->Release();
-            t->shaderResource = nullptr;
-        }
+                if (ch->assembly.buffer) ch->assembly.buffer->release();
+                ch->assembly.buffer = nullptr;
+            }
 
-        /// <summary>
-        /// this can be used to start a new layer
-        /// </summary>
-        void clearDepth()
-        {
-            this->context->ClearDepthStencilView(this->depthStencilView,
-                D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+            if (this->open) this->open->release();
+            this->open = nullptr;
         }
 
-        void beginScene()
+        float getResendMs(const connection* c)
         {
-            this->context->ClearRenderTargetView(this->backBuffer, this->backBufferColor);
-            this->context->ClearDepthStencilView(this->depthStencilView,
-                D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-            // update camera only once per frame
-            this->context->UpdateSubresource(this->cbufferVScamera, 0, NULL, &this->camera, 0, 0);
-            if (this->camera3Dptr)
-                this->context->UpdateSubresource(this->view, 0, NULL, this->camera3Dptr, 0, 0);
+            if (c->rttMs == 0) return NET_RESEND_MS;
+
+            float ms = c->rttMs + 4 * c->rttVarMs;
+            return ms < NET_RESEND_MIN_MS ? NET_RESEND_MIN_MS : ms > NET_RESEND_MAX_MS ? NET_RESEND_MAX_MS : ms;
         }
 
-        void updateCamera(gl::camera* c)
+        // writes the packet header with the newest acks and queues the open datagram on 'c'
+        void closePacket(connection* c, long long nowNs)
         {
-            this->context->UpdateSubresource(this->cbufferVScamera, 0, NULL, c, 0, 0);
+            if (!this->open) return;
+
+            ushort sequence = c->localSequence++;
+            sentPacket* s = &this->sent[sequence % NET_ACK_WINDOW];
+            if (s->used && !s->acked) c->stats.packetsLost++;
+
+            *s = this->openRecord;
+            s->sendNs = nowNs;
+            s->sequence = sequence;
+            s->used = true;
+            s->acked = false;
+
+            byte* h = this->open->getData();
+            memcpy(h, &sequence, 2);
+            memcpy(h + 2, &c->remoteSequence, 2);
+            memcpy(h + 4, &c->ackBits, 4);
+            h[8] = this->receivedAny ? 1 : 0;
+
+            c->queue(this->open);
+            this->open = nullptr;
+            this->ackPending = false;
         }
 
-        void drawSprite(sprite* s)
+        // makes sure the open datagram has room for 'size' more bytes, false when the pool is empty
+        bool reserve(connection* c, uint size, bool reliable, long long nowNs)
         {
-            if (s->s1.nodraw) return;
+            if (this->open && (this->open->len + size > NET_PACKET_SIZE
+                || (reliable && this->openRecord.count == NET_PACKET_MESSAGES)))
+                this->closePacket(c, nowNs);
 
-            if (!this->drawingSprites)
+            if (!this->open)
             {
-                this->drawingSprites = true;
-                this->context->VSSetShader(this->currentVS, 0, 0);
-                this->context->VSSetConstantBuffers(0, 1, &this->cbufferVS);
-                this->context->VSSetConstantBuffers(1, 1, &this->cbufferVScamera);
+                this->open = this->pool->allocate();
+                if (!this->open) return false;
+
+                this->open->append(NET_PACKET_HEADER);
+                this->openRecord.count = 0;
             }
 
-            if (s->s1.t) this->context->PSSetShaderResources(0, 1, &s->s1.t->shaderResource);
-            s->s1.notexture = !s->s1.t;
-            this->context->UpdateSubresource(this->cbufferVS, 0, NULL, s, 0, 0);
-            this->context->UpdateSubresource(this->cbufferPS, 0, 0, &s->s2.flags, 0, 0);
-            this->context->Draw(6, 0);
+            return true;
         }
 
-        /// <summary>
-        /// use 'line' component of 'sprite';
-        /// only static line at this point;
-        /// line cannot be scaled, moved or rotated;
-        /// position of end points still exists in world space so it's affected by camera scale and pos
-        /// REMEMBER TO SET WIREFRAME
-        /// </summary>
-        void drawLine(sprite* s)
+        // appends a message or fragment to the open datagram, false when the pool is empty
+        bool write(connection* c, byte channel, ushort id, byte index, byte count, const byte* data, uint len, bool reliable, long long nowNs)
         {
-            if (!this->drawingSprites)
+            uint header = NET_MESSAGE_HEADER + (count ? NET_FRAGMENT_HEADER : 0);
+            if (!this->reserve(c, header + len, reliable, nowNs)) return false;
+
+            byte* m = this->open->append(header + len);
+            ushort len16 = (ushort)len;
+            m[0] = count ? channel | NET_FRAGMENT_FLAG : channel;
+            memcpy(m + 1, &id, 2);
+            memcpy(m + 3, &len16, 2);
+
+            if (count)
             {
-                this->drawingSprites = true;
-                this->context->VSSetShader(this->currentVS, 0, 0);
-                this->context->VSSetConstantBuffers(0, 1, &this->cbufferVS);
-                this->context->VSSetConstantBuffers(1, 1, &this->cbufferVScamera);
+                m[5] = index;
+                m[6] = count;
             }
 
-            // 4 uints because min size is 16 bytes
-            uint flags[4] = { 2 }; // notexture flag on
-            s->s1.z -= 1.0f;
-            this->context->UpdateSubresource(this->cbufferVS, 0, NULL, s, 0, 0);
-            s->s1.z += 1.0f;
-            this->context->UpdateSubresource(this->cbufferPS, 0, 0, &flags, 0, 0);
+            memcpy(m + header, data, len);
+
+            if (reliable)
+            {
+                sentPacket* s = &this->openRecord;
+                s->channels[s->count] = channel;
+                s->ids[s->count] = id;
+                s->count++;
+            }
 
-            this->context->Draw(3, 0);
+            return true;
         }
 
-        void drawMesh(mesh* m, float* transform = nullptr)
+        // packs 'data' into the open datagram, it goes out with the next update
+        // over NET_MESSAGE_SIZE it's split in fragments, each one takes an id and a reliable window slot
+        // false when it's too big, the pool is empty or the reliable window is full
+        bool send(connection* c, byte channel, const byte* data, uint len, long long nowNs)
         {
-            UINT stride = sizeof(vertex);
-            UINT offset = 0;
-            this->context->IASetVertexBuffers(0, 1, &m->vertexBuffer, &stride, &offset);
-
-            if (this->drawingSprites)
+            if (channel >= this->channelCount || len > NET_MAX_MESSAGE_SIZE)
             {
-                this->drawingSprites = false;
-                this->context->VSSetShader(this->defaultMeshVS, 0, 0);
-                this->context->VSSetConstantBuffers(0, 1, &this->world);
-                this->context->VSSetConstantBuffers(1, 1, &this->view);
-                this->context->VSSetConstantBuffers(2, 1, &this->transform);
+#ifdef VI_VALIDATE
+                fprintf(stderr, "reliability send: channel %u or size %u out of range\n", channel, len);
+#endif
+                return false;
             }
 
-            if (m->t)
-                this->context->PSSetShaderResources(0, 1, &m->t->shaderResource);
-
-            int psdata[] = { !m->t,0,0,0 };
-            this->context->UpdateSubresource(this->cbufferPS, 0, 0, psdata, 0, 0);
+            reliableChannel* ch = &this->channels[channel];
+            bool reliable = ch->type == channelType::ReliableOrdered;
+            uint count = len > NET_MESSAGE_SIZE ? (len + NET_FRAGMENT_SIZE - 1) / NET_FRAGMENT_SIZE : 0;
+            uint pieces = count ? count : 1;
+            packetBuffer* payloads[NET_MAX_FRAGMENTS];
 
-            if (transform)
+            if (reliable)
             {
-                m->data |= APPLY_TRANSFORM;
-                this->context->UpdateSubresource(this->transform, 0, NULL, transform, 0, 0);
-            }
+                if ((ushort)(ch->sendId + pieces - ch->oldestUnacked) > NET_RELIABLE_WINDOW) return false;
 
-            this->context->UpdateSubresource(this->world, 0, NULL, &m->pos, 0, 0);
+                // all or nothing, a message with missing fragments would block the channel
+                for (uint i = 0; i < pieces; i++)
+                {
+                    payloads[i] = this->pool->allocate();
+                    if (payloads[i]) continue;
 
-            if (m->indexBuffer)
-            {
-                this->context->IASetIndexBuffer(m->indexBuffer, DXGI_FORMAT_R32_UINT, 0);
-                this->context->DrawIndexed(m->indexCount, 0, 0);
+                    for (uint j = 0; j < i; j++) payloads[j]->release();
+                    return false;
+                }
             }
-            else
+
+            for (uint i = 0; i < pieces; i++)
             {
-                this->context->Draw(m->vertexCount, 0);
+                uint offset = i * NET_FRAGMENT_SIZE;
+                uint size = count ? (len - offset < NET_FRAGMENT_SIZE ? len - offset : NET_FRAGMENT_SIZE) : len;
+                ushort id = ch->sendId++;
+
+                if (!reliable)
+                {
+                    if (!this->write(c, channel, id, (byte)i, (byte)count, data + offset, size, false, nowNs)) return false;
+                    continue;
+                }
+
+                unackedMessage* m = &ch->unacked[id % NET_RELIABLE_WINDOW];
+                m->buffer = payloads[i];
+                memcpy(m->buffer->append(size), data + offset, size);
+                m->id = id;
+                m->used = true;
+                m->fragmentIndex = (byte)i;
+                m->fragmentCount = (byte)count;
+                // resent by the next update if it can't be packed now
+                m->lastSentNs = this->write(c, channel, id, (byte)i, (byte)count, data + offset, size, true, nowNs) ? nowNs : 0;
             }
+
+            return true;
         }
 
-        /// <summary>
-        /// updates vertex data every call;
-        /// will use global dynamic vertex buffer;
-        /// won't use mesh's vertex buffer or index buffer;
-        /// slower than constant one;
-        /// no transform applied at the moment so pos xy must be in screen coordinates
-        /// </summary>
-        void drawMeshDynamic(mesh* m, uint vertexCount)
+        // resends reliable messages not acked in time, sends a bare ack if something was received
+        // and nothing is going out, then closes the open datagram
+        // call once per network tick, returns number of messages resent
+        uint update(connection* c, long long nowNs)
         {
-            D3D11_MAPPED_SUBRESOURCE mappedResource;
-            ZeroMemory(&mappedResource, sizeof(D3D11_MAPPED_SUBRESOURCE));
-            //  Disable GPU access to the vertex buffer data.
-            this->context->Map(this->dynamicVertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
-            //  Update the vertex buffer here.
-            memcpy(mappedResource.pData, m->v, sizeof(vertex) * vertexCount);
-            //  Reenable GPU access to the vertex buffer data.
-            this->context->Unmap(this->dynamicVertexBuffer, 0);
+            long long resendNs = (long long)(this->getResendMs(c) * 1e6f);
+            uint resent = 0;
 
-            if (this->drawingSprites)
+            for (uint i = 0; i < this->channelCount; i++)
             {
-                this->drawingSprites = false;
-                this->context->VSSetShader(this->defaultMeshVS, 0, 0);
-                this->context->VSSetConstantBuffers(0, 1, &this->world);
-                this->context->VSSetConstantBuffers(1, 1, &this->view);
-                this->context->VSSetConstantBuffers(2, 1, &this->transform);
+                reliableChannel* ch = &this->channels[i];
+                if (ch->type != channelType::ReliableOrdered) continue;
+
+                for (ushort id = ch->oldestUnacked; id != ch->sendId; id++)
+                {
+                    unackedMessage* m = &ch->unacked[id % NET_RELIABLE_WINDOW];
+                    if (!m->used || m->id != id || nowNs - m->lastSentNs < resendNs) continue;
+
+                    if (!this->write(c, (byte)i, id, m->fragmentIndex, m->fragmentCount,
+                        m->buffer->getData(), m->buffer->len, true, nowNs))
+                        break;
+
+                    // first send that failed on an empty pool isn't a resend
+                    if (m->lastSentNs)
+                    {
+                        c->stats.resends++;
+                        resent++;
+                    }
+
+                    m->lastSentNs = nowNs;
+                }
             }
 
-            if (m->t)
-                this->context->PSSetShaderResources(0, 1, &m->t->shaderResource);
+            if (!this->open && this->ackPending) this->reserve(c, 0, false, nowNs);
+            this->closePacket(c, nowNs);
+            return resent;
+        }
 
-            int psdata[] = { !m->t,0,0,0 };
-            this->context->UpdateSubresource(this->cbufferPS, 0, 0, psdata, 0, 0);
+        void onAck(connection* c, ushort sequence, long long nowNs)
+        {
+            sentPacket* s = &this->sent[sequence % NET_ACK_WINDOW];
+            if (!s->used || s->acked || s->sequence != sequence) return;
 
-            m->data |= 8;
-            this->context->UpdateSubresource(this->world, 0, NULL, &m->pos, 0, 0);
+            s->acked = true;
+            c->addRttSample((nowNs - s->sendNs) / 1e6f);
 
-            UINT stride = sizeof(vertex);
-            UINT offset = 0;
-            this->context->IASetVertexBuffers(0, 1, &this->dynamicVertexBuffer, &stride, &offset);
-            this->context->Draw(vertexCount, 0);
+            for (uint i = 0; i < s->count; i++)
+            {
+                reliableChannel* ch = &this->channels[s->channels[i]];
+                unackedMessage* m = &ch->unacked[s->ids[i] % NET_RELIABLE_WINDOW];
+                if (!m->used || m->id != s->ids[i]) continue;
+
+                m->buffer->release();
+                m->used = false;
+
+                while (ch->oldestUnacked != ch->sendId && !ch->unacked[ch->oldestUnacked % NET_RELIABLE_WINDOW].used)
+                    ch->oldestUnacked++;
+            }
         }
 
-        void drawLine3d(line3d* m)
+        // hands a whole message to 'out', a fragment is copied into the channel's reassembly
+        // and the message comes out with its last fragment
+        // false when reassembly can't start for lack of a message buffer, the fragment is not taken
+        // and a reliable channel keeps it pending, anything else including malformed input is taken
+        bool deliver(message* out, uint* count, uint channel, packetBuffer* b, const byte* data, uint len,
+            ushort id, byte index, byte fragments)
         {
-            UINT stride = sizeof(vertex);
-            UINT offset = 0;
+            reliableChannel* ch = &this->channels[channel];
 
-            if (this->drawingSprites)
+            if (fragments == 0)
             {
-                this->drawingSprites = false;
-                this->context->VSSetShader(this->defaultMeshVS, 0, 0);
-                this->context->VSSetConstantBuffers(0, 1, &this->world);
-                this->context->VSSetConstantBuffers(1, 1, &this->view);
-                this->context->VSSetConstantBuffers(2, 1, &this->transform);
+                b->retain();
+                out[(*count)++] = { b, data, len, (byte)channel, id };
+                return true;
             }
 
-            m->data = 16;
-            this->context->UpdateSubresource(this->world, 0, NULL, m, 0, 0);
+            reassembly* a = &ch->assembly;
+            ushort first = id - index;
+            bool last = index + 1 == fragments;
 
-            int psdata[] = { 1,0,0,0 };
-            this->context->UpdateSubresource(this->cbufferPS, 0, 0, psdata, 0, 0);
+            if (index >= fragments || fragments > NET_MAX_FRAGMENTS || len > NET_FRAGMENT_SIZE || (!last && len != NET_FRAGMENT_SIZE))
+                return true;
+
+            // newer message replaces one that lost a fragment, older fragments are late
+            if (a->buffer && a->id != first)
+            {
+                if (!sequenceGreater(first, a->id)) return true;
+
+                a->buffer->release();
+                a->buffer = nullptr;
+            }
+
+            if (!a->buffer)
+            {
+                if (!this->messagePool || !(a->buffer = this->messagePool->allocate())) return false;
 
-            this->context->Draw(3, 0);
+                a->id = first;
+                a->count = fragments;
+                a->received = 0;
+                a->mask = 0;
+            }
+
+            if (fragments != a->count || (a->mask & (1ull << index))) return true;
+
+            memcpy(a->buffer->getData() + index * NET_FRAGMENT_SIZE, data, len);
+            a->mask |= 1ull << index;
+            a->received++;
+            if (last) a->buffer->len = index * NET_FRAGMENT_SIZE + len;
+            if (a->received < a->count) return true;
+
+            packetBuffer* whole = a->buffer;
+            a->buffer = nullptr;
+
+            if (ch->type == channelType::UnreliableSequenced)
+            {
+                if ((short)(first - ch->receiveId) < 0)
+                {
+                    whole->release();
+                    return true;
+                }
+
+                ch->receiveId = first + fragments;
+            }
+
+            out[(*count)++] = { whole, whole->getData(), whole->len, (byte)channel, first };
+            return true;
         }
 
-        void endScene()
+        // reliable messages that were waiting for a missing one or for a message buffer,
+        // receive calls it, call it when a message buffer is released and nothing else arrives
+        void deliverPending(message* out, uint* count, uint max)
         {
-            this->swapChain->Present(0, 0);
+            for (uint i = 0; i < this->channelCount; i++)
+            {
+                reliableChannel* ch = &this->channels[i];
+                if (ch->type != channelType::ReliableOrdered) continue;
+
+                while (*count < max)
+                {
+                    pendingMessage* p = &ch->pending[ch->receiveId % NET_RELIABLE_WINDOW];
+                    if (!p->used || p->id != ch->receiveId) break;
+
+                    if (!this->deliver(out, count, i, p->buffer, p->data, p->len, p->id, p->fragmentIndex, p->fragmentCount))
+                        break;
+
+                    p->buffer->release();
+                    p->used = false;
+                    ch->receiveId++;
+                }
+            }
         }
 
-        // utility function to calculate uv
-        // offset is where on texture to start
-        // width and height are frame size
-        // row length: in case frames on texture are stacked in multiple rows, how many frames per row are there
-        // frame count is how many uv elements to calculate
-        // uv is the destination, there must be at least as many uv elements avaiable as 'frameCount'
-        void uvSplit(uvSplitInfo* info, uv* uv)
+        // processes datagram 'b' from 'c' and writes deliverable messages to 'out', returns how many
+        // each message holds a reference to its buffer, release it when done, 'b' stays with the caller
+        // and messages waiting for a missing one keep referencing it, so receive into a new buffer each time
+        // unreliable messages that don't fit 'max' are dropped, reliable ones come with the next call
+        uint receive(connection* c, packetBuffer* b, long long nowNs, message* out, uint max)
         {
-            const float width = (float)info->pixelFrameWidth / info->pixelTexWidth;
-            const float height = (float)info->pixelFrameHeight / info->pixelTexHeight;
-            float offsetx = (float)info->pixelOffsetx / info->pixelTexWidth;
-            float x = offsetx;
-            float y = (float)info->pixelOffsety / info->pixelTexHeight;
+            if (b->len < NET_PACKET_HEADER) return 0;
+
+            const byte* h = b->getData();
+            ushort sequence, ack;
+            uint ackBits;
+            memcpy(&sequence, h, 2);
+            memcpy(&ack, h + 2, 2);
+            memcpy(&ackBits, h + 4, 4);
+            bool hasAck = (h[8] & 1) != 0;
+            bool newest = !this->receivedAny || sequenceGreater(sequence, c->remoteSequence);
+            uint diff = (ushort)(newest ? sequence - c->remoteSequence : c->remoteSequence - sequence);
+
+            // duplicate, or too old to tell
+            if (!newest && (diff == 0 || diff > 32 || (c->ackBits & (1u << (diff - 1))))) return 0;
+
+            if (hasAck)
+            {
+                this->onAck(c, ack, nowNs);
+                for (uint i = 0; i < 32; i++)
+                    if (ackBits & (1u << i)) this->onAck(c, (ushort)(ack - 1 - i), nowNs);
+            }
 
-            for (uint i = 0; i < info->frameCount; i++, uv++)
+            // what didn't fit last time goes first
+            uint count = 0;
+            this->deliverPending(out, &count, max);
+            // a reliable message too far ahead to keep, it's there when delivery waits for a message buffer
+            bool refused = false;
+            const byte* p = h + NET_PACKET_HEADER;
+            const byte* end = h + b->len;
+
+            while (end - p >= (long long)NET_MESSAGE_HEADER)
             {
-                uv->left = x;
-                uv->top = y;
-                uv->right = x + width;
-                uv->bottom = y + height;
+                byte channel = p[0] & ~NET_FRAGMENT_FLAG;
+                bool fragment = (p[0] & NET_FRAGMENT_FLAG) != 0;
+                ushort id, len;
+                memcpy(&id, p + 1, 2);
+                memcpy(&len, p + 3, 2);
+                byte index = 0, fragments = 0;
+                const byte* data = p + NET_MESSAGE_HEADER;
+
+                if (fragment)
+                {
+                    if (end - data < (long long)NET_FRAGMENT_HEADER) break;
+
+                    index = data[0];
+                    fragments = data[1];
+                    data += NET_FRAGMENT_HEADER;
+                }
+
+                p = data + len;
+
+                // malformed, rest of the datagram can't be trusted
+                if (channel >= this->channelCount || p > end || (fragment && fragments == 0)) break;
+
+                reliableChannel* ch = &this->channels[channel];
+
+                if (ch->type == channelType::Unreliable || (ch->type == channelType::UnreliableSequenced && fragment))
+                {
+                    if (count < max) this->deliver(out, &count, channel, b, data, len, id, index, fragments);
+                }
+                else if (ch->type == channelType::UnreliableSequenced)
+                {
+                    if ((short)(id - ch->receiveId) >= 0 && count < max)
+                    {
+                        this->deliver(out, &count, channel, b, data, len, id, 0, 0);
+                        ch->receiveId = id + 1;
+                    }
+                }
+                else
+                {
+                    // behind receiveId was delivered already, a window ahead can't be sent yet
+                    short ahead = (short)(id - ch->receiveId);
+
+                    if (ahead == 0 && count < max && this->deliver(out, &count, channel, b, data, len, id, index, fragments))
+                    {
+                        ch->receiveId++;
+                        this->deliverPending(out, &count, max);
+                    }
+                    // it's acked already so it waits here, also when reassembly had no buffer
+                    else if (ahead >= 0 && ahead < (short)NET_RELIABLE_WINDOW)
+                    {
+                        pendingMessage* pm = &ch->pending[id % NET_RELIABLE_WINDOW];
+
+                        if (!pm->used)
+                        {
+                            b->retain();
+                            *pm = { b, data, len, id, true, index, fragments };
+                        }
+                    }
+                    else if (ahead > 0) refused = true;
+                }
+            }
 
-                x += width;
+            this->deliverPending(out, &count, max);
 
-                if (x >= width * info->rowLength + offsetx)
-                {
-                    x = offsetx;
-                    y += height;
-                }
+            // packet isn't acked so the sender keeps its messages and sends them again
+            if (refused) return count;
+
+            this->ackPending = true;
+
+            if (!this->receivedAny)
+            {
+                this->receivedAny = true;
+                c->remoteSequence = sequence;
+                c->ackBits = 0;
             }
-        }
+            else if (newest)
+            {
+                c->ackBits = diff < 32 ? c->ackBits << diff : 0;
+                if (diff <= 32) c->ackBits |= 1u << (diff - 1);
+                c->remoteSequence = sequence;
+            }
+            else c->ackBits |= 1u << (diff - 1);
 
-        // 'pixelWidth' and 'pixelHeight' are dimensions in pixel
-        void setPixelScale(sprite* s, uint pixelWidth, uint pixelHeight)
-        {
-            s->s1.sx = 2.0f / this->window->width / this->camera.scale * pixelWidth * this->camera.aspectRatio;
-            s->s1.sy = 2.0f / this->window->height / this->camera.scale * pixelHeight;
+            return count;
         }
+    };
 
-        // 'pixelx' and 'pixely' are window coordinates in pixels (0,0) is in upper left corner
-        void setScreenPos(sprite* s, uint pixelx, uint pixely)
-        {
-            s->s1.x = 2.0f / this->window->width * (pixelx - this->window->width / 2.0f) / this->camera.scale * this->camera.aspectRatio;
-            s->s1.y = 2.0f / this->window->height * (pixely - this->window->height / 2.0f) / this->camera.scale;
-        }
+    // writes values of 1 to 32 bits, least significant first, into a caller buffer
+    struct bitWriter
+    {
+        byte* data;
+        uint capacity;
+        uint bytes;
+        unsigned long long scratch;
+        uint scratchBits;
+        bool overflow;
 
-        // 'pixelWidth' and 'pixelHeight' are dimensions in pixel, camera independent
-        void setPixelScale2(sprite* s, uint pixelWidth, uint pixelHeight)
+        void init(byte* data, uint capacity)
         {
-            s->s1.sx = 2.0f / this->window->width * pixelWidth * this->window->width / (float)this->window->height;
-            s->s1.sy = 2.0f / this->window->height * pixelHeight;
+            this->data = data;
+            this->capacity = capacity;
+            this->bytes = 0;
+            this->scratch = 0;
+            this->scratchBits = 0;
+            this->overflow = false;
         }
 
-        // 'pixelx' and 'pixely' are window coordinates in pixels (0,0) is in upper left corner, camera independent
-        void setScreenPos2(sprite* s, uint pixelx, uint pixely)
+        void write(uint value, uint bits)
         {
-            s->s1.x = 2.0f / this->window->width * (pixelx - this->window->width / 2.0f) * this->window->width / (float)this->window->height;
-            s->s1.y = 2.0f / this->window->height * (pixely - this->window->height / 2.0f);
+            this->scratch |= (unsigned long long)(value & (uint)((1ull << bits) - 1)) << this->scratchBits;
+            this->scratchBits += bits;
+
+            if (this->scratchBits >= 32)
+            {
+                if (this->bytes + 4 > this->capacity) this->overflow = true;
+                else memcpy(this->data + this->bytes, &this->scratch, 4);
+
+                this->bytes += 4;
+                this->scratch >>= 32;
+                this->scratchBits -= 32;
+            }
         }
 
-        // puts width and height in world coordinates of 1px in f[0] and f[1]
-        void getPixelScale(float* f)
+        // returns bytes written, 0 if they didn't fit
+        uint finish()
         {
-            f[0] = 2.0f / this->window->width / this->camera.scale * this->camera.aspectRatio;
-            f[1] = 2.0f / this->window->height / this->camera.scale;
+            while (this->scratchBits > 0)
+            {
+                if (this->bytes + 1 > this->capacity) this->overflow = true;
+                else this->data[this->bytes] = (byte)this->scratch;
+
+                this->bytes++;
+                this->scratch >>= 8;
+                this->scratchBits = this->scratchBits > 8 ? this->scratchBits - 8 : 0;
+            }
+
+            return this->overflow ? 0 : this->bytes;
         }
+    };
 
-        // utli function that will calc uv coords if you know pixel coords
-        void setUvFromPixels(sprite* s, float pixelOffsetX, float pixelOffsetY, float pixelWidth,
-            float pixelHeight, float pixelTextureWidth, float pixelTextureHeight)
+    struct bitReader
+    {
+        const byte* data;
+        uint size;
+        uint position;
+        unsigned long long scratch;
+        uint scratchBits;
+        unsigned long long bitsLeft;
+        // read past the end, values read after it are 0
+        bool overflow;
+
+        void init(const byte* data, uint size)
         {
-            s->s1.left = pixelOffsetX / pixelTextureWidth;
-            s->s1.top = pixelOffsetY / pixelTextureHeight;
-            s->s1.right = s->s1.left + pixelWidth / pixelTextureWidth;
-            s->s1.bottom = s->s1.top + pixelHeight / pixelTextureHeight;
+            this->data = data;
+            this->size = size;
+            this->position = 0;
+            this->scratch = 0;
+            this->scratchBits = 0;
+            this->bitsLeft = (unsigned long long)size * 8;
+            this->overflow = false;
         }
 
-        /// <summary>
-        /// index is not required;
-        /// mesh will be drawn as triangle list so index count should be multiple of 3
-        /// </summary>
-        void initMesh(mesh* m, vertex* v, uint vertexCount, uint* index, uint indexCount, texture* t)
+        uint read(uint bits)
         {
-            util::zero(m);
-            m->index = index;
-            m->indexCount = indexCount;
-            m->vertexCount = vertexCount;
-            m->v = v;
-            m->sca = { 1,1,1 };
-            m->color = { 1,1,1 };
-            m->t = t;
+            if (bits > this->bitsLeft)
+            {
+                this->overflow = true;
+                this->bitsLeft = 0;
+                return 0;
+            }
 
-            D3D11_BUFFER_DESC vertexBufferDesc = {};
+            if (this->scratchBits < bits)
+            {
+                uint word = 0;
+                uint n = this->size - this->position < 4 ? this->size - this->position : 4;
+                memcpy(&word, this->data + this->position, n);
+                this->position += n;
+                this->scratch |= (unsigned long long)word << this->scratchBits;
+                this->scratchBits += 32;
+            }
 
-            vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-            vertexBufferDesc.ByteWidth = sizeof(vertex) * m->vertexCount;
-            vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+            uint value = (uint)(this->scratch & ((1ull << bits) - 1));
+            this->scratch >>= bits;
+            this->scratchBits -= bits;
+            this->bitsLeft -= bits;
+            return value;
+        }
+    };
 
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {};
-            vertexBufferData.pSysMem = m->v;
+    // float fields of one entity, same order as sprite1 so a sprite can be captured from &s1.x
+    const uint NET_SNAPSHOT_FIELDS = 16;
+    // snapshots kept for baselines, client acks have to come within this many ticks
+    const uint NET_SNAPSHOT_HISTORY = 32;
 
-            HRESULT hr = this->device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, &m->vertexBuffer);
-            checkhr(hr, __LINE__);
+    // value is clamped to min..max and stored in 'bits' bits, 0 bits means the field isn't sent
+    struct fieldQuantization
+    {
+        float min;
+        float max;
+        uint bits;
+    };
 
-            D3D11_BUFFER_DESC indexBufferDesc = {};
+    struct snapshotSchema
+    {
+        fieldQuantization fields[NET_SNAPSHOT_FIELDS];
 
-            indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-            indexBufferDesc.ByteWidth = sizeof(uint) * m->indexCount;
-            indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        void set(uint field, float min, float max, uint bits)
+        {
+            this->fields[field] = { min, max, bits };
+        }
 
-            if (m->index)
-            {
-                D3D11_SUBRESOURCE_DATA iinitData = {};
-                iinitData.pSysMem = m->index;
+        // sprite1 fields, position in -64..64 with ~0.0001 steps, uv and color in 0..1
+        // change ranges to match the game, coordinates outside are clamped
+        void initSprite()
+        {
+            // x, y, z
+            for (uint i = 0; i < 3; i++) this->set(i, -64, 64, 20);
+            // sx, sy
+            this->set(3, -16, 16, 16);
+            this->set(4, -16, 16, 16);
+            // rot
+            this->set(5, -8, 8, 14);
+            // ox, oy
+            this->set(6, -4, 4, 12);
+            this->set(7, -4, 4, 12);
+            // uv left, top, right, bottom
+            for (uint i = 8; i < 12; i++) this->set(i, 0, 1, 16);
+            // r, g, b, a
+            for (uint i = 12; i < 16; i++) this->set(i, 0, 1, 8);
+        }
 
-                hr = this->device->CreateBuffer(&indexBufferDesc, &iinitData, &m->indexBuffer);
-                checkhr(hr, __LINE__);
-            }
+        uint quantize(uint field, float value)
+        {
+            const fieldQuantization* q = &this->fields[field];
+            if (q->bits == 0) return 0;
+
+            uint steps = (uint)((1ull << q->bits) - 1);
+            float t = (value - q->min) / (q->max - q->min);
+            t = t < 0 ? 0 : t > 1 ? 1 : t;
+            return (uint)(t * steps + 0.5f);
         }
 
-        void setWireframe()
+        float dequantize(uint field, uint value)
         {
-            this->context->RSSetState(this->wireframe);
+            const fieldQuantization* q = &this->fields[field];
+            if (q->bits == 0) return 0;
+
+            uint steps = (uint)((1ull << q->bits) - 1);
+            return q->min + (q->max - q->min) * (value / (float)steps);
         }
+    };
 
-        void setSolid()
+    // quantized fields of 'count' entities at one tick
+    // comparing quantized values makes delta exact, both sides see the same numbers
+    struct snapshot
+    {
+        uint tick;
+        uint count;
+        bool used;
+        uint* values;
+    };
+
+    // Last NET_SNAPSHOT_HISTORY snapshots, server encodes against the one a client acked,
+    // client decodes against the same one from its own history.
+    struct snapshotHistory
+    {
+        snapshotSchema* schema;
+        snapshot items[NET_SNAPSHOT_HISTORY];
+        uint capacity;
+
+        void init(snapshotSchema* schema, uint capacity)
         {
-            this->context->RSSetState(this->solid);
+            this->schema = schema;
+            this->capacity = capacity;
+
+            for (uint i = 0; i < NET_SNAPSHOT_HISTORY; i++)
+            {
+                this->items[i].used = false;
+                this->items[i].count = 0;
+                this->items[i].values = (uint*)calloc((size_t)capacity * NET_SNAPSHOT_FIELDS, sizeof(uint));
+            }
         }
 
-        void destroyMesh(mesh* m)
+        void destroy()
         {
-            if (m->indexBuffer)
+            for (uint i = 0; i < NET_SNAPSHOT_HISTORY; i++)
             {
-                m->indexBuffer->Release();
-                m->indexBuffer = nullptr;
+                ::free(this->items[i].values);
+                this->items[i].values = nullptr;
             }
-            m->vertexBuffer->Release();
-            m->vertexBuffer = nullptr;
         }
 
-        void enableBlendState()
+        // replaces the oldest snapshot, fill it with capture
+        snapshot* begin(uint tick, uint count)
         {
-            float blendFactor[] = { 0, 0, 0, 0 };
-            this->context->OMSetBlendState(this->blendState, blendFactor, 0xffffffff);
+            snapshot* s = &this->items[tick % NET_SNAPSHOT_HISTORY];
+            s->tick = tick;
+            s->count = count < this->capacity ? count : this->capacity;
+            s->used = true;
+            return s;
         }
 
-        void disableBlendState()
+        // null when 'tick' is too old or was never stored
+        snapshot* find(uint tick)
         {
-            this->context->OMSetBlendState(0, 0, 0xffffffff);
+            snapshot* s = &this->items[tick % NET_SNAPSHOT_HISTORY];
+            return s->used && s->tick == tick ? s : nullptr;
         }
 
-        void setDefaultSpriteVS()
+        void capture(snapshot* s, uint entity, const float* fields)
         {
-            this->currentVS = this->defaultVS;
-            this->context->VSSetShader(this->currentVS, 0, 0);
+            uint* q = s->values + (size_t)entity * NET_SNAPSHOT_FIELDS;
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++) q[f] = this->schema->quantize(f, fields[f]);
         }
 
-        void setSpriteVS(ID3D11VertexShader* vs)
+        // writes dequantized fields of 'entity', fields with 0 bits are left alone
+        void apply(const snapshot* s, uint entity, float* fields)
         {
-            this->currentVS = vs;
-            this->context->VSSetShader(this->currentVS, 0, 0);
+            const uint* q = s->values + (size_t)entity * NET_SNAPSHOT_FIELDS;
+
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++)
+                if (this->schema->fields[f].bits) fields[f] = this->schema->dequantize(f, q[f]);
         }
 
-        ID3D11VertexShader* createVertexShader(const char* str)
+#ifdef _WIN32
+        void captureSprite(snapshot* s, uint entity, const gl::sprite* sprite)
         {
-            return this->createVertexShaderFromString(str, "main", "vs_5_0", false);
+            this->capture(s, entity, &sprite->s1.x);
         }
 
-        void destroyVertexShader(ID3D11VertexShader* vs)
+        void applySprite(const snapshot* s, uint entity, gl::sprite* sprite)
         {
-            vs->Release();
+            this->apply(s, entity, &sprite->s1.x);
         }
+#endif
     };
-}
 
-namespace vi::input
-{
-    // for letters and numbers use 'A' - 'Z', '0' - '9' etc
-    //// this doesnt have to be enum class because numbers are allowed from outside of this set
-    enum key : int
+    // Writes 'current' as changes against 'baseline', null baseline sends everything.
+    // per entity 1 bit says if anything changed, then a bit per field and the changed values
+    // returns bytes written, 0 if 'capacity' is too small
+    uint encodeSnapshot(const snapshotSchema* schema, const snapshot* current, const snapshot* baseline, byte* out, uint capacity)
     {
-        LMOUSE = VK_LBUTTON,
-        RMOUSE = VK_RBUTTON,
-        MMOUSE = VK_MBUTTON,
+        bitWriter w;
+        w.init(out, capacity);
+        w.write(current->tick, 32);
+        w.write(baseline ? 1 : 0, 1);
+        if (baseline) w.write(baseline->tick, 32);
+        w.write(current->count, 32);
 
-        LEFT = VK_LEFT,
-        RIGHT = VK_RIGHT,
-        UP = VK_UP,
-        DOWN = VK_DOWN,
+        static const uint zero[NET_SNAPSHOT_FIELDS] = {};
 
-        INSERT = VK_INSERT,
-        DEL = VK_DELETE,
-        HOME = VK_HOME,
-        END = VK_END,
-        PAGEUP = VK_PRIOR,
-        PAGEDOWN = VK_NEXT,
-        SCROLLLOCK = VK_SCROLL,
-        PRNT_SCRN = VK_SNAPSHOT,
+        for (uint e = 0; e < current->count; e++)
+        {
+            const uint* q = current->values + (size_t)e * NET_SNAPSHOT_FIELDS;
+            const uint* b = baseline && e < baseline->count ? baseline->values + (size_t)e * NET_SNAPSHOT_FIELDS : zero;
+            uint mask = 0;
 
-        TAB = VK_TAB,
-        CAPSLOCK = VK_CAPITAL,
-        LSHIFT = VK_LSHIFT,
-        LALT = VK_LMENU,
-        LCONTROL = VK_LCONTROL,
-        LWIN = VK_LWIN,
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++)
+                mask |= (uint)(q[f] != b[f] && schema->fields[f].bits) << f;
 
-        SPACE = VK_SPACE,
+            w.write(mask != 0, 1);
+            if (!mask) continue;
 
-        BACKSPACE = VK_BACK,
-        ENTER = VK_RETURN,
-        RSHIFT = VK_RSHIFT,
-        RCONTROL = VK_RCONTROL,
-        RALT = VK_RMENU,
-        RWIN = VK_RWIN,
-        MENU = VK_APPS,
+            w.write(mask, NET_SNAPSHOT_FIELDS);
 
-        ESCAPE = VK_ESCAPE,
-        F1 = VK_F1,
-        F2 = VK_F2,
-        F3 = VK_F3,
-        F4 = VK_F4,
-        F5 = VK_F5,
-        F6 = VK_F6,
-        F7 = VK_F7,
-        F8 = VK_F8,
-        F9 = VK_F9,
-        F10 = VK_F10,
-        F11 = VK_F11,
-        F12 = VK_F12,
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++)
+                if (mask & (1u << f)) w.write(q[f], schema->fields[f].bits);
 
-        NUMLOCK = VK_NUMLOCK,
-        NUM0 = VK_NUMPAD0,
-        NUM1 = VK_NUMPAD1,
-        NUM2 = VK_NUMPAD2,
-        NUM3 = VK_NUMPAD3,
-        NUM4 = VK_NUMPAD4,
-        NUM5 = VK_NUMPAD5,
-        NUM6 = VK_NUMPAD6,
-        NUM7 = VK_NUMPAD7,
-        NUM8 = VK_NUMPAD8,
-        NUM9 = VK_NUMPAD9,
-        NUMDIV = VK_DIVIDE,
-        NUMMUL = VK_MULTIPLY,
-        NUMMINUS = VK_SUBTRACT,
-        MULPLUS = VK_ADD,
-        NUMDEL = VK_DECIMAL,
+            if (w.overflow) return 0;
+        }
 
-        MINUS = VK_OEM_MINUS,
-        EQUALS = VK_OEM_PLUS,
-        BRACKETOPEN = VK_OEM_4,
-        BRACKETCLOSE = VK_OEM_6,
-        PIPE = VK_OEM_5,
-        SEMICOLON = VK_OEM_1,
-        QUOTE = VK_OEM_7,
-        COMMA = VK_OEM_COMMA,
-        PERIOD = VK_OEM_PERIOD,
-        SLASH = VK_OEM_2,
-        TILD = VK_OEM_3
-    };
+        return w.finish();
+    }
 
-    struct keyboard
+    // Reads what encodeSnapshot wrote into a new snapshot of 'h', baseline is looked up in 'h'.
+    // returns it, null when data is malformed or the baseline is gone, then a full one is needed
+    snapshot* decodeSnapshot(snapshotHistory* h, const byte* data, uint size)
     {
-        bool buf1[KEYBOARD_KEY_COUNT];
-        bool buf2[KEYBOARD_KEY_COUNT];
-        char typemaplower[KEYBOARD_KEY_COUNT];
-        char typemapupper[KEYBOARD_KEY_COUNT];
-        bool* curState;
-        bool* prevState;
-        char typedKey;
+        bitReader r;
+        r.init(data, size);
+        uint tick = r.read(32);
+        snapshot* baseline = nullptr;
 
-        void init()
+        if (r.read(1))
         {
-            this->typedKey = 0;
-            this->curState = this->buf1;
-            this->prevState = this->buf2;
-            memset(this->buf1, 0, KEYBOARD_KEY_COUNT);
-            memset(this->buf2, 0, KEYBOARD_KEY_COUNT);
-            memset(this->typemaplower, 0, KEYBOARD_KEY_COUNT);
-            memset(this->typemapupper, 0, KEYBOARD_KEY_COUNT);
-
-            this->typemaplower[9] = '\t';
-            this->typemaplower[32] = ' ';
-            memcpy(this->typemaplower + 48, "0123456789", 10);
-            memcpy(this->typemaplower + 65, "abcdefghijklmnopqrstuvwxyz", 26);
-            memcpy(this->typemaplower + 186, ";=,-./`", 7);
-            memcpy(this->typemaplower + 219, "[\\]'", 4);
-            memcpy(this->typemaplower + 96, "0123456789*+'", 13);
-            this->typemaplower[109] = '-';
-            this->typemaplower[111] = '/';
-
-            this->typemapupper[9] = '\t';
-            this->typemapupper[32] = ' ';
-            memcpy(this->typemapupper + 48, ")!@#$%^&*(", 10);
-            memcpy(this->typemapupper + 65, "ABCDEFGHIJKLMNOPQRSTUVWXYZ", 26);
-            memcpy(this->typemapupper + 186, ":+<_>?~", 7);
-            memcpy(this->typemapupper + 219, "{|}\"", 4);
-            memcpy(this->typemapupper + 96, "0123456789*+'", 13);
-            this->typemapupper[109] = '-';
-            this->typemapupper[111] = '/';
+            baseline = h->find(r.read(32));
+            if (!baseline) return nullptr;
         }
 
-        void update()
-        {
-            this->typedKey = 0;
-            // swap states
-            vi::util::swap(this->curState, this->prevState);
+        uint count = r.read(32);
+        if (r.overflow || count > h->capacity || (baseline && baseline->tick == tick)) return nullptr;
 
-            // get shift first
-            bool isUpper = (::GetAsyncKeyState(16) & 0x8000) && true;
-            // get button states
-            for (int i = 0; i < KEYBOARD_KEY_COUNT; i++)
-            {
-                this->curState[i] = (::GetAsyncKeyState(i) & 0x8000) && true;
-                if (this->typemapupper[i] != 0 && !this->prevState[i] && this->curState[i] && isUpper)
-                    this->typedKey = this->typemapupper[i];
-                else if (this->typemaplower[i] != 0 && !this->prevState[i] && this->curState[i] && !isUpper)
-                    this->typedKey = this->typemaplower[i];
-            }
-        }
+        // a bad packet must not replace a stored snapshot, so check it all fits first
+        bitReader check = r;
 
-        bool isKeyDown(int _key)
+        for (uint e = 0; e < count && !check.overflow; e++)
         {
-            return this->curState[_key];
-        }
+            if (!check.read(1)) continue;
 
-        bool isKeyPressed(int _key)
-        {
-            // TODO, return false if this is the first frame
-            //return k->curState[(int)_key] && !k->prevState[(int)_key] && engine->GetFrame() != 0;
-            return this->curState[_key] && !this->prevState[_key];
-        }
+            uint mask = check.read(NET_SNAPSHOT_FIELDS);
 
-        bool isKeyReleased(int _key)
-        {
-            return !this->curState[_key] && this->prevState[_key];
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++)
+                if (mask & (1u << f)) check.read(h->schema->fields[f].bits);
         }
 
-        char getKeyTyped()
-        {
-            return this->typedKey;
-        }
-    };
+        if (check.overflow) return nullptr;
 
-    struct mouse
-    {
-        int _cursorScreenx;
-        int _cursorScreeny;
-        int _cursorClientx;
-        int _cursorClienty;
-        float _cursorWorldx;
-        float _cursorWorldy;
-        int _cursorDeltax;
-        int _cursorDeltay;
-        short _wheel;
-        int _rawMouseDeltax;
-        int _rawMouseDeltay;
+        // taken before 'begin', baseline a whole history back shares the slot and its count is overwritten
+        uint baselineCount = baseline ? baseline->count : 0;
+        snapshot* s = h->begin(tick, count);
+        uint copied = baselineCount < count ? baselineCount : count;
+        // sharing the slot also means its values are already there
+        if (copied && s != baseline) memcpy(s->values, baseline->values, (size_t)copied * NET_SNAPSHOT_FIELDS * sizeof(uint));
+        memset(s->values + (size_t)copied * NET_SNAPSHOT_FIELDS, 0, (size_t)(count - copied) * NET_SNAPSHOT_FIELDS * sizeof(uint));
 
-        void init()
+        for (uint e = 0; e < count; e++)
         {
-            util::zero(this);
+            if (!r.read(1)) continue;
+
+            uint* q = s->values + (size_t)e * NET_SNAPSHOT_FIELDS;
+            uint mask = r.read(NET_SNAPSHOT_FIELDS);
+
+            for (uint f = 0; f < NET_SNAPSHOT_FIELDS; f++)
+                if (mask & (1u << f)) q[f] = r.read(h->schema->fields[f].bits);
         }
 
-        /// <summary>
-        /// can pass null for camera but you wont get 2D world x and y
-        /// </summary>
-        void update(system::window* w, gl::camera* c)
-        {
-            POINT p;
-            GetCursorPos(&p);
-            this->_cursorDeltax = p.x - this->_cursorScreenx;
-            this->_cursorDeltay = p.y - this->_cursorScreeny;
-            this->_cursorScreenx = p.x;
-            this->_cursorScreeny = p.y;
-            this->_wheel = system::wheelDelta;
-            this->_rawMouseDeltax = system::rawMouseDeltax;
-            this->_rawMouseDeltay = system::rawMouseDeltay;
+        return s;
+    }
 
-            p = { this->_cursorScreenx, this->_cursorScreeny };
-            ScreenToClient(w->handle, &p);
-            this->_cursorClientx = p.x;
-            this->_cursorClienty = p.y;
+    struct interestEvent
+    {
+        uint client;
+        uint entity;
+        // false when it left
+        bool enter;
+    };
 
-            if (c)
+    // what one client sees, entities inside the view grown by enterMargin become relevant,
+    // they stop being relevant only outside the view grown by leaveMargin
+    struct interestView
+    {
+        float x;
+        float y;
+        float halfWidth;
+        float halfHeight;
+        bool active;
+        // relevant entities in no particular order, and the same as bits for lookup
+        std::vector<uint> relevant;
+        std::vector<unsigned long long> bits;
+    };
+
+    // Replication scope. Entities are bucketed in a uniform grid every update and each client
+    // only looks at the cells under its view and at what is already relevant to it, so cost
+    // follows local density, not world size. Changes come out as enter and leave events.
+    struct interestGrid
+    {
+        float minX;
+        float minY;
+        float cellSize;
+        uint columns;
+        uint rows;
+        // entities of cell i are cellEntities[cellStart[i] .. cellStart[i + 1]], rebuilt by update
+        std::vector<uint> cellStart;
+        std::vector<uint> cellEntities;
+        std::vector<uint> entityCells;
+        std::vector<float> positions;
+        std::vector<bool> entityActive;
+        std::vector<interestView> views;
+        // grows the view, difference between the two is the hysteresis band
+        float enterMargin;
+        float leaveMargin;
+        // filled by update
+        std::vector<interestEvent> events;
+
+        // positions outside min..max are put in the border cells
+        void init(float minX, float minY, float maxX, float maxY, float cellSize, uint entityCapacity, uint clientCapacity)
+        {
+            this->minX = minX;
+            this->minY = minY;
+            this->cellSize = cellSize;
+            this->columns = (uint)((maxX - minX) / cellSize) + 1;
+            this->rows = (uint)((maxY - minY) / cellSize) + 1;
+            this->cellStart.assign(this->columns * this->rows + 1, 0);
+            this->cellEntities.resize(entityCapacity);
+            this->entityCells.resize(entityCapacity);
+            this->positions.assign(entityCapacity * 2, 0);
+            this->entityActive.assign(entityCapacity, false);
+            this->views.resize(clientCapacity);
+            this->enterMargin = 0;
+            this->leaveMargin = cellSize * 0.5f;
+
+            for (uint i = 0; i < clientCapacity; i++)
             {
-                this->_cursorWorldx = ((float)this->_cursorClientx - w->width / 2) / w->width / c->scale * c->aspectRatio * 2 + c->x;
-                this->_cursorWorldy = ((float)this->_cursorClienty - w->height / 2) / w->height / c->scale * 2 + c->y;
+                this->views[i].active = false;
+                this->views[i].bits.assign((entityCapacity + 63) / 64, 0);
             }
         }
 
-        // this is relative to monitor's upper left corner
-        void getCursorScreenPos(int* x, int* y)
+        void destroy()
         {
-            *x = this->_cursorScreenx;
-            *y = this->_cursorScreeny;
+            this->cellStart.clear();
+            this->cellEntities.clear();
+            this->views.clear();
+            this->events.clear();
         }
 
-        // this is relative to client's upper left corner 
-        void getCursorClientPos(int* x, int* y)
+        void setEntity(uint entity, float x, float y)
         {
-            *x = this->_cursorClientx;
-            *y = this->_cursorClienty;
+            this->positions[entity * 2] = x;
+            this->positions[entity * 2 + 1] = y;
+            this->entityActive[entity] = true;
         }
 
-        void getCursorWorldPos(float* x, float* y)
+        // clients it was relevant to get a leave event with the next update
+        void removeEntity(uint entity)
         {
-            *x = this->_cursorWorldx;
-            *y = this->_cursorWorldy;
+            this->entityActive[entity] = false;
         }
 
-        void getCursorScreenDelta(int* x, int* y)
+        void setView(uint client, float x, float y, float halfWidth, float halfHeight)
         {
-            *x = this->_cursorDeltax;
-            *y = this->_cursorDeltay;
+            interestView* v = &this->views[client];
+            v->x = x;
+            v->y = y;
+            v->halfWidth = halfWidth;
+            v->halfHeight = halfHeight;
+            v->active = true;
         }
 
-        void getCursorDeltaRaw(int* x, int* y)
+#ifdef _WIN32
+        // area the client's camera shows, same mapping as mouse world position
+        void setCamera(uint client, const gl::camera* c)
         {
-            *x = this->_rawMouseDeltax;
-            *y = this->_rawMouseDeltay;
+            this->setView(client, c->x, c->y, c->aspectRatio / c->scale, 1 / c->scale);
         }
+#endif
 
-        /// <summary>
-        /// Is cursor position different that last update
-        /// </summary>
-        bool moved()
+        // forgets relevant set without events, client is gone anyway
+        void removeClient(uint client)
         {
-            return (this->_cursorDeltax + this->_cursorDeltay) != 0;
+            interestView* v = &this->views[client];
+            v->active = false;
+            for (uint i = 0; i < v->relevant.size(); i++) v->bits[v->relevant[i] / 64] = 0;
+            v->relevant.clear();
         }
 
-        short getWheelDelta()
+        bool isRelevant(uint client, uint entity)
         {
-            return this->_wheel;
+            return (this->views[client].bits[entity / 64] >> (entity % 64)) & 1;
         }
-    };
-}
 
-namespace vi::net
-{
-    uint uid = 1;
-    WSAData wsadata;
-    char lastWinsockError[300];
+        const std::vector<uint>& getRelevant(uint client)
+        {
+            return this->views[client].relevant;
+        }
 
-    void _getLastWinsockErrorMessage(DWORD errorCode)
-    {
-        ZeroMemory(lastWinsockError, 300);
-        FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM, 0, errorCode,
-            MAKELANGID(LANG_ENGLISH, SUBLANG_ENGLISH_US), lastWinsockError, 300, 0);
-    }
+        uint getCell(float x, float y)
+        {
+            int cx = (int)((x - this->minX) / this->cellSize);
+            int cy = (int)((y - this->minY) / this->cellSize);
+            cx = cx < 0 ? 0 : cx >= (int)this->columns ? this->columns - 1 : cx;
+            cy = cy < 0 ? 0 : cy >= (int)this->rows ? this->rows - 1 : cy;
+            return cy * this->columns + cx;
+        }
 
-    void initNetwork()
-    {
-        int res = WSAStartup(MAKEWORD(2, 2), &wsadata);
+        // counting sort of active entities by cell
+        void rebuild()
+        {
+            uint cells = this->columns * this->rows;
+            uint count = (uint)this->entityActive.size();
+            std::fill(this->cellStart.begin(), this->cellStart.end(), 0);
 
-#ifdef VI_VALIDATE
-        if (res != 0)
+            for (uint e = 0; e < count; e++)
+            {
+                if (!this->entityActive[e]) continue;
+
+                uint cell = this->getCell(this->positions[e * 2], this->positions[e * 2 + 1]);
+                this->entityCells[e] = cell;
+                this->cellStart[cell + 1]++;
+            }
+
+            for (uint i = 0; i < cells; i++) this->cellStart[i + 1] += this->cellStart[i];
+
+            // cellStart[cell] is used as write position, then shifted back
+            for (uint e = 0; e < count; e++)
+                if (this->entityActive[e]) this->cellEntities[this->cellStart[this->entityCells[e]]++] = e;
+
+            for (uint i = cells; i > 0; i--) this->cellStart[i] = this->cellStart[i - 1];
+            this->cellStart[0] = 0;
+        }
+
+        bool isInside(const interestView* v, uint entity, float margin)
         {
-            _getLastWinsockErrorMessage(res);
-            fprintf(stderr, lastWinsockError);
+            float dx = this->positions[entity * 2] - v->x;
+            float dy = this->positions[entity * 2 + 1] - v->y;
+            if (dx < 0) dx = -dx;
+            if (dy < 0) dy = -dy;
+            return dx <= v->halfWidth + margin && dy <= v->halfHeight + margin;
         }
-#endif
-    }
 
-    void uninitNetwork()
-    {
-        int res = WSACleanup();
-#ifdef VI_VALIDATE
-        if (res == SOCKET_ERROR)
+        // call after entities and views were moved for this tick, events of all clients go to 'events'
+        void update()
         {
-            _getLastWinsockErrorMessage(WSAGetLastError());
-            fprintf(stderr, lastWinsockError);
+            this->events.clear();
+            this->rebuild();
+
+            for (uint c = 0; c < this->views.size(); c++)
+            {
+                interestView* v = &this->views[c];
+                if (!v->active) continue;
+
+                // what left the wider box or was removed
+                for (uint i = 0; i < v->relevant.size();)
+                {
+                    uint e = v->relevant[i];
+
+                    if (this->entityActive[e] && this->isInside(v, e, this->leaveMargin))
+                    {
+                        i++;
+                        continue;
+                    }
+
+                    v->bits[e / 64] &= ~(1ull << (e % 64));
+                    v->relevant[i] = v->relevant.back();
+                    v->relevant.pop_back();
+                    this->events.push_back({ c, e, false });
+                }
+
+                // what is in the cells under the view
+                float w = v->halfWidth + this->enterMargin;
+                float h = v->halfHeight + this->enterMargin;
+                uint first = this->getCell(v->x - w, v->y - h);
+                uint last = this->getCell(v->x + w, v->y + h);
+                uint x0 = first % this->columns, y0 = first / this->columns;
+                uint x1 = last % this->columns, y1 = last / this->columns;
+
+                for (uint y = y0; y <= y1; y++)
+                {
+                    for (uint x = x0; x <= x1; x++)
+                    {
+                        uint cell = y * this->columns + x;
+
+                        for (uint i = this->cellStart[cell]; i < this->cellStart[cell + 1]; i++)
+                        {
+                            uint e = this->cellEntities[i];
+                            unsigned long long bit = 1ull << (e % 64);
+                            if ((v->bits[e / 64] & bit) || !this->isInside(v, e, this->enterMargin)) continue;
+
+                            v->bits[e / 64] |= bit;
+                            v->relevant.push_back(e);
+                            this->events.push_back({ c, e, true });
+                        }
+                    }
+                }
+            }
         }
-#endif
-    }
+    };
 
-    struct endpoint
+#ifdef __linux__
+    // how the kernel spreads datagrams of the shared port over shards
+    enum class shardSteering
     {
-        sockaddr_in address;
-        float lastMessage;
-        bool isConnected;
+        // kernel hash of addresses and ports, a client stays on its shard while its address does
+        Hash,
+        // shard of the cpu that took the packet, with RSS or RPS a flow is handled on one core end to end
+        Cpu,
+        // first 4 payload bytes read big endian modulo shard count, survives address changes,
+        // shorter datagrams go to shard 0
+        Key
+    };
 
-        void getAddress(char* dst, uint maxSize)
+    // buffer posted between shards
+    struct shardMessage
+    {
+        packetBuffer* buffer;
+        uint from;
+    };
+
+    struct shardedServer;
+
+    // one socket of the shared port with its own thread, pool and connections,
+    // shards share nothing except the queues in 'inbox'
+    struct shard
+    {
+        shardedServer* owner;
+        uint index;
+        // -1 when not pinned
+        int cpu;
+        server srv;
+        packetPool pool;
+        connectionTable connections;
+        // inbox[from], one producer per ring
+        spscRing<shardMessage>* inbox;
+        // receiving stops when this many buffers are left so sends can allocate, like netThread
+        uint receiveSlots;
+        std::thread thread;
+        std::atomic<unsigned long long> received;
+        // datagrams from new endpoints when the connection table was full
+        std::atomic<unsigned long long> dropped;
+        // for the game, e.g. state of the part of the world this shard runs
+        void* user;
+
+        // shard thread, null when the pool is empty
+        packetBuffer* allocate()
         {
-            inet_ntop(AF_INET, &this->address.sin_addr, dst, maxSize);
+            return this->pool.allocate();
         }
+
+        void run();
+        uint receiveAll(batch* b, packetBuffer** spare);
+        uint receiveInbox();
+        uint sendAll(batch* b, packetBuffer** sending);
+        uint flushAll(batch* b, packetBuffer** sending);
     };
 
-    struct server
+    // Server on one port over N sockets bound with SO_REUSEPORT. Each socket belongs to a shard
+    // thread pinned to its own core, so receive, game code and send of a client stay on that core.
+    // Callbacks run on the shard's thread, send by queueing on the connection, anything for
+    // another shard goes through post.
+    struct shardedServer
     {
-        SOCKET s;
-        sockaddr_in address;
-        unsigned short port;
-        uint id;
-
-        void init(ushort port)
+        shard* shards;
+        uint count;
+        std::atomic<bool> running;
+        // every datagram, 'b' is released after it returns so retain it to keep it
+        std::function<void(shard* s, connection* c, packetBuffer* b)> onPacket;
+        // buffer posted by shard 'from', released after it returns
+        std::function<void(shard* s, packetBuffer* b, uint from)> onMessage;
+        // connection timed out, its slot is reused after it returns
+        std::function<void(shard* s, connection* c)> onDisconnect;
+
+        // false when a socket can't bind or the steering program can't be attached,
+        // destroy has to be called either way, 'pin' puts shard i on cpu i modulo cpu count
+        bool init(ushort port, uint count, shardSteering steering, uint poolCapacity,
+            uint connectionCapacity, uint timeoutMs, bool pin = true)
         {
-            int result = 0;
+            uint cpus = std::thread::hardware_concurrency();
+            uint ring = 1;
+            while (ring < poolCapacity / 4) ring <<= 1;
 
-            this->port = port;
-            this->id = uid++;
-            this->s = ::socket(AF_INET, SOCK_DGRAM, 0);
+            this->count = count;
+            this->shards = new shard[count];
+            this->running.store(false);
+            bool ok = true;
 
-#ifdef VI_VALIDATE
-            if (this->s == INVALID_SOCKET)
+            // sockets join the reuseport group in bind order, so a steering result is a shard index
+            for (uint i = 0; i < count; i++)
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                return;
+                shard* s = &this->shards[i];
+                s->owner = this;
+                s->index = i;
+                s->cpu = pin && cpus > 0 ? (int)(i % cpus) : -1;
+                s->user = nullptr;
+                s->received.store(0);
+                s->dropped.store(0);
+                s->srv.init(port, transport::Sockets, true);
+                s->pool.init(poolCapacity);
+                s->connections.init(connectionCapacity, timeoutMs);
+                s->receiveSlots = poolCapacity / 4 < NET_BATCH_SIZE ? poolCapacity / 4 : NET_BATCH_SIZE;
+                if (s->receiveSlots == 0) s->receiveSlots = 1;
+                s->inbox = new spscRing<shardMessage>[count];
+                for (uint j = 0; j < count; j++) s->inbox[j].init(ring);
+                ok = ok && s->srv.s != INVALID_SOCKET;
             }
-#endif
 
-            this->address.sin_port = htons(port);
-            this->address.sin_family = AF_INET;
-            this->address.sin_addr.s_addr = htonl(INADDR_ANY);
-            result = bind(this->s, (sockaddr*)&this->address, (int)sizeof(sockaddr));
+            if (!ok || steering == shardSteering::Hash)
+                return ok;
 
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+            // A = cpu or first payload word, A %= count, return A
+            sock_filter code[] =
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                return;
-            }
-#endif        
-
-            // set non blocking
-            ULONG mode = 1;
-            result = ioctlsocket(this->s, FIONBIO, &mode);
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+                { BPF_LD | BPF_W | BPF_ABS, 0, 0, steering == shardSteering::Cpu ? (uint)(SKF_AD_OFF + SKF_AD_CPU) : 0 },
+                { BPF_ALU | BPF_MOD | BPF_K, 0, 0, count },
+                { BPF_RET | BPF_A, 0, 0, 0 },
+            };
+            sock_fprog program = { 3, code };
+
+            // program belongs to the group, any socket of it will do
+            if (setsockopt(this->shards[0].srv.s, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) != 0)
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                return;
-            }
+#ifdef VI_VALIDATE
+                _printLastError();
 #endif
+                return false;
+            }
+
+            return true;
         }
 
-        void send(const byte* data, uint len, endpoint* ep)
+        // set callbacks first
+        void start()
         {
-            int result = sendto(this->s, (const char*)data, len, 0, (const sockaddr*)&ep->address, (int)sizeof(sockaddr));
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+            this->running.store(true);
+
+            for (uint i = 0; i < this->count; i++)
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
+                shard* s = &this->shards[i];
+                s->thread = std::thread([s]() { s->run(); });
             }
-#endif
         }
 
-        /// <summary>
-        /// Returns true if message received. False otherwise.
-        /// It's false if function was called but there was nothing to receive.
-        /// </summary>
-        bool receive(byte* data, uint limit, endpoint* ep)
+        void destroy()
         {
-            sockaddr_in address;
-            int len = sizeof(sockaddr_in);
-            int result = recvfrom(this->s, (char*)data, limit, 0, (sockaddr*)&address, &len);
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+            this->running.store(false);
+
+            for (uint i = 0; i < this->count; i++)
+                if (this->shards[i].thread.joinable()) this->shards[i].thread.join();
+
+            for (uint i = 0; i < this->count; i++)
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                exit(0);
+                shard* s = &this->shards[i];
+                shardMessage m;
+
+                for (uint j = 0; j < this->count; j++)
+                {
+                    while (s->inbox[j].pop(&m)) m.buffer->release();
+                    s->inbox[j].destroy();
+                }
+
+                delete[] s->inbox;
+                s->connections.destroy();
+                s->srv.destroyServer();
             }
-#endif
-            memcpy(&ep->address, &address, sizeof(sockaddr_in));
-            ep->isConnected = true;
-            return ep->isConnected;
+
+            // posted buffers go back to the pool of another shard, so pools go last
+            for (uint i = 0; i < this->count; i++) this->shards[i].pool.destroy();
+
+            delete[] this->shards;
+            this->shards = nullptr;
         }
 
-        void destroyServer()
+        // thread of shard 'from', takes over one reference of 'b'
+        // false and released when the queue is full, it's sized for rare messages
+        bool post(uint from, uint to, packetBuffer* b)
+        {
+            if (this->shards[to].inbox[from].push({ b, from })) return true;
+
+            b->release();
+            return false;
+        }
+
+        unsigned long long getReceived()
         {
+            unsigned long long total = 0;
+            for (uint i = 0; i < this->count; i++) total += this->shards[i].received.load(std::memory_order_relaxed);
+            return total;
         }
     };
 
-    struct client
+    void shard::run()
     {
-        SOCKET s;
-        sockaddr_in serverAddress;
-        unsigned short serverPort;
-        uint id;
+        if (this->cpu >= 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(this->cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
 
-        void init(const char* address, uint port)
+        batch in, out;
+        in.init();
+        out.init();
+        packetBuffer* spare[NET_BATCH_SIZE] = {};
+        packetBuffer* sending[NET_BATCH_SIZE];
+        connection* expired[64];
+
+        while (this->owner->running.load(std::memory_order_relaxed))
         {
-            vi::util::zero<client>(this);
-            this->serverPort = port;
-            this->id = uid++;
-            this->s = ::socket(AF_INET, SOCK_DGRAM, 0);
-#ifdef VI_VALIDATE
-            if (this->s == INVALID_SOCKET)
-            {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                return;
-            }
-#endif
-            this->serverAddress.sin_port = htons(port);
-            this->serverAddress.sin_family = AF_INET;
-            inet_pton(AF_INET, address, &this->serverAddress.sin_addr);
-            // connect is done so you dont have to pass address in sendto and recvfrom
-            // client communicates with only one address
-            int res = connect(this->s, (sockaddr*)&this->serverAddress, sizeof(sockaddr));
-#ifdef VI_VALIDATE
-            if (res == SOCKET_ERROR)
+            uint work = this->receiveAll(&in, spare);
+            work += this->receiveInbox();
+
+            uint n = this->connections.expire(vi::time::nowNs(), expired, 64);
+            if (this->owner->onDisconnect)
+                for (uint i = 0; i < n; i++) this->owner->onDisconnect(this, expired[i]);
+
+            work += this->sendAll(&out, sending);
+            if (work == 0) this->srv.wait(1);
+        }
+
+        for (uint i = 0; i < NET_BATCH_SIZE; i++)
+            if (spare[i]) spare[i]->release();
+
+        in.destroy();
+        out.destroy();
+    }
+
+    // receives one batch into pool buffers like netThread and handles it right here,
+    // a batch per pass lets replies queued by onPacket go out before connection queues fill
+    uint shard::receiveAll(batch* b, packetBuffer** spare)
+    {
+        uint ready = 0;
+
+        for (; ready < this->receiveSlots; ready++)
+        {
+            if (!spare[ready])
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                return;
+                if (this->pool.available.load(std::memory_order_relaxed) <= this->receiveSlots) break;
+                spare[ready] = this->pool.allocate();
+                if (!spare[ready]) break;
             }
-#endif
 
-            // set non blocking
-            ULONG mode = 1;
-            res = ioctlsocket(this->s, FIONBIO, &mode);
-#ifdef VI_VALIDATE
-            if (res == SOCKET_ERROR)
+            b->data[ready] = spare[ready]->bytes + NET_HEADROOM;
+        }
+
+        if (ready == 0) return 0;
+
+        uint n = this->srv.receiveBatch(b, ready);
+        long long now = vi::time::nowNs();
+
+        for (uint i = 0; i < n; i++)
+        {
+            packetBuffer* p = spare[i];
+            p->timeNs = now;
+            p->ep = b->endpoints[i];
+            p->offset = NET_HEADROOM;
+            p->len = b->lengths[i];
+            spare[i] = nullptr;
+
+            connection* c = this->connections.connect(&p->ep, now);
+
+            if (c)
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
+                this->connections.received(c, p->len, now);
+                if (this->owner->onPacket) this->owner->onPacket(this, c, p);
             }
-#endif
+            else this->dropped.fetch_add(1, std::memory_order_relaxed);
+
+            p->release();
         }
 
-        void send(byte* data, uint len)
+        this->received.fetch_add(n, std::memory_order_relaxed);
+        return n;
+    }
+
+    uint shard::receiveInbox()
+    {
+        uint total = 0;
+        shardMessage m;
+
+        for (uint i = 0; i < this->owner->count; i++)
         {
-            int result = ::send(this->s, (const char*)data, len, 0);
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+            while (this->inbox[i].pop(&m))
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                exit(0);
+                if (this->owner->onMessage) this->owner->onMessage(this, m.buffer, m.from);
+                m.buffer->release();
+                total++;
             }
-#endif
         }
 
-        void receive(byte* data, uint limit)
+        return total;
+    }
+
+    // send queues of all connections, batch points into the queued buffers
+    uint shard::sendAll(batch* b, packetBuffer** sending)
+    {
+        uint total = 0;
+        long long now = vi::time::nowNs();
+
+        for (uint a = 0; a < this->connections.activeCount; a++)
         {
-            int len = sizeof(sockaddr_in);
-            int result = recv(this->s, (char*)data, limit, 0);
-#ifdef VI_VALIDATE
-            if (result == SOCKET_ERROR)
+            connection* c = &this->connections.connections[this->connections.active[a]];
+
+            while (packetBuffer* p = c->dequeue())
             {
-                _getLastWinsockErrorMessage(WSAGetLastError());
-                fprintf(stderr, lastWinsockError);
-                exit(0);
+                uint i = b->count++;
+                b->data[i] = p->getData();
+                b->lengths[i] = p->len;
+                b->endpoints[i] = c->ep;
+                sending[i] = p;
+                c->stats.packetsSent++;
+                c->stats.bytesSent += p->len;
+                c->lastSentNs = now;
+
+                if (b->count == NET_BATCH_SIZE)
+                    total += this->flushAll(b, sending);
             }
-#endif
         }
 
-        void destroyClient()
+        if (b->count > 0)
+            total += this->flushAll(b, sending);
+
+        return total;
+    }
+
+    // same as netThread::flushAll
+    uint shard::flushAll(batch* b, packetBuffer** sending)
+    {
+        uint count = b->count;
+        uint sent = 0;
+
+        for (uint attempt = 0; attempt < 100 && b->count > 0; attempt++)
         {
+            uint n = this->srv.flushBatch(b);
+            sent += n;
+            if (n == 0) std::this_thread::yield();
         }
-    };
 
-    bool compareEndpoints(const endpoint* a, const endpoint* b)
-    {
-        return memcmp(&a->address, &b->address, 8) == 0;
+        b->count = 0;
+        for (uint i = 0; i < count; i++) sending[i]->release();
+        return sent;
     }
+#endif
 }
 
 namespace vi::fn
@@ -2726,8 +9313,8 @@ namespace vi::fn
         float timeout;
         float interval;
         float duration;
-        float lastUpdate;
-        float started;
+        double lastUpdate;
+        double started;
         uint id;
         bool destroy;
     };
@@ -2750,8 +9337,8 @@ namespace vi::fn
             r->duration = duration;
             r->fn = fn;
             r->interval = interval;
-            r->started = this->t->getGameTimeSec();
-            r->lastUpdate = this->t->getGameTimeSec();
+            r->started = this->t->getGameTime();
+            r->lastUpdate = this->t->getGameTime();
             r->timeout = timeout;
             r->id = this->idNext;
             this->idNext++;
@@ -2774,7 +9361,7 @@ namespace vi::fn
 
         void update(routine* routines, uint count)
         {
-            float gameTime = this->t->getGameTimeSec();
+            double gameTime = this->t->getGameTime();
 
             for (int i = count - 1; i >= 0; i--)
             {